@@ -9,7 +9,7 @@
 #include "NSArray+utils.h"
 #include "NSFileManager+unique.h"
 #include "NSString+utils.h"
-#include "NSTask+utils.h"
+#include "TaskQueue.h"
 
 @implementation ApplicationDelegate (compression)
 
@@ -99,8 +99,8 @@
   NSString *commandAfterSubstitution;
   NSMutableArray *searchValues, *replaceValues;
   NSMutableString *filesToArchiveWithPath;
-  NSDictionary *taskResults;
 
+  fileConfig = [self configurationPreferringParallelPrograms:fileConfig];
   shellPath = [self shellPathUsingConfiguration:fileConfig];
   shellArgs = [self shellArgsUsingConfiguration:fileConfig];
 
@@ -177,12 +177,35 @@
     [debugWindow makeKeyAndOrderFront:self];
   }
 
-  if (![[NSUserDefaults standardUserDefaults] boolForKey:@"RunTask"])
+  if (![[NSUserDefaults standardUserDefaults] boolForKey:@"RunTask"]) {
+    [launchArguments release];
     return;
+  }
+
+  [[TaskQueue sharedQueue] addJobWithTitle:[archivePath lastPathComponent]
+                                launchPath:shellPath
+                               inDirectory:archiveDirectoryPath
+                                  withArgs:launchArguments
+                                    target:self
+                                    action:@selector(compressionDidFinish:)
+                                  userInfo:archivePath];
+  [launchArguments release];
+}
+
+// - (void)compressionDidFinish:(TaskJob *)job;
+//
+// Sent by the task queue when the archiver launched by
+// compressFiles:intoArchive:usingConfig: exits or the job is cancelled.
+- (void)compressionDidFinish:(TaskJob *)job
+{
+  NSString *archivePath = [job userInfo];
+  NSDictionary *taskResults = [job results];
 
-  taskResults = [NSTask performTask:shellPath
-                        inDirectory:archiveDirectoryPath
-                           withArgs:launchArguments];
+  if ([[taskResults objectForKey:@"Cancelled"] boolValue]) {
+    // don't leave a truncated archive behind
+    [[NSFileManager defaultManager] removeFileAtPath:archivePath handler:nil];
+    return;
+  }
 
   if ([[taskResults objectForKey:@"TerminationStatus"] intValue] != 0) {
     // If the termination status non zero, then we've encountered an error
@@ -14,7 +14,7 @@
 #import "NSColor+utils.h"
 #import "NSFileManager+unique.h"
 #import "NSString+utils.h"
-#import "NSTask+utils.h"
+#import "TaskQueue.h"
 
 @implementation ApplicationDelegate (decompression)
 
@@ -159,7 +159,7 @@
   NSString *applicationResourcesWrapperPath;
   NSMutableArray *searchValues, *replaceValues;
   NSDictionary *substitutionKeysForWrappedPrograms;
-  NSDictionary *taskResults;
+  NSDictionary *jobInfo;
 
   // determine the unix application to launch, and the command
   // line arguments to use based on the filename if we are unable
@@ -173,6 +173,7 @@
   //  NSLog(@"fileConfig: %@", fileConfig);
   if (!fileConfig)
     return;
+  fileConfig = [self configurationPreferringParallelPrograms:fileConfig];
 
   shellPath = [self shellPathUsingConfiguration:fileConfig];
   shellArgs = [self shellArgsUsingConfiguration:fileConfig];
@@ -276,9 +277,36 @@
 
   NSLog(@"launchArguments: %@", launchArguments);
 
-  taskResults = [NSTask performTask:shellPath
-                        inDirectory:unarchiveDirectoryPath
-                           withArgs:launchArguments];
+  // Archives are unpacked in parallel by the task queue - the rest is done
+  // in decompressionDidFinish: when the archiver exits
+  jobInfo = [NSDictionary dictionaryWithObjectsAndKeys:archivePath, @"ArchivePath",
+                                                       unarchiveDirectoryPath,
+                                                       @"UnarchiveDirectoryPath", nil];
+  [[TaskQueue sharedQueue] addJobWithTitle:archiveFilenameWithoutPath
+                                launchPath:shellPath
+                               inDirectory:unarchiveDirectoryPath
+                                  withArgs:launchArguments
+                                    target:self
+                                    action:@selector(decompressionDidFinish:)
+                                  userInfo:jobInfo];
+  [launchArguments release];
+}
+
+// - (void)decompressionDidFinish:(TaskJob *)job;
+//
+// Sent by the task queue when the archiver launched by decompressFile:
+// exits or the job is cancelled.
+- (void)decompressionDidFinish:(TaskJob *)job
+{
+  NSString *archivePath = [[job userInfo] objectForKey:@"ArchivePath"];
+  NSString *unarchiveDirectoryPath = [[job userInfo] objectForKey:@"UnarchiveDirectoryPath"];
+  NSDictionary *taskResults = [job results];
+
+  if ([[taskResults objectForKey:@"Cancelled"] boolValue]) {
+    // whatever was unpacked so far is of no use
+    [[NSFileManager defaultManager] removeFileAtPath:unarchiveDirectoryPath handler:nil];
+    return;
+  }
 
   if (([[taskResults objectForKey:@"StandardError"] length] > 0) ||
       ([[taskResults objectForKey:@"TerminationStatus"] intValue] != 0)) {
@@ -0,0 +1,185 @@
+/*
+ File:       ApplicationDelegate+jobs.m
+
+ Panel listing archives which are being compressed or decompressed.
+*/
+
+#include "ApplicationDelegate.h"
+#include "NSArray+utils.h"
+#include "NSColor+utils.h"
+#include "TaskQueue.h"
+
+@implementation ApplicationDelegate (jobs)
+
+- (void)createJobsPanel
+{
+  NSView *contentView;
+  NSScrollView *scrollView;
+  NSTableColumn *column;
+  NSButton *cancelButton;
+
+  jobsPanel = [[NSPanel alloc]
+      initWithContentRect:NSMakeRect(0, 0, 420, 200)
+                styleMask:(NSTitledWindowMask | NSClosableWindowMask | NSResizableWindowMask)
+                  backing:NSBackingStoreBuffered
+                    defer:YES];
+  [jobsPanel setTitle:NSLocalizedString(@"JobsPanelTitle", @"Processes")];
+  [jobsPanel setReleasedWhenClosed:NO];
+  [jobsPanel setHidesOnDeactivate:NO];
+  [jobsPanel setMinSize:NSMakeSize(240, 120)];
+  contentView = [jobsPanel contentView];
+
+  scrollView = [[NSScrollView alloc] initWithFrame:NSMakeRect(8, 40, 404, 152)];
+  [scrollView setHasVerticalScroller:YES];
+  [scrollView setBorderType:NSBezelBorder];
+  [scrollView setAutoresizingMask:(NSViewWidthSizable | NSViewHeightSizable)];
+
+  jobsTableView = [[NSTableView alloc] initWithFrame:[[scrollView contentView] bounds]];
+  column = [[NSTableColumn alloc] initWithIdentifier:@"title"];
+  [[column headerCell] setStringValue:NSLocalizedString(@"JobsArchiveColumn", @"Archive")];
+  [[column headerCell] setFont:[NSFont systemFontOfSize:10]];
+  [[column dataCell] setFont:[NSFont systemFontOfSize:10]];
+  [column setEditable:NO];
+  [column setWidth:150];
+  [jobsTableView addTableColumn:column];
+  [column release];
+
+  column = [[NSTableColumn alloc] initWithIdentifier:@"status"];
+  [[column headerCell] setStringValue:NSLocalizedString(@"JobsStatusColumn", @"Status")];
+  [[column headerCell] setFont:[NSFont systemFontOfSize:10]];
+  [[column dataCell] setFont:[NSFont systemFontOfSize:10]];
+  [column setEditable:NO];
+  [column setWidth:230];
+  [jobsTableView addTableColumn:column];
+  [column release];
+
+  [jobsTableView setAllowsMultipleSelection:YES];
+  [jobsTableView setAllowsEmptySelection:YES];
+  [jobsTableView setAutoresizesAllColumnsToFit:YES];
+  [jobsTableView setBackgroundColor:[NSColor tanTextBackgroundColor]];
+  [scrollView setDocumentView:jobsTableView];
+  [contentView addSubview:scrollView];
+  [scrollView release];
+
+  cancelButton = [[NSButton alloc] initWithFrame:NSMakeRect(332, 8, 80, 24)];
+  [cancelButton setTitle:NSLocalizedString(@"JobsCancelButton", @"Cancel")];
+  [cancelButton setTarget:self];
+  [cancelButton setAction:@selector(cancelSelectedJobs:)];
+  [cancelButton setAutoresizingMask:(NSViewMinXMargin | NSViewMaxYMargin)];
+  [contentView addSubview:cancelButton];
+  [cancelButton release];
+
+  [jobsPanel center];
+}
+
+// - (void)reloadJobsTable;
+//
+// The table gets its data from an array of dictionaries, like the table
+// in the info panel does.  Selected jobs stay selected as rows come and go.
+- (void)reloadJobsTable
+{
+  NSMutableArray *rows = [NSMutableArray array];
+  NSMutableArray *selectedJobs = [NSMutableArray array];
+  NSEnumerator *overRows;
+  NSNumber *eachRow;
+  TaskJob *eachJob;
+  int i;
+
+  overRows = [jobsTableView selectedRowEnumerator];
+  while ((eachRow = [overRows nextObject])) {
+    [selectedJobs addObject:[[jobsTableRows objectAtIndex:[eachRow intValue]] objectForKey:@"job"]];
+  }
+
+  overRows = [[[TaskQueue sharedQueue] jobs] objectEnumerator];
+  while ((eachJob = [overRows nextObject])) {
+    [rows addObject:[NSDictionary dictionaryWithObjectsAndKeys:[eachJob title], @"title",
+                                                               [eachJob statusString], @"status",
+                                                               eachJob, @"job", nil]];
+  }
+
+  [jobsTableRows release];
+  jobsTableRows = [rows retain];
+  [jobsTableView setDataSource:jobsTableRows];
+  [jobsTableView reloadData];
+
+  [jobsTableView deselectAll:self];
+  for (i = 0; i < [jobsTableRows count]; i++) {
+    if ([selectedJobs indexOfObjectIdenticalTo:[[jobsTableRows objectAtIndex:i] objectForKey:@"job"]] !=
+        NSNotFound) {
+      [jobsTableView selectRow:i byExtendingSelection:YES];
+    }
+  }
+}
+
+// OpenUp.gorm has no item for the panel - put it before Windows
+- (void)addJobsMenuItem
+{
+  NSMenu *mainMenu = [NSApp mainMenu];
+  NSMenuItem *item;
+  NSInteger index;
+
+  index = [mainMenu indexOfItemWithTitle:@"Windows"];
+  if (index < 0)
+    index = [mainMenu numberOfItems];
+
+  item = [[NSMenuItem alloc] initWithTitle:NSLocalizedString(@"JobsMenuItem", @"Processes...")
+                                    action:@selector(showJobsPanel:)
+                             keyEquivalent:@""];
+  [item setTarget:self];
+  [mainMenu insertItem:item atIndex:index];
+  [item release];
+}
+
+- (void)showJobsPanel:(id)sender
+{
+  if (!jobsPanel)
+    [self createJobsPanel];
+
+  [self reloadJobsTable];
+  [jobsPanel orderFront:sender];
+}
+
+- (void)showJobsPanelIfBusy
+{
+  jobsPanelScheduled = NO;
+  if ([[[TaskQueue sharedQueue] jobs] count] > 0)
+    [self showJobsPanel:self];
+}
+
+- (void)cancelSelectedJobs:(id)sender
+{
+  NSMutableArray *selectedJobs = [NSMutableArray array];
+  NSEnumerator *overRows;
+  NSNumber *eachRow;
+  TaskJob *eachJob;
+
+  // cancelling changes the rows, so collect the jobs first
+  overRows = [jobsTableView selectedRowEnumerator];
+  while ((eachRow = [overRows nextObject])) {
+    [selectedJobs addObject:[[jobsTableRows objectAtIndex:[eachRow intValue]] objectForKey:@"job"]];
+  }
+
+  overRows = [selectedJobs objectEnumerator];
+  while ((eachJob = [overRows nextObject])) {
+    [eachJob cancel];
+  }
+}
+
+// - (void)jobsDidChange:(NSNotification *)aNotification;
+//
+// Quick jobs come and go without the panel.  It shows up once some job
+// has been in the queue for a second and goes away when the queue is empty.
+- (void)jobsDidChange:(NSNotification *)aNotification
+{
+  if ([[[TaskQueue sharedQueue] jobs] count] == 0) {
+    [jobsPanel orderOut:self];
+  } else if (![jobsPanel isVisible] && !jobsPanelScheduled) {
+    jobsPanelScheduled = YES;
+    [self performSelector:@selector(showJobsPanelIfBusy) withObject:nil afterDelay:1.0];
+  }
+
+  if ([jobsPanel isVisible])
+    [self reloadJobsTable];
+}
+
+@end
@@ -7,6 +7,8 @@
 
 #include <AppKit/AppKit.h>
 
+@class TaskJob;
+
 @interface ApplicationDelegate : NSObject {
   NSString *appWorkingDirectory;
   NSArray *fileTypeConfigArray;
@@ -25,6 +27,11 @@
   id debugTextView;
   NSArray *infoPanelSupportedTypes;
   id infoTableView;
+
+  NSPanel *jobsPanel;
+  NSTableView *jobsTableView;
+  NSArray *jobsTableRows;
+  BOOL jobsPanelScheduled;
 }
 
 - (BOOL)applicationShouldTerminate:(NSApplication *)app;
@@ -39,6 +46,8 @@
 - (NSString *)shellPathUsingConfiguration:(NSDictionary *)fileConfig;
 - (NSArray *)shellArgsUsingConfiguration:(NSDictionary *)fileConfig;
 - (NSDictionary *)wrappedProgramsUsingConfiguration:(NSDictionary *)fileConfig;
+- (NSString *)pathForProgram:(NSString *)program;
+- (NSDictionary *)configurationPreferringParallelPrograms:(NSDictionary *)fileConfig;
 @end
 
 @interface ApplicationDelegate (compression)
@@ -47,6 +56,7 @@
 - (void)compressFiles:(NSArray *)files
           intoArchive:(NSString *)archivePath
           usingConfig:(NSDictionary *)fileConfig;
+- (void)compressionDidFinish:(TaskJob *)job;
 @end
 
 @interface ApplicationDelegate (decompression)
@@ -55,9 +65,17 @@
 - (NSString *)fileExtensionIn:extensions matchingString:(NSString *)theString;
 - (NSDictionary *)matchFileToConfig:(NSString *)archivePath;
 - (void)decompressFile:(NSString *)archivePath;
+- (void)decompressionDidFinish:(TaskJob *)job;
 @end
 
 @interface ApplicationDelegate (infopanel)
 - (NSArray *)infoAboutSupportedFileExtensions;
 - showInfoPanel:sender;
 @end
+
+@interface ApplicationDelegate (jobs)
+- (void)addJobsMenuItem;
+- (void)showJobsPanel:(id)sender;
+- (void)cancelSelectedJobs:(id)sender;
+- (void)jobsDidChange:(NSNotification *)aNotification;
+@end
@@ -13,6 +13,7 @@
 #include "NSColor+utils.h"
 #include "NSFileManager+unique.h"
 #include "NSString+utils.h"
+#include "TaskQueue.h"
 
 @implementation ApplicationDelegate
 
@@ -51,13 +52,16 @@
       // the user has selected to remove all the files so, we
       // delete the temporary directory and return YES so that
       // the app will quit
+      [[TaskQueue sharedQueue] cancelAllJobsAndWait];
       [[NSFileManager defaultManager] removeFileAtPath:appWorkingDirectory handler:nil];
       return YES;
     }
-    if (result == NSAlertAlternateReturn)
+    if (result == NSAlertAlternateReturn) {
       // the user has selected to retain the temp files
-      // so we do nothing and return YES so that the app will quit
+      // so we only stop the archivers and return YES so that the app will quit
+      [[TaskQueue sharedQueue] cancelAllJobsAndWait];
       return YES;
+    }
     if (result == NSAlertOtherReturn)
       // the user has clicked cancel
       // return NO so that the app will not quit
@@ -66,7 +70,9 @@
     // Either there are no files in our temporary directory,
     // or the user has elected to delete the temp files by
     // default either way, we delete our temporary directory
-    // and fall through
+    // and fall through. Archivers still running would write into the
+    // directory we are about to remove, so they are stopped first.
+    [[TaskQueue sharedQueue] cancelAllJobsAndWait];
     [[NSFileManager defaultManager] removeFileAtPath:appWorkingDirectory handler:nil];
   }
 
@@ -206,6 +212,12 @@
 - (void)applicationDidFinishLaunching:(NSNotification *)aNotification;
 {
   [NSApp setServicesProvider:self];
+  [self addJobsMenuItem];
+
+  [[NSNotificationCenter defaultCenter] addObserver:self
+                                           selector:@selector(jobsDidChange:)
+                                               name:TaskQueueDidChangeNotification
+                                             object:[TaskQueue sharedQueue]];
 }
 
 // - (void)setupUserDefaults;
@@ -255,6 +267,10 @@
 
 - (void)dealloc;
 {
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+  [jobsTableRows release];
+  [jobsTableView release];
+  [jobsPanel release];
   [infoPanelSupportedTypes release];
   [appWorkingDirectory release];
   [fileTypeConfigArray release];
@@ -333,4 +349,90 @@
   return [NSDictionary dictionaryWithDictionary:outDict];
 }
 
+// - (NSString *)pathForProgram:(NSString *)program;
+//
+// Looks for the program in the application wrapper first, the same
+// way wrappedProgramsUsingConfiguration: does, and then in PATH.
+// Returns nil if the program isn't installed.
+
+- (NSString *)pathForProgram:(NSString *)program;
+{
+  static NSMutableDictionary *foundPrograms = nil;
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *pathToProg;
+  NSString *searchPath;
+  NSEnumerator *overDirectories;
+  NSString *eachDirectory;
+
+  if (!foundPrograms)
+    foundPrograms = [[NSMutableDictionary alloc] init];
+
+  if ((pathToProg = [foundPrograms objectForKey:program]))
+    return [pathToProg length] ? pathToProg : nil;
+
+  pathToProg = [[NSBundle mainBundle] pathForResource:program ofType:@""];
+  if (!pathToProg) {
+    searchPath = [[[NSProcessInfo processInfo] environment] objectForKey:@"PATH"];
+    if (!searchPath)
+      searchPath = @"/usr/local/bin:/usr/bin:/bin";
+
+    overDirectories = [[searchPath componentsSeparatedByString:@":"] objectEnumerator];
+    while ((eachDirectory = [overDirectories nextObject])) {
+      NSString *candidate = [eachDirectory stringByAppendingPathComponent:program];
+
+      if ([eachDirectory length] && [fileManager isExecutableFileAtPath:candidate]) {
+        pathToProg = candidate;
+        break;
+      }
+    }
+  }
+
+  // remember misses too, archives tend to come in batches
+  [foundPrograms setObject:(pathToProg ? pathToProg : @"") forKey:program];
+
+  return pathToProg;
+}
+
+// - (NSDictionary *)configurationPreferringParallelPrograms:(NSDictionary *)fileConfig;
+//
+// A configuration may list "parallel_alternatives" - the same job done
+// by multithreaded programs (pigz, zstd -T0, xz -T0) with tar piping
+// the stream through them.  The first alternative which has all of its
+// wrapped_programs installed replaces the command and wrapped_programs
+// of the configuration.  The PreferParallelPrograms default turns this
+// off.
+
+- (NSDictionary *)configurationPreferringParallelPrograms:(NSDictionary *)fileConfig;
+{
+  NSEnumerator *overAlternatives;
+  NSDictionary *eachAlternative;
+
+  if (![[NSUserDefaults standardUserDefaults] boolForKey:@"PreferParallelPrograms"])
+    return fileConfig;
+
+  overAlternatives = [[fileConfig objectForKey:@"parallel_alternatives"] objectEnumerator];
+  while ((eachAlternative = [overAlternatives nextObject])) {
+    NSEnumerator *overPrograms;
+    NSString *eachProgram;
+    BOOL allInstalled = YES;
+
+    overPrograms = [[eachAlternative objectForKey:@"wrapped_programs"] objectEnumerator];
+    while ((eachProgram = [overPrograms nextObject])) {
+      if (![self pathForProgram:eachProgram]) {
+        allInstalled = NO;
+        break;
+      }
+    }
+
+    if (allInstalled) {
+      NSMutableDictionary *outDict = [NSMutableDictionary dictionaryWithDictionary:fileConfig];
+
+      [outDict addEntriesFromDictionary:eachAlternative];
+      return outDict;
+    }
+  }
+
+  return fileConfig;
+}
+
 @end
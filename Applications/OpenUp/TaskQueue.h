@@ -0,0 +1,93 @@
+/*
+ File:       TaskQueue.h
+
+ Runs archiver tasks in the background, as many at once as there are
+ processors. Everything happens on the main run loop: standard error of
+ each task is read as it arrives and its target gets the action message
+ with the finished job.
+*/
+
+#include <AppKit/AppKit.h>
+
+@class TaskQueue;
+
+typedef enum {
+  TaskJobWaiting,
+  TaskJobRunning,
+  TaskJobFinished,
+  TaskJobCancelled
+} TaskJobState;
+
+// Posted by the queue when jobs are added, change their state or print
+// something to standard error.
+extern NSString *TaskQueueDidChangeNotification;
+
+@interface TaskJob : NSObject {
+  TaskQueue *queue;
+  NSString *title;
+  NSString *launchPath;
+  NSString *directory;
+  NSArray *arguments;
+  id target;
+  SEL action;
+  id userInfo;
+
+  TaskJobState state;
+  NSTask *task;
+  NSFileHandle *errorHandle;
+  NSMutableData *errorData;
+  NSString *lastErrorLine;
+  BOOL taskDidExit;
+  BOOL errorDidClose;
+}
+
+- (NSString *)title;
+- (TaskJobState)state;
+- (id)userInfo;
+// Last line printed to standard error or a description of the state
+- (NSString *)statusString;
+
+// Valid once the action message was sent. Keys:
+//   LaunchPath, CurrentDirectoryPath, LaunchArguments - what was run
+//   StandardError     - everything the task printed to standard error
+//   TerminationStatus - exit status or -1 if the task was not run
+//   Cancelled         - YES if the job was cancelled
+- (NSDictionary *)results;
+
+// Removes the waiting job from the queue or kills the running task. Target
+// gets the action message in either case.
+- (void)cancel;
+
+// Waits until the task of a cancelled job and the rest of its shell
+// pipeline have exited. Processes which ignore SIGTERM are killed.
+- (void)waitUntilExit;
+@end
+
+@interface TaskQueue : NSObject {
+  NSMutableArray *jobs;
+  NSUInteger maxRunningJobs;
+  NSUInteger runningJobs;
+}
+
++ (TaskQueue *)sharedQueue;
+
+// Defaults to the MaxConcurrentJobs default or the number of processors
+- (void)setMaxRunningJobs:(NSUInteger)count;
+- (NSUInteger)maxRunningJobs;
+
+// Waiting and running jobs in the order they were added
+- (NSArray *)jobs;
+
+- (TaskJob *)addJobWithTitle:(NSString *)aTitle
+                  launchPath:(NSString *)command
+                 inDirectory:(NSString *)directory
+                    withArgs:(NSArray *)values
+                      target:(id)aTarget
+                      action:(SEL)anAction
+                    userInfo:(id)info;
+
+- (void)cancelAllJobs;
+// Cancels all jobs and returns once their processes are gone, so the
+// files they were writing can be removed.
+- (void)cancelAllJobsAndWait;
+@end
@@ -0,0 +1,403 @@
+/*
+ File:       TaskQueue.m
+*/
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "TaskQueue.h"
+
+NSString *TaskQueueDidChangeNotification = @"TaskQueueDidChangeNotification";
+
+@interface TaskQueue (Private)
+- (void)jobDidChange:(TaskJob *)job;
+- (void)jobDidFinish:(TaskJob *)job;
+- (void)startWaitingJobs;
+@end
+
+@interface TaskJob (Private)
+- (id)initWithQueue:(TaskQueue *)aQueue
+              title:(NSString *)aTitle
+         launchPath:(NSString *)command
+        inDirectory:(NSString *)aDirectory
+           withArgs:(NSArray *)values
+             target:(id)aTarget
+             action:(SEL)anAction
+           userInfo:(id)info;
+- (BOOL)wasLaunched;
+- (void)launch;
+- (void)finish;
+@end
+
+@implementation TaskJob
+
+- (id)initWithQueue:(TaskQueue *)aQueue
+              title:(NSString *)aTitle
+         launchPath:(NSString *)command
+        inDirectory:(NSString *)aDirectory
+           withArgs:(NSArray *)values
+             target:(id)aTarget
+             action:(SEL)anAction
+           userInfo:(id)info
+{
+  if (!(self = [super init]))
+    return nil;
+
+  queue = aQueue;
+  title = [aTitle copy];
+  launchPath = [command copy];
+  directory = [aDirectory copy];
+  arguments = [values copy];
+  target = aTarget;
+  action = anAction;
+  userInfo = [info retain];
+  state = TaskJobWaiting;
+  errorData = [[NSMutableData alloc] init];
+
+  return self;
+}
+
+- (void)dealloc
+{
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+  [title release];
+  [launchPath release];
+  [directory release];
+  [arguments release];
+  [userInfo release];
+  [task release];
+  [errorHandle release];
+  [errorData release];
+  [lastErrorLine release];
+  [super dealloc];
+}
+
+- (NSString *)title
+{
+  return title;
+}
+
+- (TaskJobState)state
+{
+  return state;
+}
+
+- (id)userInfo
+{
+  return userInfo;
+}
+
+- (NSString *)statusString
+{
+  switch (state) {
+  case TaskJobWaiting:
+    return NSLocalizedString(@"JobWaiting", @"Waiting");
+  case TaskJobCancelled:
+    return NSLocalizedString(@"JobCancelled", @"Cancelled");
+  case TaskJobFinished:
+    return NSLocalizedString(@"JobFinished", @"Finished");
+  default:
+    if (lastErrorLine)
+      return lastErrorLine;
+    return NSLocalizedString(@"JobRunning", @"Running");
+  }
+}
+
+- (NSDictionary *)results
+{
+  NSMutableDictionary *outputDict = [NSMutableDictionary dictionary];
+
+  [outputDict setObject:launchPath forKey:@"LaunchPath"];
+  [outputDict setObject:directory forKey:@"CurrentDirectoryPath"];
+  [outputDict setObject:arguments forKey:@"LaunchArguments"];
+  [outputDict setObject:[[[NSString alloc] initWithData:errorData
+                                               encoding:NSASCIIStringEncoding] autorelease]
+                 forKey:@"StandardError"];
+  [outputDict setObject:[NSNumber numberWithInt:(taskDidExit ? [task terminationStatus] : -1)]
+                 forKey:@"TerminationStatus"];
+  [outputDict setObject:[NSNumber numberWithBool:(state == TaskJobCancelled)]
+                 forKey:@"Cancelled"];
+
+  return outputDict;
+}
+
+- (void)cancel
+{
+  if (state == TaskJobWaiting) {
+    state = TaskJobCancelled;
+    [self finish];
+  } else if (state == TaskJobRunning) {
+    state = TaskJobCancelled;
+    [queue jobDidChange:self];
+    // Archivers run in a shell pipeline - try to stop all of it
+    if (!taskDidExit && kill(-[task processIdentifier], SIGTERM) != 0) {
+      [task terminate];
+    }
+  }
+}
+
+- (void)waitUntilExit
+{
+  pid_t group;
+  int i;
+
+  // A task that failed to launch has no process
+  if (task == nil || (group = [task processIdentifier]) <= 0)
+    return;
+
+  if ([task isRunning])
+    [task waitUntilExit];
+
+  // The shell is gone, give the rest of the pipeline a moment to follow
+  for (i = 0; i < 20 && kill(-group, 0) == 0; i++) {
+    usleep(100000);
+  }
+  if (i == 20) {
+    kill(-group, SIGKILL);
+  }
+}
+
+@end
+
+@implementation TaskJob (Private)
+
+- (BOOL)wasLaunched
+{
+  return (task != nil);
+}
+
+- (void)launch
+{
+  NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+  NSPipe *readPipe = [NSPipe pipe];
+
+  task = [[NSTask alloc] init];
+  errorHandle = [[readPipe fileHandleForReading] retain];
+  [task setCurrentDirectoryPath:directory];
+  [task setStandardError:readPipe];
+  [task setLaunchPath:launchPath];
+  [task setArguments:arguments];
+
+  [center addObserver:self
+             selector:@selector(taskDidTerminate:)
+                 name:NSTaskDidTerminateNotification
+               object:task];
+  [center addObserver:self
+             selector:@selector(errorHandleDidRead:)
+                 name:NSFileHandleReadCompletionNotification
+               object:errorHandle];
+
+  state = TaskJobRunning;
+  NS_DURING
+  {
+    [task launch];
+  }
+  NS_HANDLER
+  {
+    NSLog(@"Failed to launch %@: %@", launchPath, [localException reason]);
+    [errorData appendData:[[localException reason] dataUsingEncoding:NSASCIIStringEncoding
+                                                 allowLossyConversion:YES]];
+    taskDidExit = YES;
+    errorDidClose = YES;
+    [self finish];
+    return;
+  }
+  NS_ENDHANDLER
+
+  [errorHandle readInBackgroundAndNotify];
+}
+
+// Standard error is read until the end of file, even after the task exits,
+// so nothing printed at exit is lost.
+- (void)errorHandleDidRead:(NSNotification *)aNotification
+{
+  NSData *inData = [[aNotification userInfo] objectForKey:NSFileHandleNotificationDataItem];
+  NSArray *lines;
+  NSEnumerator *overLines;
+  NSString *eachLine;
+
+  if ([inData length] == 0) {
+    errorDidClose = YES;
+    if (taskDidExit)
+      [self finish];
+    return;
+  }
+
+  [errorData appendData:inData];
+
+  // Archivers print progress to standard error - show the latest line
+  lines = [[[[NSString alloc] initWithData:inData
+                                  encoding:NSASCIIStringEncoding] autorelease]
+      componentsSeparatedByString:@"\n"];
+  overLines = [lines reverseObjectEnumerator];
+  while ((eachLine = [overLines nextObject])) {
+    eachLine = [eachLine
+        stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    if ([eachLine length] > 0) {
+      [lastErrorLine release];
+      lastErrorLine = [eachLine retain];
+      break;
+    }
+  }
+  if (state == TaskJobRunning)
+    [queue jobDidChange:self];
+
+  [errorHandle readInBackgroundAndNotify];
+}
+
+- (void)taskDidTerminate:(NSNotification *)aNotification
+{
+  taskDidExit = YES;
+  if (errorDidClose)
+    [self finish];
+}
+
+- (void)finish
+{
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+  if (state != TaskJobCancelled)
+    state = TaskJobFinished;
+
+  [self retain];
+  [queue jobDidFinish:self];
+  [target performSelector:action withObject:self];
+  [self release];
+}
+
+@end
+
+@implementation TaskQueue
+
+static TaskQueue *sharedQueue = nil;
+
++ (TaskQueue *)sharedQueue
+{
+  if (!sharedQueue)
+    sharedQueue = [[TaskQueue alloc] init];
+  return sharedQueue;
+}
+
+- (id)init
+{
+  NSInteger count;
+
+  if (!(self = [super init]))
+    return nil;
+
+  jobs = [[NSMutableArray alloc] init];
+
+  count = [[NSUserDefaults standardUserDefaults] integerForKey:@"MaxConcurrentJobs"];
+  if (count <= 0)
+    count = [[NSProcessInfo processInfo] activeProcessorCount];
+  [self setMaxRunningJobs:count];
+
+  return self;
+}
+
+- (void)dealloc
+{
+  [jobs release];
+  [super dealloc];
+}
+
+- (void)setMaxRunningJobs:(NSUInteger)count
+{
+  maxRunningJobs = MAX(count, 1);
+  [self startWaitingJobs];
+}
+
+- (NSUInteger)maxRunningJobs
+{
+  return maxRunningJobs;
+}
+
+- (NSArray *)jobs
+{
+  return [NSArray arrayWithArray:jobs];
+}
+
+- (TaskJob *)addJobWithTitle:(NSString *)aTitle
+                  launchPath:(NSString *)command
+                 inDirectory:(NSString *)directory
+                    withArgs:(NSArray *)values
+                      target:(id)aTarget
+                      action:(SEL)anAction
+                    userInfo:(id)info
+{
+  TaskJob *job;
+
+  job = [[TaskJob alloc] initWithQueue:self
+                                 title:aTitle
+                            launchPath:command
+                           inDirectory:directory
+                              withArgs:values
+                                target:aTarget
+                                action:anAction
+                              userInfo:info];
+  [jobs addObject:job];
+  [job release];
+
+  [self jobDidChange:job];
+  [self startWaitingJobs];
+
+  return job;
+}
+
+- (void)cancelAllJobs
+{
+  NSEnumerator *overJobs = [[self jobs] reverseObjectEnumerator];
+  TaskJob *eachJob;
+
+  // Waiting jobs go first so that cancelling the running ones doesn't
+  // start them
+  while ((eachJob = [overJobs nextObject])) {
+    [eachJob cancel];
+  }
+}
+
+- (void)cancelAllJobsAndWait
+{
+  NSArray *allJobs = [self jobs];
+
+  [self cancelAllJobs];
+  [allJobs makeObjectsPerformSelector:@selector(waitUntilExit)];
+}
+
+@end
+
+@implementation TaskQueue (Private)
+
+- (void)jobDidChange:(TaskJob *)job
+{
+  [[NSNotificationCenter defaultCenter] postNotificationName:TaskQueueDidChangeNotification
+                                                      object:self];
+}
+
+- (void)jobDidFinish:(TaskJob *)job
+{
+  if ([jobs indexOfObjectIdenticalTo:job] == NSNotFound)
+    return;
+
+  // A job cancelled while waiting never ran
+  if ([job wasLaunched])
+    runningJobs--;
+  [jobs removeObjectIdenticalTo:job];
+
+  [self jobDidChange:job];
+  [self startWaitingJobs];
+}
+
+- (void)startWaitingJobs
+{
+  NSEnumerator *overJobs = [[self jobs] objectEnumerator];
+  TaskJob *eachJob;
+
+  while (runningJobs < maxRunningJobs && (eachJob = [overJobs nextObject])) {
+    if ([eachJob state] == TaskJobWaiting) {
+      runningJobs++;
+      [eachJob launch];
+    }
+  }
+}
+
+@end
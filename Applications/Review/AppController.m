@@ -15,9 +15,16 @@
 + (void)initialize
 {
   NSMutableDictionary *defaults = [NSMutableDictionary dictionary];
+  NSUserDefaults      *defs = [NSUserDefaults standardUserDefaults];
 
-  [[NSUserDefaults standardUserDefaults] registerDefaults:defaults];
-  [[NSUserDefaults standardUserDefaults] synchronize];
+  // "CacheSize" used to be a number of images which says nothing about
+  // memory. Old value is replaced by default "CacheMegabytes" budget.
+  if ([defs objectForKey:@"CacheSize"] != nil) {
+    [defs removeObjectForKey:@"CacheSize"];
+  }
+
+  [defs registerDefaults:defaults];
+  [defs synchronize];
 }
 
 - (id)init
@@ -47,7 +54,7 @@
 
 - (void)applicationWillTerminate:(NSNotification *)notification
 {
-  [[NSUserDefaults standardUserDefaults] synchronize];
+  [defs synchronize];
 }
 
 - (BOOL)application:(NSApplication *)application openFile:(NSString *)fileName
@@ -14,24 +14,49 @@
 #import <Foundation/Foundation.h>
 
 @class ImageHolder;
+@class ImageCacheEntry;
 
+// Least recently used image holders up to `maxBytes` of decoded pixels.
+// Methods are thread safe.
 @interface ImageCache : NSObject
 {
-    NSMutableDictionary *cache;
-    NSMutableArray *accessList;
-    unsigned int maxImages;
+  NSMutableDictionary *cache;
+  ImageCacheEntry     *newest;
+  ImageCacheEntry     *oldest;
+  NSUInteger          usedBytes;
+  NSUInteger          maxBytes;
+  NSRecursiveLock     *lock;
+
+  NSOperationQueue    *prefetchQueue;
+  NSString            *listedDirectory;
+  NSDate              *listedDate;
+  NSArray             *listedFiles;
 }
 
 + (ImageCache *)sharedCache;
+// Budget from "CacheMegabytes" default
++ (NSUInteger)cacheMegabytes;
 
 - (ImageHolder *)imageHolderForKey:(id)key;
 - (void)cacheImageHolder:(ImageHolder *)object forKey:(id)key;
 
-- (void)setMaxImages:(unsigned int)cnt;
-- (unsigned int)maxImages;
+// Returns cached holder for image file or decodes and caches it.
+// Cached holder is dropped if file was modified.
+- (ImageHolder *)imageHolderForPath:(NSString *)path;
+
+- (void)setMaxBytes:(NSUInteger)bytes;
+- (void)setMaxMegabytes:(unsigned long long)megabytes;
+- (NSUInteger)maxBytes;
+- (NSUInteger)usedBytes;
 
 - (void)removeOldestElementsFromCache:(int)num;
 
+// Image file which follows (`offset` > 0) or precedes `path` in its
+// directory or nil.
+- (NSString *)imagePathNextTo:(NSString *)path offset:(NSInteger)offset;
+// Decodes next and previous images of directory in background.
+- (void)prefetchImagesAroundPath:(NSString *)path;
+
 @end
 
 #endif // _IMAGECACHE_H_
@@ -8,99 +8,324 @@
  * $Id: ImageCache.m,v 1.5 2001/11/18 14:34:46 probert Exp $
  */
 
+#import <AppKit/NSImage.h>
+
 #import "ImageCache.h"
 #import "ImageHolder.h"
 
+// Default budget of decoded pixels in megabytes ("CacheMegabytes" default)
+#define DEFAULT_CACHE_SIZE 256
+
+// Node of LRU list
+@interface ImageCacheEntry : NSObject
+{
+@public
+  id              key;
+  ImageHolder     *holder;
+  ImageCacheEntry *newer;  // not retained
+  ImageCacheEntry *older;  // not retained
+}
+@end
+@implementation ImageCacheEntry
+- (void)dealloc
+{
+  RELEASE(key);
+  RELEASE(holder);
+  [super dealloc];
+}
+@end
+
+@interface ImagePrefetchOperation : NSOperation
+{
+  NSString *path;
+}
+- (id)initWithPath:(NSString *)aPath;
+@end
+@implementation ImagePrefetchOperation
+- (id)initWithPath:(NSString *)aPath
+{
+  if ((self = [super init])) {
+    path = [aPath copy];
+  }
+  return self;
+}
+- (void)dealloc
+{
+  RELEASE(path);
+  [super dealloc];
+}
+- (void)main
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  if ([self isCancelled] == NO) {
+    [[ImageCache sharedCache] imageHolderForPath:path];
+  }
+  RELEASE(pool);
+}
+@end
+
 @implementation ImageCache
 
 static ImageCache *_imgCache = nil;
 
 + (ImageCache *)sharedCache;
 {
-  if( _imgCache == nil )
-	{
-	  _imgCache = [[ImageCache alloc] init];
-	}
+  if (_imgCache == nil) {
+    _imgCache = [[ImageCache alloc] init];
+  }
 
   return _imgCache;
 }
 
-- (id)init
++ (NSUInteger)cacheMegabytes
 {
-  if( self = [super init])
-	{
-	  maxImages = 50;
+  NSUserDefaults *defs = [NSUserDefaults standardUserDefaults];
+  NSString *size;
 
-	  cache = [[NSMutableDictionary alloc] init];
-	  accessList = [[NSMutableArray alloc] initWithCapacity:maxImages];
-    }
+  size = [defs objectForKey:@"CacheMegabytes"];
+  if (size == nil || [size longLongValue] <= 0) {
+    return DEFAULT_CACHE_SIZE;
+  }
+  return (NSUInteger)MIN((unsigned long long)[size longLongValue], NSUIntegerMax / (1024 * 1024));
+}
+
+- (id)init
+{
+  if ((self = [super init])) {
+    cache = [[NSMutableDictionary alloc] init];
+    lock = [[NSRecursiveLock alloc] init];
+    [self setMaxMegabytes:[ImageCache cacheMegabytes]];
+    prefetchQueue = [[NSOperationQueue alloc] init];
+    [prefetchQueue setMaxConcurrentOperationCount:1];
+  }
 
   return self;
 }
 
 - (void)dealloc
 {
+  [prefetchQueue cancelAllOperations];
+  RELEASE(prefetchQueue);
   RELEASE(cache);
-  RELEASE(accessList);
+  RELEASE(lock);
+  RELEASE(listedDirectory);
+  RELEASE(listedDate);
+  RELEASE(listedFiles);
 
   [super dealloc];
 }
 
+// --- LRU list. Called with lock held.
+
+- (void)_unlinkEntry:(ImageCacheEntry *)entry
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    newest = entry->older;
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    oldest = entry->newer;
+  entry->newer = entry->older = nil;
+}
+
+- (void)_insertNewestEntry:(ImageCacheEntry *)entry
+{
+  entry->older = newest;
+  entry->newer = nil;
+  if (newest)
+    newest->newer = entry;
+  newest = entry;
+  if (oldest == nil)
+    oldest = entry;
+}
+
+- (void)_removeEntry:(ImageCacheEntry *)entry
+{
+  RETAIN(entry);
+  [self _unlinkEntry:entry];
+  usedBytes -= [entry->holder cost];
+  [cache removeObjectForKey:entry->key];
+  RELEASE(entry);
+}
+
+// Keeps at least the newest entry even if it is bigger than budget
+- (void)_trimToBudget
+{
+  while (usedBytes > maxBytes && oldest != nil && oldest != newest) {
+    [self _removeEntry:oldest];
+  }
+}
+
+// ---
+
 - (ImageHolder *)imageHolderForKey:(id)key
 {
-  ImageHolder *obj = [cache objectForKey:key];
+  ImageCacheEntry *entry;
+  ImageHolder *obj = nil;
 
-  if([accessList containsObject:key])
-	{
-	  [accessList removeObject:key];
-	}
-  [accessList addObject:key];
+  [lock lock];
+  entry = [cache objectForKey:key];
+  if (entry != nil) {
+    [self _unlinkEntry:entry];
+    [self _insertNewestEntry:entry];
+    obj = AUTORELEASE(RETAIN(entry->holder));
+  }
+  [lock unlock];
 
   return obj;
 }
 
 - (void)cacheImageHolder:(ImageHolder *)object forKey:(id)key
 {
-  [cache setObject:object forKey:key];
+  ImageCacheEntry *entry;
+
+  [lock lock];
+  entry = [cache objectForKey:key];
+  if (entry != nil) {
+    [self _removeEntry:entry];
+  }
+
+  entry = [ImageCacheEntry new];
+  entry->key = [key copy];
+  entry->holder = RETAIN(object);
+  [cache setObject:entry forKey:entry->key];
+  RELEASE(entry);
+  [self _insertNewestEntry:entry];
+  usedBytes += [object cost];
 
-  if( [cache count] > maxImages )
-	{
-	  [self removeOldestElementsFromCache:1];
-	}
+  [self _trimToBudget];
+  [lock unlock];
 }
 
-- (void)setMaxImages:(unsigned int)cnt
+- (ImageHolder *)imageHolderForPath:(NSString *)path
 {
-  if( cnt < maxImages )
-	{
-	  [self removeOldestElementsFromCache:(maxImages - cnt)];
+  ImageHolder *holder = [self imageHolderForKey:path];
+  NSDictionary *attrs;
+
+  if (holder != nil) {
+    attrs = [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:YES];
+    if ([[attrs fileModificationDate]
+            isEqualToDate:[[holder attributes] fileModificationDate]]) {
+      return holder;
     }
+  }
+
+  holder = [[ImageHolder alloc] initWithContentsOfFile:path];
+  if (holder != nil) {
+    [self cacheImageHolder:holder forKey:path];
+  }
 
-  maxImages = cnt;
+  return AUTORELEASE(holder);
+}
+
+- (void)setMaxBytes:(NSUInteger)bytes
+{
+  [lock lock];
+  maxBytes = bytes;
+  [self _trimToBudget];
+  [lock unlock];
 }
 
-- (unsigned int)maxImages
+- (void)setMaxMegabytes:(unsigned long long)megabytes
 {
-  return maxImages;
+  if (megabytes > NSUIntegerMax / (1024 * 1024)) {
+    [self setMaxBytes:NSUIntegerMax];
+  } else {
+    [self setMaxBytes:(NSUInteger)megabytes * 1024 * 1024];
+  }
+}
+
+- (NSUInteger)maxBytes
+{
+  return maxBytes;
+}
+
+- (NSUInteger)usedBytes
+{
+  return usedBytes;
 }
 
 - (void)removeOldestElementsFromCache:(int)num
 {
-  int i;
-  int n = [accessList count];
+  [lock lock];
+  while (num-- > 0 && oldest != nil) {
+    [self _removeEntry:oldest];
+  }
+  [lock unlock];
+}
 
-  if( n < num )
-	{
-	  num = n;
-    }
+// --- Browsing
 
-  for( i=0; i<num; i++ )
-	{
-	  id key = [accessList objectAtIndex:0];
+- (NSArray *)_imageFilesInDirectory:(NSString *)dir
+{
+  NSFileManager *fm = [NSFileManager defaultManager];
+  NSDate *date = [[fm fileAttributesAtPath:dir traverseLink:YES] fileModificationDate];
+  NSArray *types;
+  NSMutableArray *files;
+  NSArray *result;
 
-	  [cache removeObjectForKey:key];
-	  [accessList removeObjectAtIndex:0];
+  [lock lock];
+  if ([dir isEqualToString:listedDirectory] && [date isEqualToDate:listedDate]) {
+    result = AUTORELEASE(RETAIN(listedFiles));
+    [lock unlock];
+    return result;
+  }
+  [lock unlock];
+
+  types = [NSImage imageFileTypes];
+  files = [NSMutableArray array];
+  for (NSString *file in [fm directoryContentsAtPath:dir]) {
+    if ([file hasPrefix:@"."] == NO &&
+        [types containsObject:[[file pathExtension] lowercaseString]]) {
+      [files addObject:file];
     }
+  }
+  [files sortUsingSelector:@selector(localizedStandardCompare:)];
+
+  [lock lock];
+  ASSIGN(listedDirectory, dir);
+  ASSIGN(listedDate, date);
+  ASSIGN(listedFiles, files);
+  [lock unlock];
+
+  return files;
+}
+
+- (NSString *)imagePathNextTo:(NSString *)path offset:(NSInteger)offset
+{
+  NSString *dir = [path stringByDeletingLastPathComponent];
+  NSArray *files = [self _imageFilesInDirectory:dir];
+  NSUInteger index = [files indexOfObject:[path lastPathComponent]];
+
+  if (index == NSNotFound || (NSInteger)index + offset < 0 ||
+      (NSInteger)index + offset >= (NSInteger)[files count]) {
+    return nil;
+  }
+
+  return [dir stringByAppendingPathComponent:[files objectAtIndex:index + offset]];
+}
+
+- (void)prefetchImagesAroundPath:(NSString *)path
+{
+  NSString *next = [self imagePathNextTo:path offset:1];
+  NSString *previous = [self imagePathNextTo:path offset:-1];
+  ImagePrefetchOperation *op;
+
+  // Only neighbours of the latest image are interesting
+  [prefetchQueue cancelAllOperations];
+
+  if (next != nil) {
+    op = [[ImagePrefetchOperation alloc] initWithPath:next];
+    [prefetchQueue addOperation:op];
+    RELEASE(op);
+  }
+  if (previous != nil) {
+    op = [[ImagePrefetchOperation alloc] initWithPath:previous];
+    [prefetchQueue addOperation:op];
+    RELEASE(op);
+  }
 }
 
 @end
@@ -18,15 +18,22 @@
 @interface ImageHolder : NSObject
 {
     NSImage *image;
+    NSImage *preview;
     NSArray *imageReps;
     NSDictionary *attributes;
+    NSUInteger cost;
 }
 
 - (id)initWithImage:(NSImage*)img reps:(NSArray *)r attributes:(NSDictionary*)d;
+// Decodes image file. May be called from background thread.
+- (id)initWithContentsOfFile:(NSString *)path;
 
 - (NSImage *)image;
+- (NSImage *)preview;
 - (NSArray *)imageReps;
 - (NSDictionary *)attributes;
+// Bytes of decoded pixels
+- (NSUInteger)cost;
 
 @end
 
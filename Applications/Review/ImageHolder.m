@@ -9,7 +9,27 @@
  */
 
 #import "ImageHolder.h"
+#import "TiledImageView.h"
 #import <AppKit/NSImage.h>
+#import <AppKit/NSBitmapImageRep.h>
+
+// Longest side of preview shown instead of large image
+#define PREVIEW_SIZE 1024
+
+static NSUInteger _costOfReps(NSArray *reps)
+{
+    NSUInteger bytes = 0;
+
+    for (NSImageRep *r in reps) {
+        if ([r isKindOfClass:[NSBitmapImageRep class]]) {
+            NSBitmapImageRep *b = (NSBitmapImageRep *)r;
+            NSUInteger planes = [b isPlanar] ? [b samplesPerPixel] : 1;
+
+            bytes += [b bytesPerRow] * [b pixelsHigh] * planes;
+        }
+    }
+    return bytes;
+}
 
 @implementation ImageHolder
 
@@ -19,6 +39,31 @@
         image = RETAIN(img);
         imageReps = RETAIN(r);
         attributes = RETAIN(d);
+        cost = _costOfReps(r);
+    }
+    return self;
+}
+
+- (id)initWithContentsOfFile:(NSString *)path
+{
+    NSArray *reps = [NSImageRep imageRepsWithContentsOfFile:path];
+    NSDictionary *attrs;
+    NSBitmapImageRep *previewRep;
+
+    if ([reps count] == 0) {
+        RELEASE(self);
+        return nil;
+    }
+    attrs = [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:YES];
+
+    if ((self = [self initWithImage:nil reps:reps attributes:attrs])) {
+        previewRep = [TiledImageView previewForImageRep:[reps objectAtIndex:0]
+                                                maxSide:PREVIEW_SIZE];
+        if (previewRep != nil) {
+            preview = [[NSImage alloc] initWithSize:[previewRep size]];
+            [preview addRepresentation:previewRep];
+            cost += _costOfReps([NSArray arrayWithObject:previewRep]);
+        }
     }
     return self;
 }
@@ -26,6 +71,7 @@
 - (void)dealloc
 {
     RELEASE(image);
+    RELEASE(preview);
     RELEASE(imageReps);
     RELEASE(attributes);
 
@@ -37,6 +83,11 @@
     return image;
 }
 
+- (NSImage *)preview
+{
+    return preview;
+}
+
 - (NSArray *)imageReps;
 {
     return imageReps;
@@ -47,4 +98,9 @@
     return attributes;
 }
 
+- (NSUInteger)cost
+{
+    return cost;
+}
+
 @end
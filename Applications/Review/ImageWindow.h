@@ -11,6 +11,8 @@
 #import <AppKit/AppKit.h>
 #import "ImageShowing.h"
 
+@class TiledImageView;
+
 @interface ImageWindow : NSObject <ImageShowing>
 {
   id            delegate;
@@ -20,8 +22,12 @@
   NSSize        imageSize;
   NSImageRep    *rep;
   int           reps;
+  TiledImageView *imageView;
   NSPopUpButton *scalePopup;
   NSBox         *box;
+
+  NSOperationQueue *loadQueue;
+  NSUInteger       loadGeneration;  // of latest _openPath:
 }
 
 - (id)initWithContentsOfFile:(NSString *)path;
@@ -29,6 +35,9 @@
 - (id)delegate;
 - (void)setDelegate:(id)aDelegate;
 
+- (void)showNextImage:(id)sender;
+- (void)showPreviousImage:(id)sender;
+
 - (void)windowWillClose:(NSNotification *)notif;
 - (void)windowDidBecomeKey:(NSNotification *)aNotification;
 
@@ -4,6 +4,8 @@
 
 #import "ImageWindow.h"
 #import "ImageCache.h"
+#import "ImageHolder.h"
+#import "TiledImageView.h"
 #import "Inspector.h"
 #import <AppKit/PSOperators.h>
 
@@ -65,6 +67,98 @@
 @end
 
 //------------------------------------------------------------------------
+@interface ImageWindow (Private)
+- (void)_openPath:(NSString *)path;
+- (BOOL)_isCurrentLoad:(NSDictionary *)info;
+- (void)_previewDidLoad:(NSDictionary *)info;
+- (void)_imageDidLoad:(NSDictionary *)info;
+- (void)_imageDidFailToLoad:(NSDictionary *)info;
+- (void)_sizeWindowToImage;
+- (void)scaleChanged:(id)sender;
+@end
+
+// Decodes image (or takes it from cache) and hands preview and then full
+// image to the window on main thread. Results are tagged with the load
+// generation so the window can drop the ones it no longer waits for.
+@interface ImageLoadOperation : NSOperation
+{
+  ImageWindow *imageWindow;
+  NSString    *path;
+  NSUInteger  generation;
+}
+- (id)initWithWindow:(ImageWindow *)aWindow path:(NSString *)aPath generation:(NSUInteger)gen;
+@end
+
+@implementation ImageLoadOperation
+
+- (id)initWithWindow:(ImageWindow *)aWindow path:(NSString *)aPath generation:(NSUInteger)gen
+{
+  if ((self = [super init])) {
+    imageWindow = RETAIN(aWindow);
+    path = [aPath copy];
+    generation = gen;
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  RELEASE(imageWindow);
+  RELEASE(path);
+  [super dealloc];
+}
+
+- (void)main
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSNumber *gen = [NSNumber numberWithUnsignedInteger:generation];
+  ImageHolder *holder;
+  NSDictionary *info;
+
+  // Another image was requested while this one was waiting
+  if ([self isCancelled]) {
+    RELEASE(pool);
+    return;
+  }
+
+  holder = [[ImageCache sharedCache] imageHolderForPath:path];
+  if ([self isCancelled]) {
+    RELEASE(pool);
+    return;
+  }
+
+  if (holder == nil) {
+    info = [NSDictionary dictionaryWithObjectsAndKeys:path, @"Path", gen, @"Generation", nil];
+    [imageWindow performSelectorOnMainThread:@selector(_imageDidFailToLoad:)
+                                  withObject:info
+                               waitUntilDone:NO];
+    RELEASE(pool);
+    return;
+  }
+
+  if ([holder preview] != nil) {
+    info = [NSDictionary dictionaryWithObjectsAndKeys:
+                             gen, @"Generation",
+                             [holder preview], @"Preview",
+                             [NSValue valueWithSize:[[[holder imageReps] objectAtIndex:0] size]],
+                             @"Size", nil];
+    [imageWindow performSelectorOnMainThread:@selector(_previewDidLoad:)
+                                  withObject:info
+                               waitUntilDone:NO];
+  }
+
+  info = [NSDictionary dictionaryWithObjectsAndKeys:
+                           gen, @"Generation",
+                           [holder imageReps], @"Reps",
+                           [holder preview], @"Preview", nil];
+  [imageWindow performSelectorOnMainThread:@selector(_imageDidLoad:)
+                                withObject:info
+                             waitUntilDone:NO];
+  RELEASE(pool);
+}
+
+@end
+
 @implementation ImageWindow
 
 - (id)initWithContentsOfFile:(NSString *)path
@@ -72,49 +166,15 @@
   NSAssert(path, @"No path specified!");
 
   if ((self = [super init])) {
-    NSRect frame = NSMakeRect(0, 0, 0, 0);
+    NSRect frame = NSMakeRect(0, 0, 400, 300);
     RScrollView *scrollView = nil;
-    NSImageView *imageView = nil;
-    NSImage *image;
-    NSArray *array;
     int wMask = (NSTitledWindowMask | NSClosableWindowMask | NSMiniaturizableWindowMask |
                  NSResizableWindowMask);
 
-    attr = [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:NO];
-    RETAIN(attr);
-
-    // Image loading
-    imagePath = [path copy];
-    if (!(image = [[NSImage alloc] initWithContentsOfFile:path])) {
-      NSRunAlertPanel(@"Open file", @"File %@ doesn't contain image %@", @"Dismiss", nil, nil, path,
-                      image);
-      return nil;
-    }
-
-    // Image
-    [image setBackgroundColor:[NSColor lightGrayColor]];
-    array = [image representations];
-    reps = [array count];
-    rep = [array objectAtIndex:0];
+    // ImageView and ScrollView. Image is decoded in background and
+    // shown when ready.
+    imageView = [[TiledImageView alloc] initWithFrame:NSZeroRect];
 
-    if (rep == nil) {
-      return nil;
-    }
-    [rep retain];
-
-    imageSize = [image size];
-    frame.size = imageSize;
-
-    // ImageView and ScrollView
-    imageView = [[NSImageView alloc] initWithFrame:frame];
-    [imageView setEditable:NO];
-    [imageView setImage:image];
-    RELEASE(image);
-
-    frame.size = [NSScrollView frameSizeForContentSize:[imageView frame].size
-                                 hasHorizontalScroller:YES
-                                   hasVerticalScroller:YES
-                                            borderType:NSNoBorder];
     scrollView = [[RScrollView alloc] initWithFrame:frame];
     [scrollView setHasVerticalScroller:YES];
     [scrollView setHasHorizontalScroller:YES];
@@ -152,6 +212,8 @@
     [scalePopup addItemWithTitle:@"700%"];
     [scalePopup setAutoresizingMask:(NSViewMaxYMargin | NSViewMinXMargin)];
     [scalePopup selectItemWithTitle:@"100%"];
+    [scalePopup setTarget:self];
+    [scalePopup setAction:@selector(scaleChanged:)];
     [scrollView setScaleView:scalePopup];
     [scrollView tile];
 
@@ -162,33 +224,25 @@
 
     // Window
     frame = [NSWindow frameRectForContentRect:frame styleMask:wMask];
-    if (imageSize.width > ([[NSScreen mainScreen] frame].size.width - 64)) {
-      frame.size.width = [[NSScreen mainScreen] frame].size.width - 164;
-    }
-    if (imageSize.height > ([[NSScreen mainScreen] frame].size.height - 64)) {
-      frame.size.height = [[NSScreen mainScreen] frame].size.height - 64;
-    }
-    if (frame.size.width < 100)
-      frame.size.width = 100;
-    if (frame.size.height < 100)
-      frame.size.height = 100;
-
     window = [[NSWindow alloc] initWithContentRect:frame
                                          styleMask:wMask
-                                           backing:NSBackingStoreRetained
+                                           backing:NSBackingStoreBuffered
                                              defer:YES];
     [window setReleasedWhenClosed:YES];
     [window setDelegate:self];
     [window setFrame:frame display:YES];
-    [window setMaxSize:frame.size];
     [window setMinSize:NSMakeSize(100, 100)];
     [window setContentView:box];
     RELEASE(box);
-    [window setTitleWithRepresentedFilename:path];
     [window setReleasedWhenClosed:YES];
 
     [window center];
     [window makeKeyAndOrderFront:nil];
+
+    // Only the latest image is loaded while flipping through directory
+    loadQueue = [[NSOperationQueue alloc] init];
+    [loadQueue setMaxConcurrentOperationCount:1];
+    [self _openPath:path];
     [window display];
   }
 
@@ -197,6 +251,8 @@
 
 - (void)dealloc
 {
+  [loadQueue cancelAllOperations];
+  RELEASE(loadQueue);
   RELEASE(window);
   RELEASE(imagePath);
   RELEASE(attr);
@@ -205,6 +261,24 @@
   [super dealloc];
 }
 
+- (void)showNextImage:(id)sender
+{
+  NSString *path = [[ImageCache sharedCache] imagePathNextTo:imagePath offset:1];
+
+  if (path != nil) {
+    [self _openPath:path];
+  }
+}
+
+- (void)showPreviousImage:(id)sender
+{
+  NSString *path = [[ImageCache sharedCache] imagePathNextTo:imagePath offset:-1];
+
+  if (path != nil) {
+    [self _openPath:path];
+  }
+}
+
 - (id)delegate
 {
   return delegate;
@@ -307,3 +381,116 @@
 }
 
 @end
+
+//------------------------------------------------------------------------
+@implementation ImageWindow (Private)
+
+- (void)_openPath:(NSString *)path
+{
+  ImageLoadOperation *op;
+
+  ASSIGN(imagePath, path);
+  ASSIGN(attr, [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:NO]);
+  [window setTitleWithRepresentedFilename:path];
+
+  // Decoded image may be in cache already (e.g. prefetched). Image which
+  // is being decoded can't be interrupted, its result is dropped.
+  loadGeneration++;
+  [loadQueue cancelAllOperations];
+  op = [[ImageLoadOperation alloc] initWithWindow:self path:path generation:loadGeneration];
+  [loadQueue addOperation:op];
+  RELEASE(op);
+}
+
+// Window was closed or another image was opened meanwhile
+- (BOOL)_isCurrentLoad:(NSDictionary *)info
+{
+  return (window != nil &&
+          [[info objectForKey:@"Generation"] unsignedIntegerValue] == loadGeneration);
+}
+
+- (void)_previewDidLoad:(NSDictionary *)info
+{
+  if ([self _isCurrentLoad:info] == NO) {
+    return;
+  }
+  imageSize = [[info objectForKey:@"Size"] sizeValue];
+  [imageView setPreview:[info objectForKey:@"Preview"] imageSize:imageSize];
+  // Window keeps its frame while browsing through directory
+  if (rep == nil) {
+    [self _sizeWindowToImage];
+  }
+}
+
+- (void)_imageDidLoad:(NSDictionary *)info
+{
+  NSArray *imageReps = [info objectForKey:@"Reps"];
+  NSImage *preview = [info objectForKey:@"Preview"];
+  BOOL firstImage = (rep == nil);
+
+  if ([self _isCurrentLoad:info] == NO) {
+    return;
+  }
+
+  reps = [imageReps count];
+  ASSIGN(rep, [imageReps objectAtIndex:0]);
+  imageSize = [rep size];
+  [imageView setImageRep:rep preview:preview];
+  // Window was sized to preview already
+  if (firstImage && preview == nil) {
+    [self _sizeWindowToImage];
+  }
+
+  if ([window isKeyWindow]) {
+    [[Inspector sharedInspector] imageWindowDidBecomeActive:self];
+  }
+
+  [[ImageCache sharedCache] prefetchImagesAroundPath:imagePath];
+}
+
+- (void)_imageDidFailToLoad:(NSDictionary *)info
+{
+  if ([self _isCurrentLoad:info] == NO) {
+    return;
+  }
+  NSRunAlertPanel(@"Open file", @"File %@ doesn't contain image", @"Dismiss", nil, nil,
+                  imagePath);
+  if (rep == nil) {
+    [window close];
+  }
+}
+
+- (void)_sizeWindowToImage
+{
+  NSRect frame = NSZeroRect;
+  NSRect screenFrame = [[NSScreen mainScreen] frame];
+  int wMask = [window styleMask];
+
+  frame.size = [NSScrollView frameSizeForContentSize:[imageView frame].size
+                               hasHorizontalScroller:YES
+                                 hasVerticalScroller:YES
+                                          borderType:NSNoBorder];
+  frame = [NSWindow frameRectForContentRect:frame styleMask:wMask];
+  if (imageSize.width > (screenFrame.size.width - 64)) {
+    frame.size.width = screenFrame.size.width - 164;
+  }
+  if (imageSize.height > (screenFrame.size.height - 64)) {
+    frame.size.height = screenFrame.size.height - 64;
+  }
+  if (frame.size.width < 100)
+    frame.size.width = 100;
+  if (frame.size.height < 100)
+    frame.size.height = 100;
+
+  [window setMaxSize:frame.size];
+  [window setFrame:frame display:NO];
+  [window center];
+  [window display];
+}
+
+- (void)scaleChanged:(id)sender
+{
+  [imageView setScale:[[sender titleOfSelectedItem] intValue] / 100.0];
+}
+
+@end
@@ -56,7 +56,7 @@
     [box addSubview:textField];
     RELEASE(textField);
 
-    rect = NSMakeRect(92, 16, 124, 21);
+    rect = NSMakeRect(92, 16, 96, 21);
     cacheSizeField = [[NSTextField alloc] initWithFrame:rect];
     [cacheSizeField setAlignment:NSRightTextAlignment];
     [cacheSizeField setBordered:NO];
@@ -68,6 +68,15 @@
     [box addSubview:cacheSizeField];
     RELEASE(cacheSizeField);
 
+    textField = [[NSTextField alloc] initWithFrame:NSMakeRect(192, 16, 28, 21)];
+    [textField setBordered:NO];
+    [textField setEditable:NO];
+    [textField setBezeled:NO];
+    [textField setDrawsBackground:NO];
+    [textField setStringValue:@"MB"];
+    [box addSubview:textField];
+    RELEASE(textField);
+
     rect = NSMakeRect(32, 144, 220, 15);
     openRecursive = [[NSButton alloc] initWithFrame:rect];
     [openRecursive setTitle:@"Open path recursively"];
@@ -126,8 +135,11 @@
     [preferences setFrameUsingName:@"Preferences"];
   }
 
-  string = [prefDict objectForKey:@"CacheSize"];
-  [cacheSizeField setStringValue:(string) ? string : @"50"];
+  string = [prefDict objectForKey:@"CacheMegabytes"];
+  if (string == nil) {
+    string = [NSString stringWithFormat:@"%lu", (unsigned long)[ImageCache cacheMegabytes]];
+  }
+  [cacheSizeField setStringValue:string];
 
   string = [prefDict objectForKey:@"OpenRec"];
   [openRecursive setState:([string isEqualToString:@"YES"]) ? NSOnState : NSOffState];
@@ -139,7 +151,7 @@
 {
   NSString *val = [cacheSizeField stringValue];
 
-  [prefDict setObject:val forKey:@"CacheSize"];
+  [prefDict setObject:val forKey:@"CacheMegabytes"];
   [preferences setDocumentEdited:YES];
 }
 
@@ -178,8 +190,8 @@
 {
   NSString *string;
 
-  string = [[NSUserDefaults standardUserDefaults] objectForKey:@"CacheSize"];
-  [cacheSizeField setStringValue:(string) ? string : @"50"];
+  string = [NSString stringWithFormat:@"%lu", (unsigned long)[ImageCache cacheMegabytes]];
+  [cacheSizeField setStringValue:string];
 
   [openRecursive setState:([[[NSUserDefaults standardUserDefaults] objectForKey:@"OpenRec"]
                               isEqualToString:@"YES"])
@@ -189,10 +201,10 @@
 
 - (void)setPreferences
 {
-  NSString *string = [prefDict objectForKey:@"CacheSize"];
+  NSString *string = [prefDict objectForKey:@"CacheMegabytes"];
 
-  [[NSUserDefaults standardUserDefaults] setObject:string forKey:@"CacheSize"];
-  [[ImageCache sharedCache] setMaxImages:[string intValue]];
+  [[NSUserDefaults standardUserDefaults] setObject:string forKey:@"CacheMegabytes"];
+  [[ImageCache sharedCache] setMaxMegabytes:[ImageCache cacheMegabytes]];
 
   string = [prefDict objectForKey:@"OpenRec"];
   [[NSUserDefaults standardUserDefaults] setObject:string forKey:@"OpenRec"];
@@ -0,0 +1,33 @@
+/*
+ * TiledImageView.h
+ *
+ * Displays large images: draws downsampled preview while image is small
+ * on screen and renders visible tiles of full resolution image otherwise.
+ */
+
+#import <AppKit/AppKit.h>
+
+@interface TiledImageView : NSView
+{
+  NSImageRep          *rep;
+  NSImage             *preview;
+  NSSize              imageSize;
+  CGFloat             scale;
+  NSMutableDictionary *tiles;
+  NSMutableArray      *tileKeys;
+}
+
+// Returns downsampled copy of `aRep` which fits into `maxSide` pixels or nil
+// if rep can't be downsampled. Safe to call from background thread.
++ (NSBitmapImageRep *)previewForImageRep:(NSImageRep *)aRep maxSide:(NSUInteger)maxSide;
+
+// `aPreview` is shown until full resolution rep is set.
+- (void)setPreview:(NSImage *)aPreview imageSize:(NSSize)size;
+// `aPreview` (may be nil) is drawn instead of `aRep` while it is big enough.
+- (void)setImageRep:(NSImageRep *)aRep preview:(NSImage *)aPreview;
+- (NSImageRep *)imageRep;
+
+- (void)setScale:(CGFloat)aScale;
+- (CGFloat)scale;
+
+@end
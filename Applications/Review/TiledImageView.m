@@ -0,0 +1,300 @@
+/*
+ * TiledImageView.m
+ */
+
+#import "TiledImageView.h"
+
+// Size of the tile on screen
+#define TILE_SIZE 256
+// Number of rendered tiles kept for scrolling at current scale
+#define MAX_TILES 64
+
+// Area-averaging downsample of 8 bits per sample meshed bitmap.
+static void _downsample(const unsigned char *src, NSInteger sw, NSInteger sh, NSInteger sbpr,
+                        unsigned char *dst, NSInteger dw, NSInteger dh, NSInteger dbpr,
+                        NSInteger spp, NSInteger sbpp)
+{
+  unsigned long sums[8];
+  NSInteger x, y, sx, sy, s;
+
+  for (y = 0; y < dh; y++) {
+    NSInteger y0 = y * sh / dh;
+    NSInteger y1 = MAX((y + 1) * sh / dh, y0 + 1);
+    unsigned char *out = dst + y * dbpr;
+
+    for (x = 0; x < dw; x++) {
+      NSInteger x0 = x * sw / dw;
+      NSInteger x1 = MAX((x + 1) * sw / dw, x0 + 1);
+      unsigned long count = (x1 - x0) * (y1 - y0);
+
+      memset(sums, 0, sizeof(sums));
+      for (sy = y0; sy < y1; sy++) {
+        const unsigned char *in = src + sy * sbpr + x0 * sbpp;
+        for (sx = x0; sx < x1; sx++, in += sbpp) {
+          for (s = 0; s < spp; s++) {
+            sums[s] += in[s];
+          }
+        }
+      }
+      for (s = 0; s < spp; s++) {
+        *out++ = sums[s] / count;
+      }
+    }
+  }
+}
+
+static BOOL _isTileable(NSImageRep *aRep)
+{
+  NSBitmapImageRep *bitmap = (NSBitmapImageRep *)aRep;
+
+  return ([aRep isKindOfClass:[NSBitmapImageRep class]] && [bitmap isPlanar] == NO &&
+          ([bitmap bitsPerPixel] % 8) == 0 && [bitmap bitmapData] != NULL);
+}
+
+@implementation TiledImageView
+
++ (NSBitmapImageRep *)previewForImageRep:(NSImageRep *)aRep maxSide:(NSUInteger)maxSide
+{
+  NSBitmapImageRep *bitmap = (NSBitmapImageRep *)aRep;
+  NSBitmapImageRep *previewRep;
+  NSInteger width = [aRep pixelsWide];
+  NSInteger height = [aRep pixelsHigh];
+  NSInteger pWidth, pHeight;
+  NSInteger spp;
+
+  if (_isTileable(aRep) == NO || [bitmap bitsPerSample] != 8) {
+    return nil;
+  }
+  spp = [bitmap samplesPerPixel];
+  if (spp > 8 || [bitmap bitsPerPixel] < spp * 8) {
+    return nil;
+  }
+  if (width <= (NSInteger)maxSide && height <= (NSInteger)maxSide) {
+    return nil;  // full image is small enough
+  }
+
+  if (width > height) {
+    pWidth = maxSide;
+    pHeight = MAX(1, height * maxSide / width);
+  } else {
+    pHeight = maxSide;
+    pWidth = MAX(1, width * maxSide / height);
+  }
+
+  previewRep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+                                                       pixelsWide:pWidth
+                                                       pixelsHigh:pHeight
+                                                    bitsPerSample:8
+                                                  samplesPerPixel:spp
+                                                         hasAlpha:[bitmap hasAlpha]
+                                                         isPlanar:NO
+                                                   colorSpaceName:[bitmap colorSpaceName]
+                                                     bitmapFormat:[bitmap bitmapFormat]
+                                                      bytesPerRow:0
+                                                     bitsPerPixel:spp * 8];
+  if (previewRep == nil) {
+    return nil;
+  }
+  _downsample([bitmap bitmapData], width, height, [bitmap bytesPerRow], [previewRep bitmapData],
+              pWidth, pHeight, [previewRep bytesPerRow], spp, [bitmap bitsPerPixel] / 8);
+  [previewRep setSize:NSMakeSize(pWidth, pHeight)];
+
+  return AUTORELEASE(previewRep);
+}
+
+- (id)initWithFrame:(NSRect)frameRect
+{
+  if ((self = [super initWithFrame:frameRect])) {
+    scale = 1.0;
+    tiles = [[NSMutableDictionary alloc] init];
+    tileKeys = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  RELEASE(rep);
+  RELEASE(preview);
+  RELEASE(tiles);
+  RELEASE(tileKeys);
+  [super dealloc];
+}
+
+- (BOOL)isOpaque
+{
+  return YES;
+}
+
+- (BOOL)acceptsFirstResponder
+{
+  return YES;
+}
+
+// Space and Backspace flip through images of the directory
+- (void)keyDown:(NSEvent *)theEvent
+{
+  NSString *chars = [theEvent charactersIgnoringModifiers];
+  unichar c = [chars length] > 0 ? [chars characterAtIndex:0] : 0;
+
+  if (c == ' ') {
+    [NSApp sendAction:@selector(showNextImage:) to:nil from:self];
+  } else if (c == NSBackspaceCharacter || c == NSDeleteCharacter) {
+    [NSApp sendAction:@selector(showPreviousImage:) to:nil from:self];
+  } else {
+    [super keyDown:theEvent];
+  }
+}
+
+- (void)_flushTiles
+{
+  [tiles removeAllObjects];
+  [tileKeys removeAllObjects];
+}
+
+- (void)setPreview:(NSImage *)aPreview imageSize:(NSSize)size
+{
+  DESTROY(rep);
+  ASSIGN(preview, aPreview);
+  imageSize = size;
+  [self setScale:scale];
+}
+
+- (void)setImageRep:(NSImageRep *)aRep preview:(NSImage *)aPreview
+{
+  ASSIGN(rep, aRep);
+  ASSIGN(preview, aPreview);
+  imageSize = [rep size];
+  [self setScale:scale];
+}
+
+- (NSImageRep *)imageRep
+{
+  return rep;
+}
+
+- (void)setScale:(CGFloat)aScale
+{
+  scale = aScale;
+  [self _flushTiles];
+  [self setFrameSize:NSMakeSize(floor(imageSize.width * scale + 0.5),
+                                floor(imageSize.height * scale + 0.5))];
+  [self setNeedsDisplay:YES];
+}
+
+- (CGFloat)scale
+{
+  return scale;
+}
+
+// Renders part of full resolution image which falls into tile. Only pixels
+// under the tile are touched - subimage shares bitmap data with `rep`.
+- (NSImage *)_tileAtColumn:(NSInteger)column row:(NSInteger)row
+{
+  NSBitmapImageRep *bitmap = (NSBitmapImageRep *)rep;
+  NSBitmapImageRep *subRep;
+  NSRect bounds = [self bounds];
+  NSRect tileRect, destRect;
+  NSString *key = [NSString stringWithFormat:@"%ld:%ld", (long)column, (long)row];
+  NSImage *tile = [tiles objectForKey:key];
+  NSInteger pixelsWide = [bitmap pixelsWide];
+  NSInteger pixelsHigh = [bitmap pixelsHigh];
+  NSInteger bytesPerPixel = [bitmap bitsPerPixel] / 8;
+  NSInteger x0, x1, y0, y1;
+  CGFloat sx, sy;
+  unsigned char *data;
+
+  if (tile != nil) {
+    return tile;
+  }
+
+  tileRect = NSIntersectionRect(
+      NSMakeRect(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE), bounds);
+  if (NSIsEmptyRect(tileRect)) {
+    return nil;
+  }
+
+  // Pixels per view unit. Bitmap rows go from top to bottom.
+  sx = pixelsWide / NSWidth(bounds);
+  sy = pixelsHigh / NSHeight(bounds);
+  x0 = MAX(0, floor(NSMinX(tileRect) * sx));
+  x1 = MIN(pixelsWide, ceil(NSMaxX(tileRect) * sx));
+  y0 = MAX(0, floor((NSHeight(bounds) - NSMaxY(tileRect)) * sy));
+  y1 = MIN(pixelsHigh, ceil((NSHeight(bounds) - NSMinY(tileRect)) * sy));
+  if (x1 <= x0 || y1 <= y0) {
+    return nil;
+  }
+
+  data = [bitmap bitmapData] + y0 * [bitmap bytesPerRow] + x0 * bytesPerPixel;
+  subRep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes:&data
+                                                   pixelsWide:x1 - x0
+                                                   pixelsHigh:y1 - y0
+                                                bitsPerSample:[bitmap bitsPerSample]
+                                              samplesPerPixel:[bitmap samplesPerPixel]
+                                                     hasAlpha:[bitmap hasAlpha]
+                                                     isPlanar:NO
+                                               colorSpaceName:[bitmap colorSpaceName]
+                                                 bitmapFormat:[bitmap bitmapFormat]
+                                                  bytesPerRow:[bitmap bytesPerRow]
+                                                 bitsPerPixel:[bitmap bitsPerPixel]];
+  destRect = NSMakeRect(x0 / sx - NSMinX(tileRect), (NSHeight(bounds) - y1 / sy) - NSMinY(tileRect),
+                        (x1 - x0) / sx, (y1 - y0) / sy);
+
+  tile = [[NSImage alloc] initWithSize:tileRect.size];
+  [tile lockFocus];
+  [subRep drawInRect:destRect];
+  [tile unlockFocus];
+  RELEASE(subRep);
+
+  if ([tileKeys count] >= MAX_TILES) {
+    [tiles removeObjectForKey:[tileKeys objectAtIndex:0]];
+    [tileKeys removeObjectAtIndex:0];
+  }
+  [tiles setObject:tile forKey:key];
+  [tileKeys addObject:key];
+
+  return AUTORELEASE(tile);
+}
+
+- (void)drawRect:(NSRect)rect
+{
+  NSRect bounds = [self bounds];
+  NSInteger column, row;
+  NSInteger firstColumn, lastColumn, firstRow, lastRow;
+
+  [[NSColor lightGrayColor] set];
+  NSRectFill(rect);
+
+  // Preview is good enough while image is not bigger on screen
+  if (preview != nil && (rep == nil || NSWidth(bounds) <= [preview size].width)) {
+    [preview drawInRect:bounds fromRect:NSZeroRect operation:NSCompositeSourceOver fraction:1.0];
+    return;
+  }
+  if (rep == nil) {
+    return;
+  }
+  if (_isTileable(rep) == NO) {
+    [rep drawInRect:bounds];
+    return;
+  }
+
+  firstColumn = floor(NSMinX(rect) / TILE_SIZE);
+  lastColumn = ceil(NSMaxX(rect) / TILE_SIZE);
+  firstRow = floor(NSMinY(rect) / TILE_SIZE);
+  lastRow = ceil(NSMaxY(rect) / TILE_SIZE);
+
+  for (row = firstRow; row < lastRow; row++) {
+    for (column = firstColumn; column < lastColumn; column++) {
+      NSImage *tile = [self _tileAtColumn:column row:row];
+
+      if (tile != nil) {
+        [tile drawAtPoint:NSMakePoint(column * TILE_SIZE, row * TILE_SIZE)
+                 fromRect:NSZeroRect
+                operation:NSCompositeSourceOver
+                 fraction:1.0];
+      }
+    }
+  }
+}
+
+@end
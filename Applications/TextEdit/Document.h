@@ -35,6 +35,7 @@ extern void SetUpEncodingPopupButton(NSPopUpButton *popup, int selectedEncoding,
   BOOL	isDocumentEdited;
   BOOL	hasMultiplePages;
   BOOL	isRichText;
+  BOOL	isLargeFile;
   int	encodingIfPlainText;
 }
 
@@ -69,6 +70,13 @@ extern void SetUpEncodingPopupButton(NSPopUpButton *popup, int selectedEncoding,
 - (BOOL) isRichText;
 - (void) setRichText: (BOOL)flag;
 
+/*
+  Large files are plain text only, wrap to window and are laid out on idle
+  a little ahead of the visible part instead of up front.
+*/
+- (BOOL) isLargeFile;
+- (void) setLargeFile: (BOOL)flag;
+
 /*
   Hyphenation factor (0.0-1.0, 0.0 == disabled)
 */
@@ -22,6 +22,7 @@
 #include <Foundation/NSString.h>
 
 #include <AppKit/NSButtonCell.h>
+#include <AppKit/NSClipView.h>
 #include <AppKit/NSColor.h>
 #include <AppKit/NSFont.h>
 #include <AppKit/NSLayoutManager.h>
@@ -191,8 +192,11 @@
   }
 
   if (document) {
-    [document doForegroundLayoutToCharacterIndex:
-                      [[Preferences objectForKey:ForegroundLayoutToIndex] intValue]];
+    // Large files are laid out on idle
+    if (![document isLargeFile]) {
+      [document doForegroundLayoutToCharacterIndex:
+                        [[Preferences objectForKey:ForegroundLayoutToIndex] intValue]];
+    }
     [[document window] makeKeyAndOrderFront:nil];
     return YES;
   } 
@@ -217,6 +221,10 @@
                     name:NSTextStorageDidProcessEditingNotification
                   object:[self textStorage]];
 
+  [center removeObserver:self
+                    name:NSViewBoundsDidChangeNotification
+                  object:[scrollView contentView]];
+
   [[self firstTextView] setDelegate:nil];
   [[self window] setDelegate:nil];
   [documentName release];
@@ -279,6 +287,94 @@
   }
 }
 
+/*
+  Large files are laid out in chunks of this many characters, one chunk
+  per pass through the run loop.
+*/
+#define LargeFileLayoutChunk 65536
+
+- (void)scheduleIdleLayout
+{
+  [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                           selector:@selector(doIdleLayout)
+                                             object:nil];
+  [self performSelector:@selector(doIdleLayout) withObject:nil afterDelay:0.0];
+}
+
+/*
+  Lays out the next chunk of a large file while the laid out text ends less
+  than two screens below the visible part, so that scrolling doesn't wait
+  for layout. Text far below isn't touched until the user gets close to it.
+*/
+- (void)doIdleLayout
+{
+  NSLayoutManager *layoutManager = [self layoutManager];
+  NSRect          visibleRect = [[self firstTextView] visibleRect];
+  NSRect          laidRect = NSZeroRect;
+  NSUInteger      charIndex, glyphIndex;
+
+  if (!isLargeFile) {
+    return;
+  }
+
+  [layoutManager getFirstUnlaidCharacterIndex:&charIndex glyphIndex:&glyphIndex];
+  if (charIndex >= [textStorage length]) {
+    return;
+  }
+
+  if (glyphIndex > 0) {
+    laidRect = [layoutManager lineFragmentRectForGlyphAtIndex:glyphIndex - 1
+                                               effectiveRange:NULL];
+  }
+  if (NSMaxY(laidRect) > NSMaxY(visibleRect) + NSHeight(visibleRect) * 2) {
+    return;
+  }
+
+  [self doForegroundLayoutToCharacterIndex:charIndex + LargeFileLayoutChunk];
+  [self scheduleIdleLayout];
+}
+
+- (void)clipViewBoundsDidChange:(NSNotification *)notification
+{
+  [self scheduleIdleLayout];
+}
+
+- (BOOL)isLargeFile
+{
+  return isLargeFile;
+}
+
+- (void)setLargeFile:(BOOL)flag
+{
+  NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+  NSClipView           *clipView = [scrollView contentView];
+
+  isLargeFile = flag;
+
+  [center removeObserver:self
+                    name:NSViewBoundsDidChangeNotification
+                  object:clipView];
+  [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                           selector:@selector(doIdleLayout)
+                                             object:nil];
+
+  if (isLargeFile) {
+    // Paginating or hyphenating means laying out the whole text
+    if ([self hasMultiplePages]) {
+      [self setHasMultiplePages:NO];
+    }
+    [self setHyphenationFactor:0.0];
+    [[self firstTextView] setContinuousSpellCheckingEnabled:NO];
+
+    [clipView setPostsBoundsChangedNotifications:YES];
+    [center addObserver:self
+               selector:@selector(clipViewBoundsDidChange:)
+                   name:NSViewBoundsDidChangeNotification
+                 object:clipView];
+    [self scheduleIdleLayout];
+  }
+}
+
 + (NSString *)cleanedUpPath:(NSString *)filename
 {
   NSString	*resolvedSymlinks = [filename stringByResolvingSymlinksInPath];
@@ -705,6 +801,11 @@ static BOOL hyphenationSupported(void)
 
 - (void) toggleRich:(id)sender
 {
+  if (isLargeFile) {
+    NSBeep();
+    return;
+  }
+
   if (isRichText && ([textStorage length] > 0))
     {
       int choice = NXTRunAlertPanel (_(@"Make Plain Text"), 
@@ -722,6 +823,11 @@ static BOOL hyphenationSupported(void)
 
 - (void) togglePageBreaks:(id)sender
 {
+  if (isLargeFile) {
+    NSBeep();
+    return;
+  }
+
   [self setHasMultiplePages:![self hasMultiplePages]];
 }
 
@@ -1083,6 +1189,9 @@ static BOOL hyphenationSupported(void)
 - (void) windowWillClose:(NSNotification *)notification
 {
   NSWindow	*window = [self window];
+  [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                           selector:@selector(doIdleLayout)
+                                             object:nil];
   [window setDelegate: nil];
   [self release];
 }
@@ -1405,21 +1514,27 @@ validateToggleItem (NSMenuItem *aCell, BOOL useFirst,
   const char	*sel_name = sel_getName (action);
 
   if (!strcmp (sel_name, sel_getName (@selector (toggleRich:)))) {
+    if (isLargeFile)	// Large files stay plain text
+      return NO;
     validateToggleItem (aCell, [self isRichText], _(@"&Make Plain Text"), _(@"&Make Rich Text"));
   } else if (!strcmp (sel_name, sel_getName (@selector (togglePageBreaks:)))) {
+    if (isLargeFile)	// ...and wrap to window
+      return NO;
     validateToggleItem (aCell, [self hasMultiplePages], _(@"&Wrap to Window"), _(@"&Wrap to Page"));
   } else if (!strcmp (sel_name, sel_getName (@selector (toggleHyphenation:)))) {
-    if (!hyphenationSupported())	// Disable it
+    if (!hyphenationSupported() || isLargeFile)	// Disable it
       return NO;
     validateToggleItem (aCell, ([self hyphenationFactor] > 0.0), _(@"Disallow &Hyphenation"), _(@"Allow &Hyphenation"));
   }
 #else
   if (action == @selector(toggleRich:)) {
+    if (isLargeFile) return NO; /* Large files stay plain text... */
     validateToggleItem(aCell, [self isRichText], _(@"&Make Plain Text"), _(@"&Make Rich Text"));
   } else if (action == @selector(togglePageBreaks:)) {
+    if (isLargeFile) return NO; /* ...and wrap to window */
     validateToggleItem(aCell, [self hasMultiplePages], _(@"&Wrap to Window"), _(@"&Wrap to Page"));
   } else if (action == @selector(toggleHyphenation:)) {
-    if (!hyphenationSupported()) return NO; /* Disable it... */
+    if (!hyphenationSupported() || isLargeFile) return NO; /* Disable it... */
     validateToggleItem(aCell, ([self hyphenationFactor] > 0.0), _(@"Disallow &Hyphenation"), _(@"Allow &Hyphenation"));
   }
 #endif
@@ -14,6 +14,7 @@
 #import <AppKit/AppKit.h>
 #import "Document.h"
 #import "Preferences.h"
+#import "LargeTextStorage.h"
 #import <sys/stat.h>
 
 #define IgnoreRichText NO
@@ -153,11 +154,15 @@ defaultPadding (void)
   NSString      *extension = [fileName pathExtension];
   BOOL          success = NO;
   BOOL          isDirectory;
+  BOOL          isLarge;
+  BOOL          isLazy = NO;
+  int           largeFileSize = [[Preferences objectForKey: LargeFileSize] intValue];
 	
   if (!(attrs = [[NSFileManager defaultManager] fileAttributesAtPath: fileName traverseLink: YES]))
     return NO;
 
   isDirectory = [[attrs fileType] isEqualToString: NSFileTypeDirectory];
+  isLarge = !isDirectory && largeFileSize > 0 && [attrs fileSize] >= (unsigned long long)largeFileSize;
 
   if (isDirectory)
     {
@@ -233,7 +238,7 @@ defaultPadding (void)
   else
     {
       if (!fileContentsAsData)
-        fileContentsAsData = [[NSData alloc] initWithContentsOfFile:fileName];
+        fileContentsAsData = [[NSData alloc] initWithContentsOfFile: fileName];
       
       if (fileContentsAsData)
         {
@@ -259,6 +264,26 @@ defaultPadding (void)
                   success = YES;
                 }
             }
+          else if (isLarge && [LazyDecodedString canDecodeLazily: encoding])
+            {
+              NSString         *fileContents = [[LazyDecodedString alloc] initWithData: fileContentsAsData
+                                                                              encoding: encoding];
+              LargeTextStorage *newTextStorage = [[LargeTextStorage alloc] initWithString: fileContents
+                                                                               attributes: nil];
+
+              [[NSNotificationCenter defaultCenter]
+                removeObserver: self
+                          name: NSTextStorageDidProcessEditingNotification
+                        object: textStorage];
+              [[self layoutManager] replaceTextStorage: newTextStorage];
+              [textStorage release];
+              textStorage = newTextStorage;
+              [self setRichText: NO];
+              [fileContents release];
+              encodingIfPlainText = encoding;
+              isLazy = YES;
+              success = YES;
+            }
           else
             {
               NSString *fileContents = [[NSString alloc] initWithData:fileContentsAsData 
@@ -278,6 +303,9 @@ defaultPadding (void)
         }
     }
   [fileContentsAsData release];
+
+  if (success)
+    [self setLargeFile: isLazy];
   
   return success;
 }
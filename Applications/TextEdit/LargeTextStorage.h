@@ -0,0 +1,56 @@
+/*
+  LargeTextStorage.h
+
+  Text storage for big plain text files. Characters are decoded on demand
+  from the file contents and all text shares one set of attributes. The
+  first edit copies everything into a regular attributed string, so browsing
+  a file costs its bytes but not a decoded copy of them. The bytes are read
+  rather than mapped: a mapped file truncated by another process (log
+  rotation) would raise SIGBUS on the next decode.
+*/
+
+#import <Foundation/NSString.h>
+#import <AppKit/NSTextStorage.h>
+
+@class NSData;
+
+/*
+  Immutable string over the bytes of 8-bit or UTF-8 encoded text. Not thread
+  safe: it remembers the last decoded position to make sequential reads of
+  UTF-8 text cheap.
+*/
+@interface LazyDecodedString : NSString
+{
+  NSData              *data;
+  const unsigned char *bytes;
+  NSUInteger          byteLength;
+  NSUInteger          length;
+  BOOL                isUTF8;
+  unichar             *charTable;	/* 8-bit: character of each byte value */
+  struct LazyDecodedStringCheckpoint {
+    NSUInteger index;
+    NSUInteger offset;
+  }                   *checkpoints;	/* UTF-8: sparse character index */
+  NSUInteger          checkpointCount;
+  NSUInteger          cursorIndex;	/* UTF-8: last decoded position */
+  NSUInteger          cursorOffset;
+}
+
+/*
+  YES if characters of the encoding can be located without decoding all
+  the text before them.
+*/
++ (BOOL) canDecodeLazily: (NSStringEncoding)encoding;
+
+- (id) initWithData: (NSData *)aData encoding: (NSStringEncoding)encoding;
+
+@end
+
+@interface LargeTextStorage : NSTextStorage
+{
+  NSString                  *string;	/* Contents until the first edit */
+  NSDictionary              *attributes;	/* ...and their attributes */
+  NSMutableAttributedString *contents;	/* Contents after the first edit */
+}
+
+@end
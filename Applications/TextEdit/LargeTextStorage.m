@@ -0,0 +1,374 @@
+/*
+  LargeTextStorage.m
+
+  Lazily decoded string and text storage used for big plain text files.
+*/
+
+#import <Foundation/Foundation.h>
+#import <AppKit/AppKit.h>
+#import "LargeTextStorage.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Distance in characters between UTF-8 checkpoints */
+#define CheckpointStep 1024
+
+static const unsigned char utf8Marker[] = {0xef, 0xbb, 0xbf};
+
+/*
+  Decodes one UTF-8 sequence into one or two (surrogate pair) characters.
+  Malformed bytes decode to U+FFFD one at a time, the same way whether the
+  text is scanned or read.
+*/
+static inline NSUInteger
+decodeUTF8 (const unsigned char *p, const unsigned char *end, unichar *chars, NSUInteger *seqLength)
+{
+  unsigned int	c = p[0];
+  unsigned int	n, i;
+  unsigned long	u;
+
+  if (c < 0x80) {
+    chars[0] = c;
+    *seqLength = 1;
+    return 1;
+  }
+
+  if (c >= 0xc2 && c <= 0xdf) {
+    n = 1;
+    u = c & 0x1f;
+  } else if (c >= 0xe0 && c <= 0xef) {
+    n = 2;
+    u = c & 0x0f;
+  } else if (c >= 0xf0 && c <= 0xf4) {
+    n = 3;
+    u = c & 0x07;
+  } else {
+    goto invalid;
+  }
+
+  if (end - p <= (long)n)
+    goto invalid;
+
+  for (i = 1; i <= n; i++) {
+    if ((p[i] & 0xc0) != 0x80)
+      goto invalid;
+    u = (u << 6) | (p[i] & 0x3f);
+  }
+
+  if ((n == 2 && (u < 0x800 || (u >= 0xd800 && u <= 0xdfff)))
+      || (n == 3 && (u < 0x10000 || u > 0x10ffff)))
+    goto invalid;
+
+  *seqLength = n + 1;
+  if (u >= 0x10000) {
+    u -= 0x10000;
+    chars[0] = 0xd800 + (u >> 10);
+    chars[1] = 0xdc00 + (u & 0x3ff);
+    return 2;
+  }
+  chars[0] = u;
+  return 1;
+
+ invalid:
+  chars[0] = 0xfffd;
+  *seqLength = 1;
+  return 1;
+}
+
+@implementation LazyDecodedString
+
++ (BOOL) canDecodeLazily:(NSStringEncoding)encoding
+{
+  switch (encoding) {
+  case NSUTF8StringEncoding:
+  case NSASCIIStringEncoding:
+  case NSNEXTSTEPStringEncoding:
+  case NSISOLatin1StringEncoding:
+  case NSISOLatin2StringEncoding:
+  case NSWindowsCP1250StringEncoding:
+  case NSWindowsCP1251StringEncoding:
+  case NSWindowsCP1252StringEncoding:
+  case NSWindowsCP1253StringEncoding:
+  case NSWindowsCP1254StringEncoding:
+  case NSMacOSRomanStringEncoding:
+  case NSKOI8RStringEncoding:
+    return YES;
+  default:
+    return NO;
+  }
+}
+
+/*
+  Counts characters of UTF-8 text once, remembering where every
+  CheckpointStep'th one starts. Reads go forward from the closest
+  checkpoint.
+*/
+- (void) scanUTF8
+{
+  const unsigned char	*p = bytes;
+  const unsigned char	*end = bytes + byteLength;
+  NSUInteger		capacity = byteLength / CheckpointStep + 2;
+  NSUInteger		nextCheckpoint = 0;
+  NSUInteger		index = 0;
+  NSUInteger		seqLength;
+  unichar		chars[2];
+
+  checkpoints = malloc (capacity * sizeof (struct LazyDecodedStringCheckpoint));
+  checkpointCount = 0;
+
+  while (p < end) {
+    if (index >= nextCheckpoint) {
+      checkpoints[checkpointCount].index = index;
+      checkpoints[checkpointCount].offset = p - bytes;
+      checkpointCount++;
+      nextCheckpoint += CheckpointStep;
+    }
+    if (*p < 0x80) {
+      p++;
+      index++;
+    } else {
+      index += decodeUTF8 (p, end, chars, &seqLength);
+      p += seqLength;
+    }
+  }
+  if (checkpointCount == 0) {
+    checkpoints[0].index = 0;
+    checkpoints[0].offset = 0;
+    checkpointCount = 1;
+  }
+  length = index;
+}
+
+- (void) makeCharTableForEncoding:(NSStringEncoding)encoding
+{
+  unsigned int	b;
+
+  charTable = malloc (256 * sizeof (unichar));
+
+  for (b = 0; b < 256; b++) {
+    unsigned char	byte = b;
+    NSString		*str = [[NSString alloc] initWithBytes:&byte length:1 encoding:encoding];
+
+    charTable[b] = ([str length] == 1) ? [str characterAtIndex:0] : 0xfffd;
+    [str release];
+  }
+}
+
+/*
+  NSString's -init expects to be overridden by concrete string classes,
+  so it isn't called here.
+*/
+- (id) initWithData:(NSData *)aData encoding:(NSStringEncoding)encoding
+{
+  if (!aData || ![LazyDecodedString canDecodeLazily:encoding]) {
+    [self release];
+    return nil;
+  }
+
+  data = [aData retain];
+  bytes = [data bytes];
+  byteLength = [data length];
+  isUTF8 = (encoding == NSUTF8StringEncoding);
+
+  if (isUTF8) {
+    if (byteLength >= sizeof (utf8Marker) && !memcmp (bytes, utf8Marker, sizeof (utf8Marker))) {
+      bytes += sizeof (utf8Marker);
+      byteLength -= sizeof (utf8Marker);
+    }
+    [self scanUTF8];
+  } else {
+    [self makeCharTableForEncoding:encoding];
+    length = byteLength;
+  }
+
+  return self;
+}
+
+- (void) dealloc
+{
+  free (charTable);
+  free (checkpoints);
+  [data release];
+  [super dealloc];
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+  return [self retain];
+}
+
+- (NSUInteger) length
+{
+  return length;
+}
+
+- (void) getCharacters:(unichar *)buffer range:(NSRange)aRange
+{
+  const unsigned char	*end = bytes + byteLength;
+  NSUInteger		last = NSMaxRange (aRange);
+  NSUInteger		index, offset, seqLength, n, i;
+  unichar		chars[2];
+
+  if (aRange.location > length || last > length) {
+    [NSException raise:NSRangeException
+                format:@"-getCharacters:range: %@ out of bounds (%lu)",
+                 NSStringFromRange (aRange), (unsigned long)length];
+  }
+
+  if (!isUTF8) {
+    const unsigned char	*p = bytes + aRange.location;
+
+    for (i = 0; i < aRange.length; i++)
+      buffer[i] = charTable[p[i]];
+    return;
+  }
+
+  // Continue from where the previous read stopped if that's closer
+  if (cursorIndex <= aRange.location && aRange.location - cursorIndex < CheckpointStep) {
+    index = cursorIndex;
+    offset = cursorOffset;
+  } else {
+    NSUInteger	k = aRange.location / CheckpointStep;
+
+    if (k >= checkpointCount)
+      k = checkpointCount - 1;
+    // A surrogate pair may straddle the checkpoint
+    if (checkpoints[k].index > aRange.location)
+      k--;
+    index = checkpoints[k].index;
+    offset = checkpoints[k].offset;
+  }
+
+  while (index < last) {
+    if (bytes[offset] < 0x80) {
+      chars[0] = bytes[offset];
+      n = 1;
+      seqLength = 1;
+    } else {
+      n = decodeUTF8 (bytes + offset, end, chars, &seqLength);
+    }
+    for (i = 0; i < n; i++, index++) {
+      if (index >= aRange.location && index < last)
+        *buffer++ = chars[i];
+    }
+    offset += seqLength;
+  }
+
+  cursorIndex = index;
+  cursorOffset = offset;
+}
+
+- (unichar) characterAtIndex:(NSUInteger)index
+{
+  unichar	c;
+
+  if (index >= length) {
+    [NSException raise:NSRangeException
+                format:@"-characterAtIndex: %lu out of bounds (%lu)",
+                 (unsigned long)index, (unsigned long)length];
+  }
+
+  if (!isUTF8)
+    return charTable[bytes[index]];
+
+  [self getCharacters:&c range:NSMakeRange (index, 1)];
+  return c;
+}
+
+@end
+
+
+@implementation LargeTextStorage
+
+/*
+  Like the concrete text storage of the kit, relies on the
+  NSTextStorage implementation to set up the layout managers array.
+*/
+- (id) initWithString:(NSString *)aString attributes:(NSDictionary *)attrs
+{
+  self = [super initWithString:aString attributes:attrs];
+  if (self) {
+    // Copying a lazily decoded string would decode it whole
+    string = [aString isKindOfClass:[LazyDecodedString class]] ? [aString retain] : [aString copy];
+    if (!string)
+      string = @"";
+    attributes = attrs ? [attrs copy] : [[NSDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void) dealloc
+{
+  [string release];
+  [attributes release];
+  [contents release];
+  [super dealloc];
+}
+
+/*
+  Moves the text into a regular attributed string once it stops being
+  uniform. The old string may still be in use by the caller, so it isn't
+  released right away.
+*/
+- (void) copyContents
+{
+  if (!contents) {
+    contents = [[NSMutableAttributedString alloc] initWithString:string attributes:attributes];
+    [string autorelease];
+    string = nil;
+    [attributes release];
+    attributes = nil;
+  }
+}
+
+- (NSString *) string
+{
+  return contents ? [contents string] : string;
+}
+
+- (NSDictionary *) attributesAtIndex:(NSUInteger)index effectiveRange:(NSRange *)aRange
+{
+  if (contents)
+    return [contents attributesAtIndex:index effectiveRange:aRange];
+
+  if (index >= [string length]) {
+    [NSException raise:NSRangeException
+                format:@"-attributesAtIndex:effectiveRange: %lu out of bounds (%lu)",
+                 (unsigned long)index, (unsigned long)[string length]];
+  }
+
+  if (aRange)
+    *aRange = NSMakeRange (0, [string length]);
+  return attributes;
+}
+
+- (void) setAttributes:(NSDictionary *)attrs range:(NSRange)aRange
+{
+  if (!attrs)
+    attrs = [NSDictionary dictionary];
+
+  if (contents) {
+    [contents setAttributes:attrs range:aRange];
+  } else if (aRange.location == 0 && aRange.length == [string length]) {
+    [attributes autorelease];
+    attributes = [attrs copy];
+  } else if (![attrs isEqual:attributes]) {
+    [self copyContents];
+    [contents setAttributes:attrs range:aRange];
+  }
+
+  [self edited:NSTextStorageEditedAttributes range:aRange changeInLength:0];
+}
+
+- (void) replaceCharactersInRange:(NSRange)aRange withString:(NSString *)aString
+{
+  [self copyContents];
+  [contents replaceCharactersInRange:aRange withString:aString];
+
+  [self edited:NSTextStorageEditedCharacters
+         range:aRange
+changeInLength:(NSInteger)[aString length] - (NSInteger)aRange.length];
+}
+
+@end
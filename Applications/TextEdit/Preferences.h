@@ -15,6 +15,7 @@
 #define PlainTextEncoding @"PlainTextEncoding"
 #define TabWidth @"TabWidth"
 #define ForegroundLayoutToIndex @"ForegroundLayoutToIndex"
+#define LargeFileSize @"LargeFileSize"
 #define OpenPanelFollowsMainWindow @"OpenPanelFollowsMainWindow"
 
 @interface Preferences: NSObject
@@ -40,6 +40,7 @@ static NSDictionary *defaultValues (void)
 				[NSNumber numberWithInt:UnknownStringEncoding], PlainTextEncoding,
 				[NSNumber numberWithInt:8], TabWidth,
 				[NSNumber numberWithInt:100000], ForegroundLayoutToIndex,		
+				[NSNumber numberWithInt:16 * 1024 * 1024], LargeFileSize,
                        [NSFont userFixedPitchFontOfSize:0.0], PlainTextFont, 
                                  [NSFont userFontOfSize:0.0], RichTextFont, 
                                  nil];
@@ -288,6 +289,7 @@ static BOOL changingRTFFont = NO;
 	getIntDefault (PlainTextEncoding);
 	getIntDefault (TabWidth);
 	getIntDefault (ForegroundLayoutToIndex);
+	getIntDefault (LargeFileSize);
 	[dict setObject: [NSFont userFontOfSize: 0.0] forKey: RichTextFont];
 	[dict setObject: [NSFont userFixedPitchFontOfSize: 0.0] forKey: PlainTextFont];
 
@@ -314,6 +316,7 @@ static BOOL changingRTFFont = NO;
 	setIntDefault (PlainTextEncoding);
 	setIntDefault (TabWidth);
 	setIntDefault (ForegroundLayoutToIndex);
+	setIntDefault (LargeFileSize);
 	if (![[dict objectForKey: RichTextFont] isEqual: [NSFont userFontOfSize: 0.0]])
 		[NSFont setUserFont: [dict objectForKey: RichTextFont]];
 	if (![[dict objectForKey: PlainTextFont] isEqual: [NSFont userFixedPitchFontOfSize: 0.0]])
@@ -246,6 +246,8 @@ static id	sharedFindObject = nil;
 #define ReplaceAllScopeEntireFile 42
 #define ReplaceAllScopeSelection 43
 
+/* Scans the text once, builds the result and applies it as a single edit,
+   so that the text storage is changed (and undo is registered) only once. */
 - (void) replaceAll: (id)sender
 {
     NSTextView *text = [self textObjectToSearchIn];
@@ -258,31 +260,84 @@ static id	sharedFindObject = nil;
         NSString		*replaceString = [replaceTextField stringValue];
         BOOL			entireFile = replaceAllScopeMatrix ? ([replaceAllScopeMatrix selectedTag] == ReplaceAllScopeEntireFile) : YES;
         NSRange			replaceRange = entireFile ? NSMakeRange (0, [textStorage length]) : [text selectedRange];
-        unsigned int	options = NSBackwardsSearch | ([ignoreCaseButton state] ? NSCaseInsensitiveSearch : 0);
+        unsigned int	options = [ignoreCaseButton state] ? NSCaseInsensitiveSearch : 0;
         unsigned int	replaced = 0;
+        BOOL			isRichText = [text isRichText];
+        NSMutableString	*newString = nil;
+        NSMutableAttributedString	*newAttrString = nil;
+        NSRange			searchRange = replaceRange;
+        unsigned int	end = NSMaxRange(replaceRange);
 
         if (findTextField)
 			[self setFindString:[findTextField stringValue]];
 
-        while (1) {
-            NSRange	foundRange = [textContents rangeOfString: [self findString] options: options range: replaceRange];
-			
+        while (searchRange.length > 0) {
+            NSRange	foundRange = [textContents rangeOfString: [self findString] options: options range: searchRange];
+            NSRange	keptRange;
+
             if (foundRange.length == 0)
 				break;
-            if ([text shouldChangeTextInRange: foundRange replacementString: replaceString]) {
-				if (replaced == 0)
-					[textStorage beginEditing];
-
-                replaced++;
 
-				[textStorage replaceCharactersInRange: foundRange withString: replaceString];
-				replaceRange.length = foundRange.location - replaceRange.location;
+            if (replaced == 0) {
+				if (isRichText)
+					newAttrString = [[NSMutableAttributedString alloc] init];
+				else
+					newString = [[NSMutableString alloc] initWithCapacity: replaceRange.length];
+            }
+            replaced++;
+
+            /* Text between matches is copied as is, replacement gets attributes of the
+               first replaced character - as replaceCharactersInRange:withString: does. */
+            keptRange = NSMakeRange(searchRange.location, foundRange.location - searchRange.location);
+            if (isRichText) {
+				NSAttributedString	*replacement;
+
+				if (keptRange.length > 0)
+					[newAttrString appendAttributedString: [textStorage attributedSubstringFromRange: keptRange]];
+				replacement = [[NSAttributedString alloc] initWithString: replaceString
+					attributes: [textStorage attributesAtIndex: foundRange.location effectiveRange: NULL]];
+				[newAttrString appendAttributedString: replacement];
+				[replacement release];
+            } else {
+				if (keptRange.length > 0)
+					[newString appendString: [textContents substringWithRange: keptRange]];
+				[newString appendString: replaceString];
             }
+
+            searchRange.location = NSMaxRange(foundRange);
+            searchRange.length = end - searchRange.location;
+        }
+
+        if (replaced > 0) {
+			NSString	*result;
+
+			/* Tail after the last match */
+			if (searchRange.length > 0) {
+				if (isRichText)
+					[newAttrString appendAttributedString: [textStorage attributedSubstringFromRange: searchRange]];
+				else
+					[newString appendString: [textContents substringWithRange: searchRange]];
+			}
+			result = isRichText ? [newAttrString string] : newString;
+
+			if ([text shouldChangeTextInRange: replaceRange replacementString: result]) {
+				[textStorage beginEditing];
+				if (isRichText)
+					[textStorage replaceCharactersInRange: replaceRange withAttributedString: newAttrString];
+				else
+					[textStorage replaceCharactersInRange: replaceRange withString: newString];
+				[textStorage endEditing];
+				[text didChangeText];
+				if (!entireFile)
+					[text setSelectedRange: NSMakeRange(replaceRange.location, [result length])];
+			} else {
+				replaced = 0;
+			}
+			[newAttrString release];
+			[newString release];
         }
 
         if (replaced > 0) {	/* There was at least one replacement */
-			[textStorage endEditing];	/* We need this to bracket the beginEditing */
-			[text didChangeText];	/* We need one of these to terminate the shouldChange... methods we sent */
             [statusField setStringValue: [NSString localizedStringWithFormat: NSLocalizedStringFromTable (@"%d replaced", @"FindPanel", @"Status displayed in find panel when indicated number of matches are replaced."), replaced]];
         } else {	/* No replacements were done... */
 			NSBeep();
@@ -212,6 +212,13 @@ APPKIT_EXPORT NSString *NSShellCommandFileType;
     fullPath.*/
 - (NSImage *)iconForFile:(NSString *)fullPath;
 
+// ADDON
+/** Returns an icon for the file specified by fullPath without examining file
+    contents. If file contents must be examined to choose an icon, returns
+    provisional icon and posts WMFileIconDidChangeNotification when the real
+    icon is known.*/
+- (NSImage *)fastIconForFile:(NSString *)fullPath;
+
 /** Returns an NSImage with the icon for the files specified in pathArray, an
     array of NSStrings. If pathArray specifies one file, its icon is returned.
     If pathArray specifies more than one file, an icon representing the
@@ -387,3 +394,13 @@ APPKIT_EXPORT NSString *NSWorkspaceDidPerformFileOperationNotification;  // @"NS
 APPKIT_EXPORT NSString *NSWorkspaceDidUnmountNotification;               // @"NSDevicePath"
 APPKIT_EXPORT NSString *NSWorkspaceWillPowerOffNotification;
 APPKIT_EXPORT NSString *NSWorkspaceWillUnmountNotification;              // @"NSDevicePath"
+
+//-------------------------------------------------------------------------------------------------
+// Posted on main thread when icon returned by fastIconForFile: was replaced with the icon
+// chosen by file contents. User info contains:
+// @"Path"
+//   The full path to file (string).
+// @"Icon"
+//   The new icon of file (NSImage).
+//-------------------------------------------------------------------------------------------------
+extern NSString *WMFileIconDidChangeNotification;
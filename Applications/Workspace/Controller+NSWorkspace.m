@@ -33,6 +33,7 @@
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #import <AppKit/AppKit.h>
@@ -65,6 +66,81 @@ static NSImage *multipleFiles = nil;
 static NSImage *unknownApplication = nil;
 static NSImage *unknownTool = nil;
 static NSString *_rootPath = @"/";
+static NSString *usersDirectoryPath = nil;
+
+NSString *WMFileIconDidChangeNotification = @"WMFileIconDidChangeNotification";
+
+//-------------------------------------------------------------------------------------------------
+// Icon cache
+//-------------------------------------------------------------------------------------------------
+// Icons are cached at two levels:
+// - per file: full path -> icon; entry is valid while device, inode, modification
+//   and status change times of file are the same (chmod changes only the latter);
+//   least recently used entries are dropped when cache is full;
+// - per file class: extension and executable bit -> icon; resolves regular files
+//   without reading their contents.
+// Files which icon depends on contents (unknown extension) are examined on
+// `contentsCheckQueue` if icon requested with fastIconForFile:.
+#define ICON_CACHE_SIZE_LIMIT 8192
+
+@interface WMFileIconCacheEntry : NSObject
+{
+ @public
+  dev_t device;
+  ino_t inode;
+  struct timespec mtime;
+  struct timespec ctime;
+  NSImage *icon;
+  BOOL isProvisional;
+
+  // Position in LRU list, most recently used first. Not retained - entries
+  // are owned by `fileIconCache'.
+  NSString *path;
+  WMFileIconCacheEntry *prev;
+  WMFileIconCacheEntry *next;
+}
+@end
+@implementation WMFileIconCacheEntry
+- (void)dealloc
+{
+  [icon release];
+  [path release];
+  [super dealloc];
+}
+@end
+
+static NSLock *iconCacheLock = nil;
+static NSMutableDictionary *fileIconCache = nil;  // full path -> WMFileIconCacheEntry
+static WMFileIconCacheEntry *iconCacheHead = nil; // most recently used
+static WMFileIconCacheEntry *iconCacheTail = nil; // least recently used
+static NSMutableDictionary *typeIconCache = nil;  // extension + mode -> NSImage
+static NSMutableSet *contentsCheckPaths = nil;    // paths queued for contents check
+static dispatch_queue_t contentsCheckQueue = NULL;
+
+// LRU list of `fileIconCache' entries. Must be called with `iconCacheLock' locked.
+static void _iconCacheUnlink(WMFileIconCacheEntry *entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    iconCacheHead = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    iconCacheTail = entry->prev;
+  entry->prev = entry->next = nil;
+}
+
+static void _iconCachePushFront(WMFileIconCacheEntry *entry)
+{
+  entry->prev = nil;
+  entry->next = iconCacheHead;
+  if (iconCacheHead)
+    iconCacheHead->prev = entry;
+  iconCacheHead = entry;
+  if (iconCacheTail == nil)
+    iconCacheTail = entry;
+}
 
 //-------------------------------------------------------------------------------------------------
 // Workspace private methods
@@ -78,6 +154,17 @@ static NSString *_rootPath = @"/";
 - (NSImage *)_imageFromFile:(NSString *)iconPath;
 - (NSImage *)_iconForExtension:(NSString *)ext;
 - (NSImage *)_iconForFileContents:(NSString *)fullPath;
+- (NSImage *)_iconForFile:(NSString *)fullPath deferContentsCheck:(BOOL)isDeferred;
+- (NSImage *)_cachedIconForFile:(NSString *)fullPath
+                           stat:(struct stat *)st
+                allowProvisional:(BOOL)isProvisionalAllowed;
+- (void)_cacheIcon:(NSImage *)icon
+           forFile:(NSString *)fullPath
+              stat:(struct stat *)st
+       provisional:(BOOL)isProvisional;
+- (void)_checkContentsOfFile:(NSString *)fullPath provisionalIcon:(NSImage *)icon;
+- (void)_postFileIconDidChange:(NSDictionary *)info;
+- (void)_invalidateIconCache;
 - (BOOL)_extension:(NSString *)ext role:(NSString *)role app:(NSString **)app;
 
 - (NSString *)_getBestIconForExtension:(NSString *)ext;
@@ -155,6 +242,7 @@ static NSString *_rootPath = @"/";
 - (id)initNSWorkspace
 {
   NSArray *sysAppDir;
+  NSArray *usersDirs;
   NSString *sysDir;
   int i;
 
@@ -192,6 +280,17 @@ static NSString *_rootPath = @"/";
   [folderPathIconDict setObject:@"NXRoot" forKey:_rootPath];
   folderIconCache = [[NSMutableDictionary alloc] init];
 
+  iconCacheLock = [NSLock new];
+  fileIconCache = [[NSMutableDictionary alloc] init];
+  typeIconCache = [[NSMutableDictionary alloc] init];
+  contentsCheckPaths = [[NSMutableSet alloc] init];
+  contentsCheckQueue = dispatch_queue_create("ns.workspace.icon-contents", DISPATCH_QUEUE_SERIAL);
+
+  usersDirs = NSSearchPathForDirectoriesInDomains(NSUserDirectory, NSSystemDomainMask, YES);
+  if ([usersDirs count] > 0) {
+    usersDirectoryPath = [[usersDirs objectAtIndex:0] copy];
+  }
+
   // list of extensions of wrappers (will be shown as plain file in Workspace)
   _wrappers = [@"(bundle, preferences, inspector, service)" propertyList];
   [_wrappers retain];
@@ -572,135 +671,15 @@ static NSLock *raceLock = nil;
   }
 }
 
-// NEXTSPACE changes
 - (NSImage *)iconForFile:(NSString *)fullPath
 {
-  NSImage *image = nil;
-  NSString *pathExtension = [[fullPath pathExtension] lowercaseString];
-  NSFileManager *fileManager = [NSFileManager defaultManager];
-  NSDictionary *attributes;
-  NSString *fileType;
-  NSString *wmFileType, *appName;
-  NSArray *searchPath;
-
-  attributes = [fileManager fileAttributesAtPath:fullPath traverseLink:YES];
-  fileType = [attributes objectForKey:NSFileType];
-  // NSLog(@"(NSWorkspace-iconForFile): %@, file type: %@, extension: %@", fullPath, fileType,
-  //       pathExtension);
-  if (([fileType isEqual:NSFileTypeDirectory] == YES) &&
-      [fileManager isReadableFileAtPath:fullPath] == NO) {
-    image = [NSImage imageNamed:@"badFolder"];
-  } else if ([fileType isEqual:NSFileTypeDirectory] == YES) {
-    NSString *iconPath = nil;
-
-    // Mount point
-    [self getInfoForFile:fullPath application:&appName type:&wmFileType];
-    if ([wmFileType isEqualToString:NSFilesystemFileType]) {
-      NXTFSType fsType;
-
-      fsType = [[OSEMediaManager defaultManager] filesystemTypeAtPath:fullPath];
-      if (fsType == NXTFSTypeFAT) {
-        image = [NSImage imageNamed:@"DOS_FD.fs"];
-      } else if (fsType == NXTFSTypeISO) {
-        image = [NSImage imageNamed:@"CDROM.fs"];
-      } else if (fsType == NXTFSTypeNTFS) {
-        image = [NSImage imageNamed:@"NTFS_HDD.fs"];
-      } else {
-        image = [NSImage imageNamed:@"HDD.fs"];
-      }
-    }
-
-    // Application
-    if ([pathExtension isEqualToString:@"app"] || [pathExtension isEqualToString:@"debug"] ||
-        [pathExtension isEqualToString:@"profile"]) {
-      image = [self _appIconForApp:fullPath];
-
-      if (image == nil) {
-        image = [NSImage _standardImageWithName:@"NXApplication"];
-      }
-    } else if ([_wrappers containsObject:pathExtension] != NO) {
-      image = [NSImage imageNamed:@"bundle"];
-    }
-
-    // Users home directory (/Users)
-    searchPath = NSSearchPathForDirectoriesInDomains(NSUserDirectory, NSSystemDomainMask, YES);
-    if ([searchPath count] > 0 && [fullPath isEqualToString:[searchPath objectAtIndex:0]]) {
-      image = [NSImage imageNamed:@"neighbor"];
-    }
-
-    // Directory icon '.dir.tiff', '.dir.png'
-    if (iconPath == nil) {
-      iconPath = [fullPath stringByAppendingPathComponent:@".dir.png"];
-      if ([fileManager isReadableFileAtPath:iconPath] == NO) {
-        iconPath = [fullPath stringByAppendingPathComponent:@".dir.tiff"];
-        if ([fileManager isReadableFileAtPath:iconPath] == NO) {
-          iconPath = nil;
-        }
-      }
-      // Directory icon path found - get icon
-      if (iconPath != nil) {
-        image = [self _imageFromFile:iconPath];
-      }
-    }
-
-    // It's not mount point, not bundle, not user homes,
-    // folder doesn't contain dir icon
-    if (image == nil) {
-      image = [self _iconForExtension:pathExtension];
-      if (image == nil || image == [self _unknownFiletypeImage]) {
-        NSString *iconName;
-
-        iconName = [folderPathIconDict objectForKey:fullPath];
-        if (iconName != nil) {
-          NSImage *iconImage;
-
-          iconImage = [folderIconCache objectForKey:iconName];
-          if (iconImage == nil) {
-            iconImage = [NSImage _standardImageWithName:iconName];
-            /* the dictionary retains the image */
-            [folderIconCache setObject:iconImage forKey:iconName];
-          }
-          image = iconImage;
-        } else {
-          if (folderImage == nil) {
-            folderImage = RETAIN([NSImage _standardImageWithName:@"NXFolder"]);
-          }
-          image = folderImage;
-        }
-      }
-    }
-  } else if ([fileManager isReadableFileAtPath:fullPath] == YES) {
-    // NSFileTypeRegular, NSFileType
-    NSDebugLog(@"pathExtension is '%@'", pathExtension);
-
-    // By extension
-    if (image == nil) {
-      image = [self _iconForExtension:pathExtension];
-    }
-
-    // By file contents
-    if (image == nil || image == [self _unknownFiletypeImage]) {
-      image = [self _iconForFileContents:fullPath];
-    }
-
-    // By executable bit
-    if (image == nil && ([fileType isEqual:NSFileTypeRegular] == YES) &&
-        ([fileManager isExecutableFileAtPath:fullPath] == YES)) {
-      if (unknownTool == nil) {
-        unknownTool = RETAIN([NSImage _standardImageWithName:@"NXTool"]);
-      }
-      image = unknownTool;
-    }
-
-  } else if ([fileManager isReadableFileAtPath:fullPath] == NO) {
-    image = [NSImage imageNamed:@"badFile"];
-  }
-
-  if (image == nil) {
-    image = [self _unknownFiletypeImage];
-  }
+  return [self _iconForFile:fullPath deferContentsCheck:NO];
+}
 
-  return image;
+// NEXTSPACE addon
+- (NSImage *)fastIconForFile:(NSString *)fullPath
+{
+  return [self _iconForFile:fullPath deferContentsCheck:YES];
 }
 
 - (NSImage *)iconForFiles:(NSArray *)pathArray
@@ -1129,6 +1108,278 @@ static NSLock *raceLock = nil;
   return tmp;
 }
 
+// NEXTSPACE changes
+- (NSImage *)_iconForFile:(NSString *)fullPath deferContentsCheck:(BOOL)isDeferred
+{
+  NSImage *image = nil;
+  NSString *pathExtension = [[fullPath pathExtension] lowercaseString];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  const char *cPath = [fullPath fileSystemRepresentation];
+  struct stat st;
+  NSString *wmFileType, *appName;
+  BOOL isProvisional = NO;
+
+  if (stat(cPath, &st) != 0) {
+    return [NSImage imageNamed:@"badFile"];
+  }
+
+  image = [self _cachedIconForFile:fullPath stat:&st allowProvisional:isDeferred];
+  if (image != nil) {
+    return image;
+  }
+
+  // NSLog(@"(NSWorkspace-iconForFile): %@, file mode: %o, extension: %@", fullPath, st.st_mode,
+  //       pathExtension);
+  if (S_ISDIR(st.st_mode) && access(cPath, R_OK) != 0) {
+    image = [NSImage imageNamed:@"badFolder"];
+  } else if (S_ISDIR(st.st_mode)) {
+    NSString *iconPath = nil;
+
+    // Mount point
+    [self getInfoForFile:fullPath application:&appName type:&wmFileType];
+    if ([wmFileType isEqualToString:NSFilesystemFileType]) {
+      NXTFSType fsType;
+
+      fsType = [[OSEMediaManager defaultManager] filesystemTypeAtPath:fullPath];
+      if (fsType == NXTFSTypeFAT) {
+        image = [NSImage imageNamed:@"DOS_FD.fs"];
+      } else if (fsType == NXTFSTypeISO) {
+        image = [NSImage imageNamed:@"CDROM.fs"];
+      } else if (fsType == NXTFSTypeNTFS) {
+        image = [NSImage imageNamed:@"NTFS_HDD.fs"];
+      } else {
+        image = [NSImage imageNamed:@"HDD.fs"];
+      }
+    }
+
+    // Application
+    if ([pathExtension isEqualToString:@"app"] || [pathExtension isEqualToString:@"debug"] ||
+        [pathExtension isEqualToString:@"profile"]) {
+      image = [self _appIconForApp:fullPath];
+
+      if (image == nil) {
+        image = [NSImage _standardImageWithName:@"NXApplication"];
+      }
+    } else if ([_wrappers containsObject:pathExtension] != NO) {
+      image = [NSImage imageNamed:@"bundle"];
+    }
+
+    // Users home directory (/Users)
+    if (usersDirectoryPath && [fullPath isEqualToString:usersDirectoryPath]) {
+      image = [NSImage imageNamed:@"neighbor"];
+    }
+
+    // Directory icon '.dir.tiff', '.dir.png'
+    if (iconPath == nil) {
+      iconPath = [fullPath stringByAppendingPathComponent:@".dir.png"];
+      if ([fileManager isReadableFileAtPath:iconPath] == NO) {
+        iconPath = [fullPath stringByAppendingPathComponent:@".dir.tiff"];
+        if ([fileManager isReadableFileAtPath:iconPath] == NO) {
+          iconPath = nil;
+        }
+      }
+      // Directory icon path found - get icon
+      if (iconPath != nil) {
+        image = [self _imageFromFile:iconPath];
+      }
+    }
+
+    // It's not mount point, not bundle, not user homes,
+    // folder doesn't contain dir icon
+    if (image == nil) {
+      image = [self _iconForExtension:pathExtension];
+      if (image == nil || image == [self _unknownFiletypeImage]) {
+        NSString *iconName;
+
+        iconName = [folderPathIconDict objectForKey:fullPath];
+        if (iconName != nil) {
+          NSImage *iconImage;
+
+          [iconCacheLock lock];
+          iconImage = [folderIconCache objectForKey:iconName];
+          if (iconImage == nil) {
+            iconImage = [NSImage _standardImageWithName:iconName];
+            /* the dictionary retains the image */
+            [folderIconCache setObject:iconImage forKey:iconName];
+          }
+          [iconCacheLock unlock];
+          image = iconImage;
+        } else {
+          if (folderImage == nil) {
+            folderImage = RETAIN([NSImage _standardImageWithName:@"NXFolder"]);
+          }
+          image = folderImage;
+        }
+      }
+    }
+  } else if (access(cPath, R_OK) == 0) {
+    // NSFileTypeRegular, NSFileType
+    BOOL isExecutable;
+    NSString *typeKey;
+
+    NSDebugLog(@"pathExtension is '%@'", pathExtension);
+
+    isExecutable = (S_ISREG(st.st_mode) && (st.st_mode & PosixExecutePermission) &&
+                    access(cPath, X_OK) == 0);
+    typeKey = [NSString stringWithFormat:@"%@/%c", pathExtension, isExecutable ? 'x' : '-'];
+
+    // By file class
+    [iconCacheLock lock];
+    image = [[[typeIconCache objectForKey:typeKey] retain] autorelease];
+    [iconCacheLock unlock];
+
+    // By extension
+    if (image == nil) {
+      image = [self _iconForExtension:pathExtension];
+      if (image != nil && image != [self _unknownFiletypeImage]) {
+        [iconCacheLock lock];
+        [typeIconCache setObject:image forKey:typeKey];
+        [iconCacheLock unlock];
+      } else {
+        NSImage *fallbackImage = nil;
+
+        // By executable bit
+        if (isExecutable) {
+          if (unknownTool == nil) {
+            unknownTool = RETAIN([NSImage _standardImageWithName:@"NXTool"]);
+          }
+          fallbackImage = unknownTool;
+        }
+
+        // By file contents
+        if (isDeferred) {
+          image = fallbackImage ? fallbackImage : [self _unknownFiletypeImage];
+          isProvisional = YES;
+          [self _checkContentsOfFile:fullPath provisionalIcon:image];
+        } else {
+          image = [self _iconForFileContents:fullPath];
+          if (image == nil) {
+            image = fallbackImage;
+          }
+        }
+      }
+    }
+  } else {
+    image = [NSImage imageNamed:@"badFile"];
+  }
+
+  if (image == nil) {
+    image = [self _unknownFiletypeImage];
+  }
+
+  [self _cacheIcon:image forFile:fullPath stat:&st provisional:isProvisional];
+
+  return image;
+}
+
+- (NSImage *)_cachedIconForFile:(NSString *)fullPath
+                           stat:(struct stat *)st
+                allowProvisional:(BOOL)isProvisionalAllowed
+{
+  WMFileIconCacheEntry *entry;
+  NSImage *icon = nil;
+
+  [iconCacheLock lock];
+  entry = [fileIconCache objectForKey:fullPath];
+  if (entry && entry->device == st->st_dev && entry->inode == st->st_ino &&
+      entry->mtime.tv_sec == st->st_mtim.tv_sec && entry->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+      entry->ctime.tv_sec == st->st_ctim.tv_sec && entry->ctime.tv_nsec == st->st_ctim.tv_nsec &&
+      (entry->isProvisional == NO || isProvisionalAllowed)) {
+    icon = [[entry->icon retain] autorelease];
+    if (entry != iconCacheHead) {
+      _iconCacheUnlink(entry);
+      _iconCachePushFront(entry);
+    }
+  }
+  [iconCacheLock unlock];
+
+  return icon;
+}
+
+- (void)_cacheIcon:(NSImage *)icon
+           forFile:(NSString *)fullPath
+              stat:(struct stat *)st
+       provisional:(BOOL)isProvisional
+{
+  WMFileIconCacheEntry *entry = [WMFileIconCacheEntry new];
+  WMFileIconCacheEntry *oldEntry;
+
+  entry->device = st->st_dev;
+  entry->inode = st->st_ino;
+  entry->mtime = st->st_mtim;
+  entry->ctime = st->st_ctim;
+  entry->icon = [icon retain];
+  entry->isProvisional = isProvisional;
+  entry->path = [fullPath copy];
+
+  [iconCacheLock lock];
+  if ((oldEntry = [fileIconCache objectForKey:fullPath]) != nil) {
+    _iconCacheUnlink(oldEntry);
+  }
+  else {
+    while ([fileIconCache count] >= ICON_CACHE_SIZE_LIMIT && iconCacheTail != nil) {
+      oldEntry = iconCacheTail;
+      _iconCacheUnlink(oldEntry);
+      [fileIconCache removeObjectForKey:oldEntry->path];
+    }
+  }
+  _iconCachePushFront(entry);
+  [fileIconCache setObject:entry forKey:entry->path];
+  [iconCacheLock unlock];
+
+  [entry release];
+}
+
+// Examines file contents (libmagic) in background, updates cache and notifies
+// about icon change.
+- (void)_checkContentsOfFile:(NSString *)fullPath provisionalIcon:(NSImage *)icon
+{
+  [iconCacheLock lock];
+  if ([contentsCheckPaths containsObject:fullPath]) {
+    [iconCacheLock unlock];
+    return;
+  }
+  [contentsCheckPaths addObject:fullPath];
+  [iconCacheLock unlock];
+
+  dispatch_async(contentsCheckQueue, ^{
+    @autoreleasepool {
+      NSImage *image = [self _iconForFileContents:fullPath];
+      struct stat st;
+
+      if (stat([fullPath fileSystemRepresentation], &st) == 0) {
+        [self _cacheIcon:(image ? image : icon) forFile:fullPath stat:&st provisional:NO];
+      }
+      if (image != nil && image != icon) {
+        [self performSelectorOnMainThread:@selector(_postFileIconDidChange:)
+                               withObject:@{@"Path" : fullPath, @"Icon" : image}
+                            waitUntilDone:NO];
+      }
+
+      [iconCacheLock lock];
+      [contentsCheckPaths removeObject:fullPath];
+      [iconCacheLock unlock];
+    }
+  });
+}
+
+- (void)_postFileIconDidChange:(NSDictionary *)info
+{
+  [[NSNotificationCenter defaultCenter] postNotificationName:WMFileIconDidChangeNotification
+                                                      object:self
+                                                    userInfo:info];
+}
+
+- (void)_invalidateIconCache
+{
+  [iconCacheLock lock];
+  [_iconMap removeAllObjects];
+  [fileIconCache removeAllObjects];
+  iconCacheHead = iconCacheTail = nil;
+  [typeIconCache removeAllObjects];
+  [iconCacheLock unlock];
+}
+
 - (NSImage *)_iconForExtension:(NSString *)ext
 {
   NSImage *icon = nil;
@@ -1140,7 +1391,10 @@ static NSLock *raceLock = nil;
    * extensions are case-insensitive - convert to lowercase.
    */
   ext = [ext lowercaseString];
-  if ((icon = [_iconMap objectForKey:ext]) == nil) {
+  [iconCacheLock lock];
+  icon = [[[_iconMap objectForKey:ext] retain] autorelease];
+  [iconCacheLock unlock];
+  if (icon == nil) {
     NSDictionary *prefs;
     NSDictionary *extInfo;
     NSString *iconPath;
@@ -1204,7 +1458,9 @@ static NSLock *raceLock = nil;
      * Set the icon in the cache for next time.
      */
     if (icon != nil) {
+      [iconCacheLock lock];
       [_iconMap setObject:icon forKey:ext];
+      [iconCacheLock unlock];
     }
   }
   return icon;
@@ -1393,7 +1649,7 @@ static NSLock *raceLock = nil;
     }
   }
   // Invalidate the cache of icons for file extensions.
-  [_iconMap removeAllObjects];
+  [self _invalidateIconCache];
 
   // Update inspector info (may be opened at "Tools" section)
   if (inspector != nil && isAppListChanged != NO) {
@@ -26,7 +26,7 @@
 #import <Viewers/FileViewer.h>
 #import <Viewers/Viewer.h>
 
-@class NXTIconView, NXTIcon, NXTIconLabel;
+@class NXTIconView, NXTIcon, NXTIconLabel, IconViewer;
 
 @interface WMIconView : NXTIconView
 {
@@ -38,20 +38,30 @@
 
 @interface ViewerItemsLoader : NSOperation
 {
+  IconViewer     *viewer;
   WMIconView     *iconView;
   NSString       *directoryPath;
   NSMutableArray *directoryContents;
   NSArray        *selectedFiles;
   BOOL           isUpdate;
   BOOL           isAnimate;
+
+  // Icons visible in icon view - their images are resolved first.
+  // Changed by viewer on scroll.
+  NSLock         *visibleIconsLock;
+  NSArray        *visibleIcons;
 }
 
-- (id)initWithIconView:(NXTIconView *)view
-                  path:(NSString *)dirPath
-              contents:(NSArray *)dirContents
-             selection:(NSArray *)filenames
-                update:(BOOL)toUpdate
-               animate:(BOOL)isDrawAnimation;
+- (id)initWithViewer:(IconViewer *)aViewer
+            iconView:(NXTIconView *)view
+                path:(NSString *)dirPath
+            contents:(NSArray *)dirContents
+           selection:(NSArray *)filenames
+              update:(BOOL)toUpdate
+             animate:(BOOL)isDrawAnimation;
+
+// May be called from any thread.
+- (void)setVisibleIcons:(NSArray *)icons;
 
 @end
 
@@ -68,6 +78,9 @@
   BOOL         updateOnDisplay;
   BOOL         doAnimation;
 
+  // File name -> icon, for updates of single icons
+  NSMutableDictionary *iconsByName;
+
   // Items loader
   NSOperationQueue	*operationQ;
   ViewerItemsLoader	*itemsLoader;
@@ -80,4 +93,9 @@
 
 - (void)open:(id)sender;
 
+// Called by items loader on main thread
+- (void)itemsLoader:(ViewerItemsLoader *)loader willAddIcons:(NSArray *)icons;
+- (void)itemsLoader:(ViewerItemsLoader *)loader willRemoveIcons:(NSArray *)icons;
+- (void)itemsLoaderDidAddIcons:(ViewerItemsLoader *)loader;
+
 @end
@@ -28,6 +28,7 @@
 #import <SystemKit/OSEDefaults.h>
 #import <SystemKit/OSEFileManager.h>
 
+#import <Controller+NSWorkspace.h>
 #import <Viewers/FileViewer.h>
 #import <Viewers/PathIcon.h>
 #import <Viewers/PathView.h>
@@ -36,65 +37,213 @@
 //=============================================================================
 // ViewerItemLoader implementation
 //=============================================================================
+// Number of resolved icon images sent to main thread at once
+#define ITEMS_LOADER_BATCH_SIZE 64
+// Maximum time (in seconds) resolved images wait to be sent to main thread
+#define ITEMS_LOADER_BATCH_INTERVAL 0.1
+
 @implementation ViewerItemsLoader
 
-- (id)initWithIconView:(WMIconView *)view
-                  path:(NSString *)dirPath
-              contents:(NSArray *)dirContents
-             selection:(NSArray *)filenames
-                update:(BOOL)toUpdate
-               animate:(BOOL)isDrawAnimation
+- (id)initWithViewer:(IconViewer *)aViewer
+            iconView:(WMIconView *)view
+                path:(NSString *)dirPath
+            contents:(NSArray *)dirContents
+           selection:(NSArray *)filenames
+              update:(BOOL)toUpdate
+             animate:(BOOL)isDrawAnimation
 {
   [super init];
   
   if (self != nil) {
+    viewer = aViewer;
     iconView = view;
     directoryPath = [[NSString alloc] initWithString:dirPath];
     directoryContents = [dirContents mutableCopy];
     selectedFiles = [[NSArray alloc] initWithArray:filenames];
     isUpdate = toUpdate;
     isAnimate = isDrawAnimation;
+    visibleIconsLock = [NSLock new];
+    visibleIcons = nil;
   }
 
   return self;
 }
 
+- (void)dealloc
+{
+  [directoryPath release];
+  [directoryContents release];
+  [selectedFiles release];
+  [visibleIconsLock release];
+  [visibleIcons release];
+
+  [super dealloc];
+}
+
 - (void)_updateItems:(NSMutableArray *)items
             fileView:(WMIconView *)view
 {
-  NXTIcon         *icon;
   NSMutableArray *itemsCopy = [items mutableCopy];
   NSArray        *iconsCopy = [[view icons] copy];
+  NSSet          *itemsSet = [NSSet setWithArray:items];
+  NSMutableSet   *labels = [NSMutableSet set];
+  NSMutableArray *iconsToRemove = [NSMutableArray array];
 
   NSDebugLLog(@"IconViewer", @"_updateItems: %lu", [items count]);
 
   // Remove non-existing items
   for (NXTIcon *icon in iconsCopy) {
-    if ([items indexOfObject:[[icon label] text]] == NSNotFound) {
-      [view performSelectorOnMainThread:@selector(removeIcon:)
-                             withObject:icon
-                          waitUntilDone:YES];
+    if ([itemsSet containsObject:[[icon label] text]] == NO) {
+      [iconsToRemove addObject:icon];
     }
   }
+  if ([iconsToRemove count] > 0) {
+    [self performSelectorOnMainThread:@selector(_removeIcons:)
+                           withObject:iconsToRemove
+                        waitUntilDone:NO];
+  }
 
   // Leave in `items` array items to add.
+  for (NXTIcon *icon in iconsCopy) {
+    if ([icon labelString] != nil) {
+      [labels addObject:[icon labelString]];
+    }
+  }
+  [items removeAllObjects];
   for (NSString *filename in itemsCopy) {
-    icon = [view iconWithLabelString:filename];
-    if (icon) {
-      [items removeObject:filename];
+    if ([labels containsObject:filename] == NO) {
+      [items addObject:filename];
     }
   }
   [itemsCopy release];
   [iconsCopy release];
 }
 
+// Main thread
+- (void)_removeIcons:(NSArray *)icons
+{
+  if ([self isCancelled] == NO) {
+    [viewer itemsLoader:self willRemoveIcons:icons];
+    [iconView removeIcons:icons];
+  }
+}
+
+// Main thread
+- (void)_addIcons:(NSArray *)icons
+{
+  if ([self isCancelled] == NO) {
+    [viewer itemsLoader:self willAddIcons:icons];
+    [iconView addIcons:icons];
+  }
+}
+
+// Main thread
+- (void)_didAddIcons
+{
+  if ([self isCancelled] == NO) {
+    [viewer itemsLoaderDidAddIcons:self];
+  }
+}
+
+// Main thread
+- (void)_selectIcons:(NSMutableSet *)icons
+{
+  NXTIcon *icon;
+
+  if ([self isCancelled] != NO) {
+    return;
+  }
+
+  if ((isUpdate != NO) && selectedFiles && ([selectedFiles count] != [icons count])) {
+    for (NSString *filename in selectedFiles) {
+      if ((icon = [iconView iconWithLabelString:filename])) {
+        [icons addObject:icon];
+      }
+    }
+  }
+  [iconView selectIcons:icons];
+}
+
+// Main thread. `batch` contains icon, image and the image icon had when
+// batch was built (placeholder).
+- (void)_setIconImages:(NSArray *)batch
+{
+  NXTIcon *icon;
+
+  if ([self isCancelled] != NO) {
+    return;
+  }
+
+  for (NSArray *item in batch) {
+    icon = [item objectAtIndex:0];
+    // Image was set by -fileIconDidChange: meanwhile, it's newer than the
+    // one from batch.
+    if ([icon iconImage] != [item objectAtIndex:2]) {
+      continue;
+    }
+    [icon setIconImage:[item objectAtIndex:1]];
+  }
+}
+
+- (void)setVisibleIcons:(NSArray *)icons
+{
+  [visibleIconsLock lock];
+  ASSIGN(visibleIcons, icons);
+  [visibleIconsLock unlock];
+}
+
+// Returns index of icon which image should be resolved next: visible icons
+// first, then icons below them and then icons above. Indexes are positions
+// in the loader's `icons' array. Icon view slots can't be used for that:
+// on update loaded icons are added after (or between) icons already shown.
+- (NSUInteger)_nextIconIndex:(NSIndexSet *)unresolved
+                     indexes:(NSMapTable *)iconIndexes
+{
+  NSArray    *visible;
+  NSUInteger index, lastVisible = NSNotFound;
+
+  [visibleIconsLock lock];
+  visible = [visibleIcons retain];
+  [visibleIconsLock unlock];
+
+  for (NXTIcon *icon in visible) {
+    // Stored as index + 1, icons not loaded by receiver are not there
+    index = (NSUInteger)NSMapGet(iconIndexes, icon);
+    if (index == 0) {
+      continue;
+    }
+    index--;
+    if ([unresolved containsIndex:index]) {
+      [visible release];
+      return index;
+    }
+    if (lastVisible == NSNotFound || index > lastVisible) {
+      lastVisible = index;
+    }
+  }
+  [visible release];
+
+  if (lastVisible != NSNotFound) {
+    index = [unresolved indexGreaterThanIndex:lastVisible];
+    if (index != NSNotFound) {
+      return index;
+    }
+  }
+
+  return [unresolved firstIndex];
+}
+
 - (void)main
 {
-  NSString       *path;
-  PathIcon       *anIcon;
-  NSUInteger     x, y, slotsWide, slotsTallVisible;
-  NSMutableSet   *selectedIcons = [NSMutableSet new];
-  NSMutableArray *iconsToAdd = [NSMutableArray new];
+  NSString          *path;
+  PathIcon          *anIcon;
+  NSImage           *placeholder, *image;
+  NSUInteger        pageSize, index;
+  NSMutableSet      *selectedIcons;
+  NSMutableArray    *icons, *iconsToAdd, *batch;
+  NSMutableIndexSet *unresolved;
+  NSMapTable        *iconIndexes;
+  NSTimeInterval    lastFlush;
 
   if (isAnimate != NO) {
     [iconView performSelectorOnMainThread:@selector(drawOpenAnimation)
@@ -104,74 +253,102 @@
 
   NSDebugLLog(@"IconViewer", @"IconView: Begin path loading... %@ [%@]", directoryPath, selectedFiles);
 
-  x = y = 0;
-  slotsWide = [iconView slotsWide];
-  slotsTallVisible = [iconView slotsTallVisible];
+  pageSize = [iconView slotsWide] * ([iconView slotsTallVisible] + 1);
 
   if (isUpdate != NO) {
     [self _updateItems:directoryContents fileView:iconView];
   }
-  
+
+  // Publish icons with placeholder image for the whole listing: first page
+  // is added as soon as it's ready, the rest - at once.
+  placeholder = [NSImage imageNamed:@"common_Unknown"];
   selectedIcons = [NSMutableSet new];
+  icons = [NSMutableArray new];
   iconsToAdd = [NSMutableArray new];
-  
+  iconIndexes = NSCreateMapTable(NSNonRetainedObjectMapKeyCallBacks, NSIntegerMapValueCallBacks,
+                                 [directoryContents count]);
+
   for (NSString *filename in directoryContents) {
+    if ([self isCancelled] != NO) {
+      break;
+    }
     path = [directoryPath stringByAppendingPathComponent:filename];
 
     anIcon = [[PathIcon alloc] init];
     [anIcon setLabelString:filename];
-    [anIcon setIconImage:[[NSApp delegate] iconForFile:path]];
+    [anIcon setIconImage:placeholder];
     [anIcon setPaths:[NSArray arrayWithObject:path]];
 
+    [icons addObject:anIcon];
+    NSMapInsert(iconIndexes, anIcon, (void *)[icons count]);
     [iconsToAdd addObject:anIcon];
     if ([selectedFiles containsObject:filename]) {
       [selectedIcons addObject:anIcon];
     }
     [anIcon release];
 
-    x++;
-    if (x == slotsWide) {
-      y++;
-      x = 0;
-    }
-    // Add icons on per page basis
-    if (y == slotsTallVisible && [iconView isAnimating] == NO) {
-      [iconView performSelectorOnMainThread:@selector(addIcons:)
-                                 withObject:iconsToAdd
-                              waitUntilDone:YES];
+    if ([icons count] == pageSize && [iconView isAnimating] == NO) {
+      [self performSelectorOnMainThread:@selector(_addIcons:)
+                             withObject:[[iconsToAdd copy] autorelease]
+                          waitUntilDone:NO];
       [iconsToAdd removeAllObjects];
-      x = y = 0;
     }
   }
-
   if ([iconsToAdd count] > 0) {
-    [iconView performSelectorOnMainThread:@selector(addIcons:)
-                               withObject:iconsToAdd
-                            waitUntilDone:YES];
-    [iconsToAdd removeAllObjects];
+    [self performSelectorOnMainThread:@selector(_addIcons:)
+                           withObject:[[iconsToAdd copy] autorelease]
+                        waitUntilDone:NO];
   }
-  
-  if ((isUpdate != NO) &&
-      selectedFiles &&
-      ([selectedFiles count] != [selectedIcons count])) {
-    NXTIcon *icon;
-    for (NSString *filename in selectedFiles) {
-      if ((icon = [iconView iconWithLabelString:filename])) {
-        [selectedIcons addObject:icon];
+  [iconsToAdd release];
+
+  [self performSelectorOnMainThread:@selector(_selectIcons:)
+                         withObject:selectedIcons
+                      waitUntilDone:NO];
+  [selectedIcons release];
+  // Icons are usable now, only images are placeholders
+  [self performSelectorOnMainThread:@selector(_didAddIcons)
+                         withObject:nil
+                      waitUntilDone:NO];
+
+  // Resolve real images. Visible icons go first - visible range is updated
+  // by viewer on scroll. Images are delivered to main thread in batches.
+  unresolved = [[NSMutableIndexSet alloc] initWithIndexesInRange:NSMakeRange(0, [icons count])];
+  batch = [NSMutableArray new];
+  lastFlush = [NSDate timeIntervalSinceReferenceDate];
+
+  while ([unresolved count] > 0 && [self isCancelled] == NO) {
+    @autoreleasepool {
+      index = [self _nextIconIndex:unresolved indexes:iconIndexes];
+      [unresolved removeIndex:index];
+
+      anIcon = [icons objectAtIndex:index];
+      image = [[NSApp delegate] fastIconForFile:[[anIcon paths] firstObject]];
+      if (image != nil && image != placeholder) {
+        [batch addObject:@[anIcon, image, placeholder]];
+      }
+
+      if ([batch count] >= ITEMS_LOADER_BATCH_SIZE ||
+          ([batch count] > 0 &&
+           [NSDate timeIntervalSinceReferenceDate] - lastFlush > ITEMS_LOADER_BATCH_INTERVAL)) {
+        [self performSelectorOnMainThread:@selector(_setIconImages:)
+                               withObject:[[batch copy] autorelease]
+                            waitUntilDone:NO];
+        [batch removeAllObjects];
+        lastFlush = [NSDate timeIntervalSinceReferenceDate];
       }
     }
   }
-  [iconView performSelectorOnMainThread:@selector(selectIcons:)
-                             withObject:selectedIcons
-                          waitUntilDone:YES];
-  
+  if ([batch count] > 0 && [self isCancelled] == NO) {
+    [self performSelectorOnMainThread:@selector(_setIconImages:)
+                           withObject:[[batch copy] autorelease]
+                        waitUntilDone:NO];
+  }
+
   NSDebugLLog(@"IconViewer", @"IconView: End path loading...");
-  [selectedIcons release];
-  [iconsToAdd release];
-  
-  [directoryPath release];
-  [directoryContents release];
-  [selectedFiles release];
+  [batch release];
+  [unresolved release];
+  NSFreeMapTable(iconIndexes);
+  [icons release];
 }
 
 - (BOOL)isReady
@@ -290,6 +467,7 @@ static NSRect viewFrame;
   TEST_RELEASE(rootPath);
   TEST_RELEASE(currentPath);
   TEST_RELEASE(selection);
+  TEST_RELEASE(iconsByName);
 
   TEST_RELEASE(view);
 
@@ -312,6 +490,9 @@ static NSRect viewFrame;
   [iconView setSendsDoubleActionOnReturn:YES];
   [iconView setDoubleAction:@selector(open:)];
   [iconView setAutoAdjustsToFitIcons:YES];
+  // Directories may contain thousands of files - layout and display only
+  // visible icons. Icons for all files are still created.
+  [iconView setVirtualized:YES];
   iconSize = [NXTIconView defaultSlotSize];
   if ([[OSEDefaults userDefaults] objectForKey:@"IconSlotWidth"]) {
     iconSize.width = [[OSEDefaults userDefaults] floatForKey:@"IconSlotWidth"]; 
@@ -328,6 +509,11 @@ static NSRect viewFrame;
   [view setDocumentView:iconView];
   [iconView setFrame:NSMakeRect(0, 0, [[view contentView] frame].size.width, 0)];
   [iconView setAutoresizingMask:(NSViewWidthSizable|NSViewHeightSizable)];
+  [[view contentView] setPostsBoundsChangedNotifications:YES];
+  [[NSNotificationCenter defaultCenter] addObserver:self
+                                           selector:@selector(iconViewDidScroll:)
+                                               name:NSViewBoundsDidChangeNotification
+                                             object:[view contentView]];
   
   // Operation
   operationQ = [[NSOperationQueue alloc] init];
@@ -339,10 +525,16 @@ static NSRect viewFrame;
              selector:@selector(iconWidthDidChange:)
                  name:@"IconSlotWidthDidChangeNotification"
                object:nil];
+  [[NSNotificationCenter defaultCenter]
+          addObserver:self
+             selector:@selector(fileIconDidChange:)
+                 name:WMFileIconDidChangeNotification
+               object:nil];
   
   currentPath = nil;
   selection = nil;
   rootPath = @"/";
+  iconsByName = [NSMutableDictionary new];
   
   [iconView release];
   
@@ -467,19 +659,18 @@ static NSRect viewFrame;
 
   if (updateOnDisplay == NO) {
     [iconView removeAllIcons];
+    [iconsByName removeAllObjects];
     // [iconView display];
   }
   dirContents = [_owner directoryContentsAtPath:dirPath forPath:nil];
-  itemsLoader = [[ViewerItemsLoader alloc] initWithIconView:iconView
-                                                       path:path
-                                                   contents:dirContents
-                                                  selection:filenames
-                                                     update:updateOnDisplay
-                                                    animate:doAnimation];
-  [itemsLoader addObserver:self
-                forKeyPath:@"isFinished"
-                   options:0
-                   context:self];
+  itemsLoader = [[ViewerItemsLoader alloc] initWithViewer:self
+                                                 iconView:iconView
+                                                     path:path
+                                                 contents:dirContents
+                                                selection:filenames
+                                                   update:updateOnDisplay
+                                                  animate:doAnimation];
+  [itemsLoader setVisibleIcons:[self _visibleIcons]];
   [operationQ addOperation:itemsLoader];
   [_owner setWindowEdited:YES];
 }
@@ -553,7 +744,11 @@ static NSRect viewFrame;
   NSString *path;
 
   if (icon) {
+    if ([icon labelString] != nil) {
+      [iconsByName removeObjectForKey:[icon labelString]];
+    }
     [icon setLabelString:[newName lastPathComponent]];
+    [iconsByName setObject:icon forKey:[newName lastPathComponent]];
     path = [rootPath stringByAppendingPathComponent:newName];
     [icon setIconImage:[[NSApp delegate] iconForFile:path]];
   } else {
@@ -571,16 +766,40 @@ static NSRect viewFrame;
   [iconView setSlotSize:slotSize];
 }
 
-// -- NSOperation
-- (void)observeValueForKeyPath:(NSString *)keyPath
-                      ofObject:(id)object
-                        change:(NSDictionary *)change
-                       context:(void *)context
+- (void)fileIconDidChange:(NSNotification *)notification
+{
+  NSString *path = [notification userInfo][@"Path"];
+  NSString *name;
+  NXTIcon  *icon;
+
+  if ([[path stringByDeletingLastPathComponent] isEqualToString:[self fullPath]] == NO) {
+    return;
+  }
+  name = [path lastPathComponent];
+  icon = [iconsByName objectForKey:name];
+  // Label may have been edited in place
+  if (icon == nil || [[icon labelString] isEqualToString:name] == NO) {
+    icon = [iconView iconWithLabelString:name];
+    if (icon != nil) {
+      [iconsByName setObject:icon forKey:name];
+    }
+  }
+  if (icon) {
+    [icon setIconImage:[notification userInfo][@"Icon"]];
+  }
+}
+
+// -- Items loader
+// Icons are set up as they are added with placeholder images, so they can
+// be clicked, dragged and renamed while loader is resolving real images.
+- (void)itemsLoader:(ViewerItemsLoader *)loader willAddIcons:(NSArray *)icons
 {
   NXTIconLabel *iconLabel;
-  
-  NSDebugLLog(@"IconViewer", @"IconView: Observer `%@` of '%@' was called.", [self className], keyPath);
-  for (NXTIcon *icon in [iconView icons]) {
+
+  for (NXTIcon *icon in icons) {
+    if ([icon labelString] != nil) {
+      [iconsByName setObject:icon forKey:[icon labelString]];
+    }
     [icon setEditable:YES];
     [icon setDelegate:self];
     [icon setTarget:self];
@@ -591,20 +810,79 @@ static NSRect viewFrame;
     [iconLabel setNextKeyView:iconView];
     [iconLabel setIconLabelDelegate:_owner];
   }
+}
+
+- (void)itemsLoader:(ViewerItemsLoader *)loader willRemoveIcons:(NSArray *)icons
+{
+  for (NXTIcon *icon in icons) {
+    if ([icon labelString] != nil && [iconsByName objectForKey:[icon labelString]] == icon) {
+      [iconsByName removeObjectForKey:[icon labelString]];
+    }
+  }
+}
+
+- (void)itemsLoaderDidAddIcons:(ViewerItemsLoader *)loader
+{
+  NSDebugLLog(@"IconViewer", @"IconView: all icons of %@ are added.", currentPath);
 
   // [iconView scrollPoint:NSZeroPoint];
-  [iconView performSelectorOnMainThread:@selector(adjustToFitIcons)
-                             withObject:nil
-                          waitUntilDone:YES];
+  [iconView adjustToFitIcons];
   [[view window] makeFirstResponder:iconView];
   [_owner setWindowEdited:NO];
   updateOnDisplay = NO;
   doAnimation = NO;
+
+  // Icons are in their slots now
+  [loader setVisibleIcons:[self _visibleIcons]];
 }
 
 //=============================================================================
 // Local
 //=============================================================================
+// Range of icon indexes in visible part of icon view
+- (NSRange)_visibleIconsRange
+{
+  NSRect     r = [iconView visibleRect];
+  NSSize     slotSize = [iconView slotSize];
+  NSUInteger slotsWide = [iconView slotsWide];
+  NSUInteger firstRow, lastRow;
+
+  if (slotsWide == 0 || slotSize.height <= 0) {
+    return NSMakeRange(0, 0);
+  }
+  firstRow = floorf(NSMinY(r) / slotSize.height);
+  lastRow = ceilf(NSMaxY(r) / slotSize.height);
+
+  return NSMakeRange(firstRow * slotsWide, (lastRow - firstRow) * slotsWide);
+}
+
+// Icons in visible part of icon view
+- (NSArray *)_visibleIcons
+{
+  NSArray        *icons = [iconView icons];
+  NSRange        range = [self _visibleIconsRange];
+  NSMutableArray *visible = [NSMutableArray array];
+  Class          iconClass = [NXTIcon class];
+  NSUInteger     i, last;
+
+  last = MIN(NSMaxRange(range), [icons count]);
+  for (i = range.location; i < last; i++) {
+    id icon = [icons objectAtIndex:i];
+    if ([icon isKindOfClass:iconClass]) {
+      [visible addObject:icon];
+    }
+  }
+
+  return visible;
+}
+
+- (void)iconViewDidScroll:(NSNotification *)aNotif
+{
+  if (itemsLoader != nil && [itemsLoader isFinished] == NO) {
+    [itemsLoader setVisibleIcons:[self _visibleIcons]];
+  }
+}
+
 //
 // --- NXTIconView delegate
 //
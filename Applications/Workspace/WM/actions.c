@@ -53,6 +53,7 @@
 #include "event.h"
 #include "animations.h"
 #include "iconyard.h"
+#include "capture.h"
 
 #include "actions.h"
 
@@ -1000,7 +1001,6 @@ void wIconifyWindow(WWindow *wwin)
     /* extract the window screenshot everytime, as the option can be enable anytime */
     if (wwin->client_win && wwin->flags.mapped) {
       RImage *mini_preview;
-      XImage *pimg;
       unsigned int w, h;
       int x, y;
       Window baz;
@@ -1017,26 +1017,22 @@ void wIconifyWindow(WWindow *wwin)
       if (y - attribs.y + attribs.height > wwin->screen->height)
         h = wwin->screen->height - y + attribs.y;
 
-      pimg = XGetImage(dpy, wwin->client_win, 0, 0, w, h, AllPlanes, ZPixmap);
-      if (pimg) {
-        mini_preview = RCreateImageFromXImage(wwin->screen->rcontext, pimg, NULL);
-        XDestroyImage(pimg);
+      mini_preview = wCaptureWindow(wwin, w, h);
+      if (mini_preview) {
+        /* scaled down in background */
+        wIconSetMiniPreviewForWindow(wwin, mini_preview);
+        RReleaseImage(mini_preview);
+      } else {
+        const char *title;
+        char title_buf[32];
 
-        if (mini_preview) {
-          set_icon_minipreview(wwin->icon, mini_preview);
-          RReleaseImage(mini_preview);
+        if (wwin->frame->title) {
+          title = wwin->frame->title;
         } else {
-          const char *title;
-          char title_buf[32];
-
-          if (wwin->frame->title) {
-            title = wwin->frame->title;
-          } else {
-            snprintf(title_buf, sizeof(title_buf), "(id=0x%lx)", wwin->client_win);
-            title = title_buf;
-          }
-          WMLogWarning(_("creation of mini-preview failed for window \"%s\""), title);
+          snprintf(title_buf, sizeof(title_buf), "(id=0x%lx)", wwin->client_win);
+          title = title_buf;
         }
+        WMLogWarning(_("creation of mini-preview failed for window \"%s\""), title);
       }
     }
   }
@@ -46,6 +46,7 @@
 #include "xrandr.h"
 #include "stacking.h"
 #include "defaults.h"
+#include "capture.h"
 
 #include "animations.h"
 
@@ -215,7 +216,7 @@ Pixmap MakeGhostIcon(WScreen *scr, Drawable drawable)
   if (!drawable)
     return None;
 
-  back = RCreateImageFromDrawable(scr->rcontext, drawable, None);
+  back = wCaptureDrawable(scr, drawable, 0, 0, 0, 0);
   if (!back)
     return None;
 
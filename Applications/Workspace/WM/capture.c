@@ -0,0 +1,324 @@
+/*
+ *  Workspace window manager
+ *  Copyright (c) 2015-2021 Sergii Stoian
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Window and drawable contents capture.
+ *
+ * Pixels are read through MIT-SHM segment which is allocated once and reused
+ * (grown if needed) by subsequent captures, so big windows are not copied
+ * through the X connection. If Composer is active window contents is read
+ * from the composite pixmap of window frame. XGetImage() is used as fallback
+ * for remote displays.
+ */
+
+#include "WM.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xcomposite.h>
+#ifdef USE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
+#include <dispatch/dispatch.h>
+#include <CoreFoundation/CFRunLoop.h>
+
+#include <core/util.h>
+#include <core/log_utils.h>
+
+#include "screen.h"
+#include "window.h"
+#include "framewin.h"
+#include "capture.h"
+
+#include <Workspace+WM.h>
+
+static Bool captureError;
+
+static int catchCaptureError(Display *dpy, XErrorEvent *error)
+{
+  captureError = True;
+  return 0;
+}
+
+#ifdef USE_XSHM
+
+/* Shared memory segment reused by all captures */
+static struct {
+  XShmSegmentInfo info;
+  size_t size;
+  Bool attached;
+  Bool unsupported; /* no MIT-SHM or remote display */
+} segment;
+
+static void releaseSegment(void)
+{
+  if (!segment.attached)
+    return;
+
+  XShmDetach(dpy, &segment.info);
+  XSync(dpy, False);
+  if (shmdt(segment.info.shmaddr) < 0) {
+    WMLogWarning("capture: failed to detach shared memory segment: %s", strerror(errno));
+  }
+  segment.attached = False;
+  segment.size = 0;
+}
+
+static Bool ensureSegmentSize(size_t size)
+{
+  int (*oldHandler)(Display *, XErrorEvent *);
+
+  if (segment.unsupported)
+    return False;
+  if (segment.attached && segment.size >= size)
+    return True;
+
+  releaseSegment();
+
+  if (!XShmQueryExtension(dpy)) {
+    segment.unsupported = True;
+    return False;
+  }
+
+  /* round up to 1MB to avoid reallocation for windows of similar size */
+  size = (size + 0xfffff) & ~((size_t)0xfffff);
+
+  segment.info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (segment.info.shmid < 0) {
+    WMLogWarning("capture: failed to create shared memory segment: %s", strerror(errno));
+    return False;
+  }
+  segment.info.shmaddr = shmat(segment.info.shmid, NULL, 0);
+  if (segment.info.shmaddr == (void *)-1) {
+    WMLogWarning("capture: failed to attach shared memory segment: %s", strerror(errno));
+    shmctl(segment.info.shmid, IPC_RMID, NULL);
+    return False;
+  }
+  segment.info.readOnly = False;
+
+  captureError = False;
+  XSync(dpy, False);
+  oldHandler = XSetErrorHandler(catchCaptureError);
+  XShmAttach(dpy, &segment.info);
+  XSync(dpy, False);
+  XSetErrorHandler(oldHandler);
+
+  /* segment will be destroyed on last detach */
+  shmctl(segment.info.shmid, IPC_RMID, NULL);
+
+  if (captureError) {
+    shmdt(segment.info.shmaddr);
+    segment.unsupported = True;
+    return False;
+  }
+
+  segment.attached = True;
+  segment.size = size;
+
+  return True;
+}
+
+static RImage *captureWithSHM(WScreen *scr, Drawable drawable, Visual *visual, int depth, int x,
+                              int y, unsigned width, unsigned height)
+{
+  int (*oldHandler)(Display *, XErrorEvent *);
+  XImage *ximage;
+  RImage *image = NULL;
+  Status status;
+
+  ximage = XShmCreateImage(dpy, visual, depth, ZPixmap, NULL, &segment.info, width, height);
+  if (!ximage)
+    return NULL;
+
+  if (!ensureSegmentSize((size_t)ximage->bytes_per_line * height)) {
+    XDestroyImage(ximage);
+    return NULL;
+  }
+  ximage->data = segment.info.shmaddr;
+
+  captureError = False;
+  oldHandler = XSetErrorHandler(catchCaptureError);
+  status = XShmGetImage(dpy, drawable, ximage, x, y, AllPlanes);
+  XSetErrorHandler(oldHandler);
+
+  if (status && !captureError) {
+    image = RCreateImageFromXImage(scr->rcontext, ximage, NULL);
+  }
+
+  /* data belongs to the segment */
+  ximage->data = NULL;
+  XDestroyImage(ximage);
+
+  return image;
+}
+
+#endif /* USE_XSHM */
+
+static RImage *captureDrawable(WScreen *scr, Drawable drawable, Visual *visual, int depth, int x,
+                               int y, unsigned width, unsigned height)
+{
+  int (*oldHandler)(Display *, XErrorEvent *);
+  XImage *ximage;
+  RImage *image;
+
+  if (width == 0 || height == 0)
+    return NULL;
+
+#ifdef USE_XSHM
+  if (visual) {
+    image = captureWithSHM(scr, drawable, visual, depth, x, y, width, height);
+    if (image)
+      return image;
+  }
+#endif
+
+  captureError = False;
+  oldHandler = XSetErrorHandler(catchCaptureError);
+  ximage = XGetImage(dpy, drawable, x, y, width, height, AllPlanes, ZPixmap);
+  XSetErrorHandler(oldHandler);
+
+  if (!ximage)
+    return NULL;
+
+  image = RCreateImageFromXImage(scr->rcontext, ximage, NULL);
+  XDestroyImage(ximage);
+
+  return image;
+}
+
+RImage *wCaptureDrawable(WScreen *scr, Drawable drawable, int x, int y, unsigned width,
+                         unsigned height)
+{
+  Window root;
+  int junk;
+  unsigned ujunk, depth;
+  Visual *visual = NULL;
+
+  if (width == 0 || height == 0) {
+    if (!XGetGeometry(dpy, drawable, &root, &junk, &junk, &width, &height, &ujunk, &depth))
+      return NULL;
+  } else if (!XGetGeometry(dpy, drawable, &root, &junk, &junk, &ujunk, &ujunk, &ujunk, &depth)) {
+    return NULL;
+  }
+
+  if (depth == scr->rcontext->depth)
+    visual = scr->rcontext->visual;
+
+  return captureDrawable(scr, drawable, visual, depth, x, y, width, height);
+}
+
+static Bool composerIsActive(WScreen *scr)
+{
+  static Atom net_wm_cm = None;
+  char buf[32];
+
+  if (net_wm_cm == None) {
+    snprintf(buf, sizeof(buf), "_NET_WM_CM_S%d", scr->screen);
+    net_wm_cm = XInternAtom(dpy, buf, False);
+  }
+
+  return (XGetSelectionOwner(dpy, net_wm_cm) != None);
+}
+
+RImage *wCaptureWindow(WWindow *wwin, unsigned width, unsigned height)
+{
+  WScreen *scr = wwin->screen;
+  XWindowAttributes attribs;
+  RImage *image = NULL;
+
+  if (wwin->frame && composerIsActive(scr)) {
+    int (*oldHandler)(Display *, XErrorEvent *);
+    Pixmap pixmap;
+    Bool havePixmap;
+    Window junk;
+    int x, y;
+
+    /* frame is redirected - its pixmap contains contents of obscured parts */
+    captureError = False;
+    oldHandler = XSetErrorHandler(catchCaptureError);
+    pixmap = XCompositeNameWindowPixmap(dpy, wwin->frame->core->window);
+    XSync(dpy, False);
+    XSetErrorHandler(oldHandler);
+    /* captureDrawable() reuses captureError - remember our result */
+    havePixmap = !captureError;
+
+    if (havePixmap &&
+        XTranslateCoordinates(dpy, wwin->client_win, wwin->frame->core->window, 0, 0, &x, &y,
+                              &junk) &&
+        XGetWindowAttributes(dpy, wwin->frame->core->window, &attribs)) {
+      image = captureDrawable(scr, pixmap, attribs.visual, attribs.depth, x, y, width, height);
+    }
+    if (havePixmap) {
+      XFreePixmap(dpy, pixmap);
+    }
+    if (image)
+      return image;
+  }
+
+  if (!XGetWindowAttributes(dpy, wwin->client_win, &attribs))
+    return NULL;
+
+  return captureDrawable(scr, wwin->client_win, attribs.visual, attribs.depth, 0, 0, width,
+                         height);
+}
+
+void wCaptureScaleImage(RImage *image, unsigned width, unsigned height,
+                        void (*handler)(RImage *scaled, void *data), void *data)
+{
+  CFRunLoopRef runloop = wm_runloop;
+
+  if (runloop == NULL) {
+    RImage *scaled = RSmoothScaleImage(image, width, height);
+
+    handler(scaled, data);
+    if (scaled)
+      RReleaseImage(scaled);
+    return;
+  }
+
+  /* `image` is retained and released in WM thread only. Scaling queue just
+     reads its pixels. */
+  RRetainImage(image);
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+    RImage *scaled = RSmoothScaleImage(image, width, height);
+
+    CFRunLoopPerformBlock(runloop, kCFRunLoopDefaultMode, ^{
+      handler(scaled, data);
+      if (scaled)
+        RReleaseImage(scaled);
+      RReleaseImage(image);
+    });
+    CFRunLoopWakeUp(runloop);
+  });
+}
+
+void wCaptureCleanup(WScreen *scr)
+{
+#ifdef USE_XSHM
+  releaseSegment();
+#endif
+}
@@ -0,0 +1,43 @@
+/*
+ *  Workspace window manager
+ *  Copyright (c) 2015-2021 Sergii Stoian
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WORKSPACE_WM_CAPTURE__
+#define __WORKSPACE_WM_CAPTURE__
+
+#include <X11/Xlib.h>
+#include <wraster.h>
+
+#include "screen.h"
+#include "window.h"
+
+/* Captures contents of drawable area. Whole drawable is captured if `width`
+   or `height` is 0. Returns NULL on failure. */
+RImage *wCaptureDrawable(WScreen *scr, Drawable drawable, int x, int y, unsigned width,
+                         unsigned height);
+/* Captures client area of window. Obscured parts are captured correctly
+   only if Composer is active. */
+RImage *wCaptureWindow(WWindow *wwin, unsigned width, unsigned height);
+/* Scales `image` to `width`x`height` in background and calls `handler`
+   in WM run loop. `handler` receives NULL if scaling failed. */
+void wCaptureScaleImage(RImage *image, unsigned width, unsigned height,
+                        void (*handler)(RImage *scaled, void *data), void *data);
+/* Releases shared memory segment used for captures. */
+void wCaptureCleanup(WScreen *scr);
+
+#endif /* __WORKSPACE_WM_CAPTURE__ */
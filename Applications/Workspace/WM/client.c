@@ -193,22 +193,36 @@ void wClientConfigure(WWindow *wwin, XConfigureRequestEvent *xcre)
 #endif
   if (xcre->value_mask & CWStackMode) {
     WObjDescriptor *desc;
-    WWindow *sibling;
+    WWindow *sibling = NULL;
+    WCoreWindow *frame = wwin->frame->core;
 
     if ((xcre->value_mask & CWSibling) &&
         (XFindContext(dpy, xcre->above, w_global.context.client_win, (XPointer *)&desc) ==
          XCSUCCESS) &&
         (desc->parent_type == WCLASS_WINDOW)) {
       sibling = desc->parent;
-      xwc.sibling = sibling->frame->core->window;
+    }
+
+    /* Restack in the stacking list when possible and ask X server otherwise */
+    if (!(xcre->value_mask & CWSibling) && xcre->detail == Above) {
+      wRaiseFrame(frame);
+    } else if (!(xcre->value_mask & CWSibling) && xcre->detail == Below) {
+      wLowerFrame(frame);
+    } else if (sibling && sibling->frame && sibling != wwin &&
+               WINDOW_LEVEL(sibling) == WINDOW_LEVEL(wwin) &&
+               (xcre->detail == Above || xcre->detail == Below)) {
+      if (xcre->detail == Above) {
+        MoveInStackListAbove(sibling->frame->core, frame);
+      } else {
+        MoveInStackListUnder(sibling->frame->core, frame);
+      }
     } else {
-      xwc.sibling = xcre->above;
+      xwc.sibling = (sibling && sibling->frame) ? sibling->frame->core->window : xcre->above;
+      xwc.stack_mode = xcre->detail;
+      XConfigureWindow(dpy, frame->window, xcre->value_mask & (CWSibling | CWStackMode), &xwc);
+      /* fix stacking order */
+      RemakeStackList(wwin->screen);
     }
-    xwc.stack_mode = xcre->detail;
-    XConfigureWindow(dpy, wwin->frame->core->window, xcre->value_mask & (CWSibling | CWStackMode),
-                     &xwc);
-    /* fix stacking order */
-    RemakeStackList(wwin->screen);
   }
 
   wClientGetGravityOffsets(wwin, &ofs_x, &ofs_y);
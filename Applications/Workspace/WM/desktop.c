@@ -66,6 +66,7 @@
 #include "event.h"
 #include "iconyard.h"
 #include "stacking.h"
+#include "capture.h"
 
 #define WORKSPACE_NAME_DISPLAY_PADDING 32
 /* workspace name on switch display */
@@ -145,7 +146,6 @@ static void _hideWorkspaceName(CFRunLoopTimerRef timer, void *data)  // (void *d
 static void _showWorkspaceName(WScreen *scr, int workspace)
 {
   WorkspaceNameData *data;
-  RXImage *ximg;
   Pixmap text, mask;
   int w, h;
   int px, py;
@@ -283,20 +283,14 @@ static void _showWorkspaceName(WScreen *scr, int workspace)
     goto erro;
   }
 
-  ximg = RGetXImage(scr->rcontext, scr->root_win, px, py, data->text->width, data->text->height);
-  if (!ximg)
+  data->back =
+      wCaptureDrawable(scr, scr->root_win, px, py, data->text->width, data->text->height);
+  if (!data->back)
     goto erro;
 
   XMapRaised(dpy, scr->workspace_name);
   XFlush(dpy);
 
-  data->back = RCreateImageFromXImage(scr->rcontext, ximg->image, NULL);
-  RDestroyXImage(scr->rcontext, ximg);
-
-  if (!data->back) {
-    goto erro;
-  }
-
   data->count = 10;
 
   /* set a timeout for the effect */
@@ -519,6 +513,9 @@ void wDesktopForceChange(WScreen *scr, int workspace, WWindow *focus_win)
   scr->last_desktop = scr->current_desktop;
   scr->current_desktop = workspace;
 
+  /* restack windows of the new desktop with one request */
+  BeginStackingTransaction(scr);
+
   tmp = scr->focused_window;
   if (tmp != NULL) {
     WWindow **toUnmap;
@@ -656,6 +653,8 @@ void wDesktopForceChange(WScreen *scr, int workspace, WWindow *focus_win)
     wfree(toMap);
   }
 
+  CommitStackingTransaction(scr);
+
   /* We need to always arrange icons when changing workspace, even if
    * no autoarrange icons, because else the icons in different desktops
    * can be superposed.
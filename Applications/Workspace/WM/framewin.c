@@ -180,10 +180,10 @@ void wFrameWindowUpdateBorders(WFrameWindow *fwin, int flags)
     } else {
       /* we had a titlebar, but now we don't need it anymore */
       for (i = 0; i < (fwin->flags.single_texture ? 1 : 3); i++) {
-        FREE_PIXMAP(fwin->title_back[i]);
+        RELEASE_PIXMAP(fwin->title_back[i]);
         if (wPreferences.titlebar_style == TS_NEW) {
-          FREE_PIXMAP(fwin->lbutton_back[i]);
-          FREE_PIXMAP(fwin->rbutton_back[i]);
+          RELEASE_PIXMAP(fwin->lbutton_back[i]);
+          RELEASE_PIXMAP(fwin->rbutton_back[i]);
         }
       }
       if (fwin->left_button)
@@ -297,6 +297,7 @@ void wFrameWindowUpdateBorders(WFrameWindow *fwin, int flags)
 
     if (fwin->resizebar) {
       fwin->bottom_width = 0;
+      RELEASE_PIXMAP(fwin->resizebar_back[0]);
       wCoreDestroy(fwin->resizebar);
       fwin->resizebar = NULL;
     }
@@ -387,12 +388,13 @@ void wFrameWindowDestroy(WFrameWindow *fwin)
     wfree(fwin->title);
 
   for (i = 0; i < (fwin->flags.single_texture ? 1 : 3); i++) {
-    FREE_PIXMAP(fwin->title_back[i]);
+    RELEASE_PIXMAP(fwin->title_back[i]);
     if (wPreferences.titlebar_style == TS_NEW) {
-      FREE_PIXMAP(fwin->lbutton_back[i]);
-      FREE_PIXMAP(fwin->rbutton_back[i]);
+      RELEASE_PIXMAP(fwin->lbutton_back[i]);
+      RELEASE_PIXMAP(fwin->rbutton_back[i]);
     }
   }
+  RELEASE_PIXMAP(fwin->resizebar_back[0]);
 
   wfree(fwin);
 }
@@ -661,52 +663,82 @@ static void updateTexture(WFrameWindow *fwin)
 
 static void remakeTexture(WFrameWindow *fwin, int state)
 {
+  WTexture *texture;
   Pixmap pmap, lpmap, rpmap;
 
   if (fwin->title_texture[state] && fwin->titlebar) {
-    FREE_PIXMAP(fwin->title_back[state]);
+    RELEASE_PIXMAP(fwin->title_back[state]);
     if (wPreferences.titlebar_style == TS_NEW) {
-      FREE_PIXMAP(fwin->lbutton_back[state]);
-      FREE_PIXMAP(fwin->rbutton_back[state]);
+      RELEASE_PIXMAP(fwin->lbutton_back[state]);
+      RELEASE_PIXMAP(fwin->rbutton_back[state]);
     }
 
-    if (fwin->title_texture[state]->any.type != WTEX_SOLID) {
+    texture = fwin->title_texture[state];
+    if (texture->any.type != WTEX_SOLID) {
       int left, right;
-      int width;
+      int width, height, param;
+      Bool new_style = (wPreferences.titlebar_style == TS_NEW);
 
       /* eventually surrounded by if new_style */
       left = fwin->left_button && !fwin->flags.hide_left_button && !fwin->flags.lbutton_dont_fit;
       right = fwin->right_button && !fwin->flags.hide_right_button && !fwin->flags.rbutton_dont_fit;
 
       width = fwin->core->width + 1;
-
-      renderTexture(fwin->screen_ptr, fwin->title_texture[state], width, fwin->titlebar->height,
-                    fwin->titlebar->height, fwin->titlebar->height, left, right, &pmap, &lpmap,
-                    &rpmap);
+      height = fwin->titlebar->height;
+      param = wPreferences.titlebar_style | (left ? 0x10 : 0) | (right ? 0x20 : 0);
+
+      /* windows of the same width share title bar pixmaps */
+      pmap = wTextureCacheGetPixmap(texture, WTC_TITLEBAR, width, height, param);
+      lpmap = rpmap = None;
+      if (new_style && left)
+        lpmap = wTextureCacheGetPixmap(texture, WTC_LEFT_BUTTON, width, height, param);
+      if (new_style && right)
+        rpmap = wTextureCacheGetPixmap(texture, WTC_RIGHT_BUTTON, width, height, param);
+
+      if (pmap == None || (new_style && left && lpmap == None) ||
+          (new_style && right && rpmap == None)) {
+        RELEASE_PIXMAP(pmap);
+        RELEASE_PIXMAP(lpmap);
+        RELEASE_PIXMAP(rpmap);
+
+        renderTexture(fwin->screen_ptr, texture, width, height, height, height, left, right,
+                      &pmap, &lpmap, &rpmap);
+
+        pmap = wTextureCacheAddPixmap(texture, WTC_TITLEBAR, width, height, param, pmap);
+        lpmap = wTextureCacheAddPixmap(texture, WTC_LEFT_BUTTON, width, height, param, lpmap);
+        rpmap = wTextureCacheAddPixmap(texture, WTC_RIGHT_BUTTON, width, height, param, rpmap);
+      }
 
       fwin->title_back[state] = pmap;
-      if (wPreferences.titlebar_style == TS_NEW) {
+      if (new_style) {
         fwin->lbutton_back[state] = lpmap;
         fwin->rbutton_back[state] = rpmap;
       }
     }
   }
   if (fwin->resizebar_texture && fwin->resizebar_texture[0] && fwin->resizebar && state == 0) {
-    FREE_PIXMAP(fwin->resizebar_back[0]);
-
-    if (fwin->resizebar_texture[0]->any.type != WTEX_SOLID) {
-      renderResizebarTexture(fwin->screen_ptr, fwin->resizebar_texture[0], fwin->resizebar->width,
-                             fwin->resizebar->height, fwin->resizebar_corner_width, &pmap);
+    RELEASE_PIXMAP(fwin->resizebar_back[0]);
+
+    texture = fwin->resizebar_texture[0];
+    if (texture->any.type != WTEX_SOLID) {
+      int width = fwin->resizebar->width;
+      int height = fwin->resizebar->height;
+      int cwidth = fwin->resizebar_corner_width;
+
+      pmap = wTextureCacheGetPixmap(texture, WTC_RESIZEBAR, width, height, cwidth);
+      if (pmap == None) {
+        renderResizebarTexture(fwin->screen_ptr, texture, width, height, cwidth, &pmap);
+        pmap = wTextureCacheAddPixmap(texture, WTC_RESIZEBAR, width, height, cwidth, pmap);
+      }
 
       fwin->resizebar_back[0] = pmap;
     }
 
     /* this part should be in updateTexture() */
-    if (fwin->resizebar_texture[0]->any.type != WTEX_SOLID)
+    if (texture->any.type != WTEX_SOLID)
       XSetWindowBackgroundPixmap(dpy, fwin->resizebar->window, fwin->resizebar_back[0]);
     else
-      XSetWindowBackground(dpy, fwin->resizebar->window,
-                           fwin->resizebar_texture[0]->solid.normal.pixel);
+      XSetWindowBackground(dpy, fwin->resizebar->window, texture->solid.normal.pixel);
 
     XClearWindow(dpy, fwin->resizebar->window);
   }
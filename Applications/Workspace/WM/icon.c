@@ -66,6 +66,7 @@
 #include "iconyard.h"
 
 #include "dock.h"
+#include "capture.h"
 #include <Workspace+WM.h>
 
 /* Delay when cycling colors of selected icons. */
@@ -617,22 +618,47 @@ void set_icon_image_from_image(WIcon *icon, RImage *image)
   icon->file_image = image;
 }
 
-void set_icon_minipreview(WIcon *icon, RImage *image)
+static void set_icon_scaled_minipreview(WIcon *icon, RImage *scaled_mini_preview)
 {
   Pixmap tmp;
-  RImage *scaled_mini_preview;
   WScreen *scr = icon->core->screen_ptr;
 
-  scaled_mini_preview =
-      RSmoothScaleImage(image, wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
-                        wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER);
-
   if (RConvertImage(scr->rcontext, scaled_mini_preview, &tmp)) {
     if (icon->mini_preview != None)
       XFreePixmap(dpy, icon->mini_preview);
     icon->mini_preview = tmp;
   }
-  RReleaseImage(scaled_mini_preview);
+}
+
+void set_icon_minipreview(WIcon *icon, RImage *image)
+{
+  RImage *scaled_mini_preview;
+
+  scaled_mini_preview =
+      RSmoothScaleImage(image, wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
+                        wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER);
+  if (scaled_mini_preview) {
+    set_icon_scaled_minipreview(icon, scaled_mini_preview);
+    RReleaseImage(scaled_mini_preview);
+  }
+}
+
+static void _miniPreviewDidScale(RImage *scaled, void *data)
+{
+  /* window may be gone while image was scaled */
+  WWindow *wwin = wWindowFor((Window)data);
+
+  if (scaled && wwin && wwin->icon) {
+    set_icon_scaled_minipreview(wwin->icon, scaled);
+  }
+}
+
+/* Sets mini-preview of window icon. Image is scaled in background. */
+void wIconSetMiniPreviewForWindow(WWindow *wwin, RImage *image)
+{
+  wCaptureScaleImage(image, wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
+                     wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
+                     _miniPreviewDidScale, (void *)wwin->client_win);
 }
 
 void wIconUpdate(WIcon *icon)
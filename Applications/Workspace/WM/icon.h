@@ -84,5 +84,6 @@ char *get_name_for_instance_class(const char *wm_instance, const char *wm_class)
 void wIconSetHighlited(WIcon *icon, Bool flag);
 void set_icon_image_from_image(WIcon *icon, RImage *image);
 void set_icon_minipreview(WIcon *icon, RImage *image);
+void wIconSetMiniPreviewForWindow(WWindow *wwin, RImage *image);
 
 #endif /* __WORKSPACE_WM_ICON__ */
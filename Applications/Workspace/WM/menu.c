@@ -730,7 +730,7 @@ void wMenuItemSelect(WMenu *menu, int item_index)
 static Pixmap renderTexture(WMenu *menu)
 {
   RImage *img;
-  Pixmap pix;
+  Pixmap pix = None;
   int i;
   RColor light;
   RColor dark;
@@ -785,9 +785,25 @@ static void updateTexture(WMenu *menu)
   /* setup background texture */
   if (scr->menu_item_texture->any.type != WTEX_SOLID) {
     if (!menu->flags.brother) {
-      FREE_PIXMAP(menu->menu_texture_data);
+      WTexture *texture = scr->menu_item_texture;
+      int width = menu->menu->width;
+      int height, param;
 
-      menu->menu_texture_data = renderTexture(menu);
+      RELEASE_PIXMAP(menu->menu_texture_data);
+
+      /* menus of the same size share texture pixmap */
+      if (wPreferences.menu_style == MS_NORMAL) {
+        height = menu->item_height;
+        param = MS_NORMAL;
+      } else {
+        height = menu->menu->height + 1;
+        param = wPreferences.menu_style | (menu->item_height << 4) | (menu->items_count << 12);
+      }
+      menu->menu_texture_data = wTextureCacheGetPixmap(texture, WTC_MENU, width, height, param);
+      if (menu->menu_texture_data == None) {
+        menu->menu_texture_data =
+            wTextureCacheAddPixmap(texture, WTC_MENU, width, height, param, renderTexture(menu));
+      }
 
       XSetWindowBackgroundPixmap(dpy, menu->menu->window, menu->menu_texture_data);
       XClearWindow(dpy, menu->menu->window);
@@ -937,7 +953,7 @@ void wMenuDestroy(WMenu *menu, int recurse)
     }
   }
 
-  FREE_PIXMAP(menu->menu_texture_data);
+  RELEASE_PIXMAP(menu->menu_texture_data);
 
   if (menu->submenus) {
     wfree(menu->submenus);
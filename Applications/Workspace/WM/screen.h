@@ -118,6 +118,12 @@ typedef struct _WScreen {
 
   int window_count; /* number of windows in window_list */
 
+  struct {
+    int level;                   /* nesting level of stacking transactions */
+    struct _WCoreWindow *frame;  /* the only frame restacked in transaction */
+    unsigned int commit_all : 1; /* restack all windows on commit */
+  } stacking_transaction;
+
   struct WDesktop **desktops; /* workspace array */
   int desktop_count;          /* number of workspaces */
   int current_desktop;        /* current workspace number */
@@ -41,6 +41,7 @@
 #include "wmspec.h"
 #include "colormap.h"
 #include "shutdown.h"
+#include "capture.h"
 
 #import <Workspace+WM.h>
 
@@ -114,6 +115,7 @@ void wShutdown(WMShutdownMode mode)
       wNETWMCleanup(scr);         /* Delete _NET_* Atoms */
       PropCleanUp(scr->root_win); /* WM specific properties */
       XDeleteProperty(dpy, scr->root_win, XInternAtom(dpy, "_XROOTPMAP_ID", False));
+      wCaptureCleanup(scr);       /* release capture shared memory */
       RShutdown();                /* wraster clean exit */
 #if HAVE_SYSLOG_H
       WMSyslogClose();
@@ -57,6 +57,81 @@ static void __notifyStackChange(WCoreWindow *frame, char *detail)
   CFRelease(info);
 }
 
+/*
+ *----------------------------------------------------------------------
+ * commitFrameStacking--
+ * 	Sends the new position of "frame" in stacking list to X server or
+ * remembers it if stacking transaction is in progress.
+ *----------------------------------------------------------------------
+ */
+static void commitFrameStacking(WCoreWindow *frame)
+{
+  WScreen *scr = frame->screen_ptr;
+
+  if (scr->stacking_transaction.level > 0) {
+    if (scr->stacking_transaction.frame == NULL) {
+      scr->stacking_transaction.frame = frame;
+    } else if (scr->stacking_transaction.frame != frame) {
+      scr->stacking_transaction.commit_all = 1;
+    }
+  } else {
+    CommitStackingForWindow(frame);
+  }
+}
+
+static void commitScreenStacking(WScreen *scr)
+{
+  if (scr->stacking_transaction.level > 0) {
+    scr->stacking_transaction.commit_all = 1;
+  } else {
+    CommitStacking(scr);
+  }
+}
+
+/*
+ *----------------------------------------------------------------------
+ * BeginStackingTransaction--
+ * 	Starts collecting of stacking list changes. Until matching
+ * CommitStackingTransaction() is called raise, lower and level changes
+ * are made in the stacking list only. Transactions may be nested.
+ *----------------------------------------------------------------------
+ */
+void BeginStackingTransaction(WScreen *scr)
+{
+  scr->stacking_transaction.level++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ * CommitStackingTransaction--
+ * 	Ends stacking transaction. When outermost transaction ends, windows
+ * are restacked according to stacking list: single window is moved to
+ * its place, otherwise all windows are restacked with one
+ * XRestackWindows() call.
+ *
+ * Side effects:
+ * 	Windows may be restacked.
+ *----------------------------------------------------------------------
+ */
+void CommitStackingTransaction(WScreen *scr)
+{
+  WCoreWindow *frame;
+
+  if (scr->stacking_transaction.level <= 0 || --scr->stacking_transaction.level > 0) {
+    return;
+  }
+
+  frame = scr->stacking_transaction.frame;
+  scr->stacking_transaction.frame = NULL;
+
+  if (scr->stacking_transaction.commit_all) {
+    scr->stacking_transaction.commit_all = 0;
+    CommitStacking(scr);
+  } else if (frame) {
+    CommitStackingForWindow(frame);
+  }
+}
+
 /*
  *----------------------------------------------------------------------
  * RemakeStackList--
@@ -64,6 +139,10 @@ static void __notifyStackChange(WCoreWindow *frame, char *detail)
  * stacking order from the server and reordering windows that are not
  * in the correct stacking.
  *
+ * 	Stacking list is kept in sync with X server by stacking
+ * functions below, so it should be used only when stacking order was
+ * changed behind our back.
+ *
  * Side effects:
  * 	The stacking order list and the actual window stacking
  * may be changed (corrected)
@@ -80,6 +159,13 @@ void RemakeStackList(WScreen *scr)
   int level;
   int i, c;
 
+  /* send changes of stacking transaction in progress before asking X server */
+  if (scr->stacking_transaction.frame || scr->stacking_transaction.commit_all) {
+    scr->stacking_transaction.frame = NULL;
+    scr->stacking_transaction.commit_all = 0;
+    CommitStacking(scr);
+  }
+
   if (!XQueryTree(dpy, scr->root_win, &junkr, &junkp, &windows, &nwindows)) {
     WMLogWarning(_("could not get window list!!"));
     return;
@@ -230,6 +316,9 @@ void wRaiseFrame(WCoreWindow *frame)
     return;
   }
 
+  /* restack frame with its transients at once */
+  BeginStackingTransaction(scr);
+
   /* insert it on top of other windows on the same level */
   if (frame->stacking->under)
     frame->stacking->under->stacking->above = frame->stacking->above;
@@ -257,31 +346,8 @@ again:
     wlist = wlist->stacking->above;
   }
 
-  /* try to optimize things a little */
-  if (frame->stacking->above == NULL) {
-    WMBagIterator iter;
-    WCoreWindow *above = WMBagLast(scr->stacking_list, &iter);
-    int i, last = above->stacking->window_level;
-
-    /* find the 1st level above us which has windows in it */
-    for (i = level + 1, above = NULL; i <= last; i++) {
-      above = WMGetFromBag(scr->stacking_list, i);
-      if (above != NULL)
-        break;
-    }
-
-    if (above != frame && above != NULL) {
-      while (above->stacking->under)
-        above = above->stacking->under;
-      moveFrameToUnder(above, frame);
-    } else {
-      /* no window above us */
-      above = NULL;
-      XRaiseWindow(dpy, frame->window);
-    }
-  } else {
-    moveFrameToUnder(frame->stacking->above, frame);
-  }
+  commitFrameStacking(frame);
+  CommitStackingTransaction(scr);
 
   __notifyStackChange(frame, "raise");
 }
@@ -366,29 +432,7 @@ void wLowerFrame(WCoreWindow *frame)
     frame->stacking->under = NULL;
   }
 
-  if (frame->stacking->above == NULL) {
-    WMBagIterator iter;
-    WCoreWindow *above = WMBagLast(scr->stacking_list, &iter);
-    int i, last = above->stacking->window_level;
-
-    /* find the 1st level above us which has windows in it */
-    for (i = level + 1, above = NULL; i <= last; i++) {
-      above = WMGetFromBag(scr->stacking_list, i);
-      if (above != NULL)
-        break;
-    }
-
-    if (above != frame && above != NULL) {
-      while (above->stacking->under)
-        above = above->stacking->under;
-      moveFrameToUnder(above, frame);
-    } else {
-      /* no window below us */
-      XLowerWindow(dpy, frame->window);
-    }
-  } else {
-    moveFrameToUnder(frame->stacking->above, frame);
-  }
+  commitFrameStacking(frame);
 
   __notifyStackChange(frame, "lower");
 }
@@ -422,7 +466,7 @@ void AddToStackList(WCoreWindow *frame)
     WMSetInBag(scr->stacking_list, index, frame);
     frame->stacking->above = NULL;
     frame->stacking->under = NULL;
-    CommitStacking(scr);
+    commitScreenStacking(scr);
     return;
   }
 
@@ -452,7 +496,7 @@ void AddToStackList(WCoreWindow *frame)
     curtop->stacking->above = frame;
     WMSetInBag(scr->stacking_list, index, frame);
   }
-  CommitStacking(scr);
+  commitScreenStacking(scr);
 }
 
 /*
@@ -497,26 +541,7 @@ void MoveInStackListAbove(WCoreWindow *next, WCoreWindow *frame)
   if (tmpw == next)
     WMSetInBag(scr->stacking_list, index, frame);
 
-  /* try to optimize things a little */
-  if (frame->stacking->above == NULL) {
-    WCoreWindow *above = NULL;
-    WMBagIterator iter;
-
-    for (above = WMBagIteratorAtIndex(scr->stacking_list, index + 1, &iter); above != NULL;
-         above = WMBagNext(scr->stacking_list, &iter)) {
-      /* can't optimize */
-      while (above->stacking->under)
-        above = above->stacking->under;
-      break;
-    }
-    if (above == NULL) {
-      XRaiseWindow(dpy, frame->window);
-    } else {
-      moveFrameToUnder(above, frame);
-    }
-  } else {
-    moveFrameToUnder(frame->stacking->above, frame);
-  }
+  commitFrameStacking(frame);
 
   CFNotificationCenterPostNotification(scr->notificationCenter,
                                        WMDidResetWindowStackingNotification, scr, NULL, TRUE);
@@ -561,7 +586,7 @@ void MoveInStackListUnder(WCoreWindow *prev, WCoreWindow *frame)
   frame->stacking->above = prev;
   frame->stacking->under = prev->stacking->under;
   prev->stacking->under = frame;
-  moveFrameToUnder(prev, frame);
+  commitFrameStacking(frame);
 
   CFNotificationCenterPostNotification(scr->notificationCenter,
                                        WMDidResetWindowStackingNotification, scr, NULL, TRUE);
@@ -570,6 +595,7 @@ void MoveInStackListUnder(WCoreWindow *prev, WCoreWindow *frame)
 void RemoveFromStackList(WCoreWindow *frame)
 {
   int index = frame->stacking->window_level;
+  WScreen *scr = frame->screen_ptr;
 
   if (XDeleteContext(dpy, frame->window, w_global.context.stack) == XCNOENT) {
     WMLogWarning("RemoveFromStackingList(): window not in list ");
@@ -585,6 +611,10 @@ void RemoveFromStackList(WCoreWindow *frame)
 
   frame->screen_ptr->window_count--;
 
+  /* removed window doesn't need to be restacked */
+  if (scr->stacking_transaction.frame == frame)
+    scr->stacking_transaction.frame = NULL;
+
   CFNotificationCenterPostNotification(frame->screen_ptr->notificationCenter,
                                        WMDidResetWindowStackingNotification, frame->screen_ptr,
                                        NULL, TRUE);
@@ -598,6 +628,7 @@ void ChangeStackingLevel(WCoreWindow *frame, int new_level)
     return;
   old_level = frame->stacking->window_level;
 
+  BeginStackingTransaction(frame->screen_ptr);
   RemoveFromStackList(frame);
   frame->stacking->window_level = new_level;
   AddToStackList(frame);
@@ -606,4 +637,5 @@ void ChangeStackingLevel(WCoreWindow *frame, int new_level)
   } else {
     wLowerFrame(frame);
   }
+  CommitStackingTransaction(frame->screen_ptr);
 }
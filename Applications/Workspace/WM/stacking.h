@@ -37,5 +37,7 @@ void RemakeStackList(WScreen *scr);
 void CommitStacking(WScreen *scr);
 void CommitStackingForFrame(WCoreWindow *frame);
 void CommitStackingForWindow(WCoreWindow *frame);
+void BeginStackingTransaction(WScreen *scr);
+void CommitStackingTransaction(WScreen *scr);
 
 #endif /* __WORKSPACE_WM_STACKING__ */
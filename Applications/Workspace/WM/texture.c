@@ -28,12 +28,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <wraster.h>
 
 #include <core/util.h>
 #include <core/log_utils.h>
 #include <core/file_utils.h>
+#include <core/whashtable.h>
 
 #include "WM.h"
 #include "texture.h"
@@ -180,6 +182,8 @@ void wTextureDestroy(WScreen *scr, WTexture *texture)
     XSync(dpy, 0);
     XSetErrorHandler(oldhandler);
   }
+  wTextureCachePurge(texture);
+
   XFreeGC(dpy, texture->any.gc);
   wfree(texture);
 #undef CANFREE
@@ -588,3 +592,163 @@ void wDrawBevel(Drawable d, unsigned width, unsigned height, WTexSolid *texture,
       break;
   }
 }
+
+/*
+ * Cache of rendered texture pixmaps.
+ *
+ * Title bars, buttons, resize bars and menus of equal size rendered with the same
+ * texture share one pixmap. Pixmaps are reference counted: every successful
+ * wTextureCacheGetPixmap() and wTextureCacheAddPixmap() call must be balanced
+ * by wTextureReleasePixmap(). Pixmap is freed when the last reference is released.
+ */
+
+typedef struct WTextureCacheKey {
+  WTexture *texture;
+  int part;
+  int width;
+  int height;
+  int param;
+} WTextureCacheKey;
+
+typedef struct WTextureCacheEntry {
+  WTextureCacheKey key;
+  Pixmap pixmap;
+  int refcount;
+  Bool purged; /* texture was destroyed - entry is not in `cacheByKey` */
+} WTextureCacheEntry;
+
+static WMHashTable *cacheByKey = NULL;
+static WMHashTable *cacheByPixmap = NULL;
+
+static unsigned hashCacheKey(const void *key)
+{
+  const WTextureCacheKey *k = key;
+  unsigned hash;
+
+  hash = (unsigned)((uintptr_t)k->texture >> 4);
+  hash = hash * 31 + k->part;
+  hash = hash * 31 + k->width;
+  hash = hash * 31 + k->height;
+  hash = hash * 31 + k->param;
+
+  return hash;
+}
+
+static Bool isEqualCacheKey(const void *key1, const void *key2)
+{
+  const WTextureCacheKey *k1 = key1, *k2 = key2;
+
+  return (k1->texture == k2->texture && k1->part == k2->part && k1->width == k2->width &&
+          k1->height == k2->height && k1->param == k2->param);
+}
+
+static void initTextureCache(void)
+{
+  WMHashTableCallbacks callbacks = {hashCacheKey, isEqualCacheKey, NULL, NULL};
+
+  if (cacheByKey)
+    return;
+
+  cacheByKey = WMCreateHashTable(callbacks);
+  cacheByPixmap = WMCreateHashTable(WMIntHashCallbacks);
+}
+
+Pixmap wTextureCacheGetPixmap(WTexture *texture, int part, int width, int height, int param)
+{
+  WTextureCacheKey key = {texture, part, width, height, param};
+  WTextureCacheEntry *entry;
+
+  if (!cacheByKey)
+    return None;
+
+  entry = WMHashGet(cacheByKey, &key);
+  if (!entry)
+    return None;
+
+  entry->refcount++;
+
+  return entry->pixmap;
+}
+
+Pixmap wTextureCacheAddPixmap(WTexture *texture, int part, int width, int height, int param,
+                              Pixmap pixmap)
+{
+  WTextureCacheKey key = {texture, part, width, height, param};
+  WTextureCacheEntry *entry;
+
+  if (pixmap == None)
+    return None;
+
+  initTextureCache();
+
+  /* someone has rendered the same pixmap already */
+  entry = WMHashGet(cacheByKey, &key);
+  if (entry) {
+    XFreePixmap(dpy, pixmap);
+    entry->refcount++;
+    return entry->pixmap;
+  }
+
+  entry = wmalloc(sizeof(WTextureCacheEntry));
+  entry->key = key;
+  entry->pixmap = pixmap;
+  entry->refcount = 1;
+
+  WMHashInsert(cacheByKey, &entry->key, entry);
+  WMHashInsert(cacheByPixmap, (void *)pixmap, entry);
+
+  return pixmap;
+}
+
+void wTextureReleasePixmap(Pixmap pixmap)
+{
+  WTextureCacheEntry *entry = NULL;
+
+  if (pixmap == None)
+    return;
+
+  if (cacheByPixmap)
+    entry = WMHashGet(cacheByPixmap, (void *)pixmap);
+
+  if (!entry) {
+    /* not cached */
+    XFreePixmap(dpy, pixmap);
+    return;
+  }
+
+  if (--entry->refcount > 0)
+    return;
+
+  if (!entry->purged)
+    WMHashRemove(cacheByKey, &entry->key);
+  WMHashRemove(cacheByPixmap, (void *)pixmap);
+  XFreePixmap(dpy, pixmap);
+  wfree(entry);
+}
+
+void wTextureCachePurge(WTexture *texture)
+{
+  WMHashEnumerator e;
+  WTextureCacheEntry *entry;
+  WTextureCacheEntry **purged;
+  int i, count = 0;
+
+  if (!cacheByKey || WMCountHashTable(cacheByKey) == 0)
+    return;
+
+  purged = wmalloc(sizeof(WTextureCacheEntry *) * WMCountHashTable(cacheByKey));
+  e = WMEnumerateHashTable(cacheByKey);
+  while ((entry = WMNextHashEnumeratorItem(&e)) != NULL) {
+    if (entry->key.texture == texture)
+      purged[count++] = entry;
+  }
+
+  /* Pixmaps may still be in use by windows - they will be freed on release.
+     Entries are removed from lookup table because `texture` address may be
+     reused by new texture. */
+  for (i = 0; i < count; i++) {
+    WMHashRemove(cacheByKey, &purged[i]->key);
+    purged[i]->purged = True;
+  }
+  wfree(purged);
+}
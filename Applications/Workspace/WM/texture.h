@@ -170,6 +170,28 @@ void wTexturePaintTitlebar(struct WWindow *wwin, WTexture *texture, Pixmap *tdat
   if ((p) != None)     \
   XFreePixmap(dpy, (p)), (p) = None
 
+/* rendered texture pixmap cache parts */
+#define WTC_TITLEBAR 0
+#define WTC_LEFT_BUTTON 1
+#define WTC_RIGHT_BUTTON 2
+#define WTC_RESIZEBAR 3
+#define WTC_MENU 4
+
+/* Returns retained pixmap from cache or None. */
+Pixmap wTextureCacheGetPixmap(WTexture *texture, int part, int width, int height, int param);
+/* Puts rendered `pixmap` into cache. Returns retained pixmap which should be used instead
+   of `pixmap` (it may be freed if the same pixmap is already in cache). */
+Pixmap wTextureCacheAddPixmap(WTexture *texture, int part, int width, int height, int param,
+                              Pixmap pixmap);
+/* Releases pixmap returned by cache. Pixmaps not known to cache are freed. */
+void wTextureReleasePixmap(Pixmap pixmap);
+/* Drops cache entries of `texture`. Called on texture destroy. */
+void wTextureCachePurge(WTexture *texture);
+
+#define RELEASE_PIXMAP(p) \
+  if ((p) != None)        \
+  wTextureReleasePixmap(p), (p) = None
+
 void wDrawBevel(Drawable d, unsigned width, unsigned height, WTexSolid *texture, int relief);
 
 #endif /* __WORKSPACE_WM_TEXTURE__ */
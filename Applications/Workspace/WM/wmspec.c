@@ -55,6 +55,8 @@
 #include "properties.h"
 #include "misc.h"
 
+#include <Workspace+WM.h>
+
 /* Root Window Properties */
 static Atom net_supported;
 static Atom net_client_list;
@@ -261,8 +263,9 @@ static void windowObserver(CFNotificationCenterRef center, void *observer, CFNot
 static void desktopObserver(CFNotificationCenterRef center, void *observer, CFNotificationName name,
                             const void *screen, CFDictionaryRef userInfo);
 
-static void updateClientList(WScreen *scr);
-static void updateClientListStacking(WScreen *scr, WWindow *);
+static void updateClientList(WScreen *scr, WWindow *wwin, Bool adding);
+static void updateClientListStacking(WScreen *scr, WWindow *wwin, Bool adding);
+static void flushClientLists(struct NetData *data);
 
 static void updateDesktopNames(WScreen *scr);
 static void updateCurrentDesktop(WScreen *scr);
@@ -273,6 +276,20 @@ typedef struct NetData {
   WScreen *scr;
   WReservedArea *strut;
   WWindow **show_desktop;
+
+  /* Copies of _NET_CLIENT_LIST (mapping order) and
+     _NET_CLIENT_LIST_STACKING (bottom to top) root window properties */
+  Window *client_list;
+  int client_count;
+  Window *stacking_list;
+  int stacking_count;
+  int lists_size;
+  struct {
+    unsigned int client_list : 1;
+    unsigned int stacking_list : 1;
+    unsigned int stacking_rebuild : 1;
+  } dirty;
+  CFRunLoopObserverRef lists_observer;
 } NetData;
 
 static void setSupportedHints(WScreen *scr)
@@ -634,6 +651,15 @@ void wNETWMInitStuff(WScreen *scr)
   data->scr = scr;
   data->strut = NULL;
   data->show_desktop = NULL;
+  data->client_list = NULL;
+  data->client_count = 0;
+  data->stacking_list = NULL;
+  data->stacking_count = 0;
+  data->lists_size = 0;
+  data->dirty.client_list = 1;
+  data->dirty.stacking_list = 1;
+  data->dirty.stacking_rebuild = 1;
+  data->lists_observer = NULL;
 
   scr->netdata = data;
 
@@ -673,9 +699,11 @@ void wNETWMInitStuff(WScreen *scr)
   CFNotificationCenterAddObserver(scr->notificationCenter, data, desktopObserver,
                                   WMDidChangeDesktopNameNotification, NULL,
                                   CFNotificationSuspensionBehaviorDeliverImmediately);
+  CFNotificationCenterAddObserver(scr->notificationCenter, data, desktopObserver,
+                                  WMDidResetWindowStackingNotification, NULL,
+                                  CFNotificationSuspensionBehaviorDeliverImmediately);
 
-  updateClientList(scr);
-  updateClientListStacking(scr, NULL);
+  flushClientLists(data);
   updateDesktopCount(scr);
   updateDesktopNames(scr);
   updateShowDesktop(scr, False);
@@ -685,8 +713,15 @@ void wNETWMInitStuff(WScreen *scr)
 
 void wNETWMCleanup(WScreen *scr)
 {
+  NetData *data = scr->netdata;
   int i;
 
+  if (data && data->lists_observer) {
+    CFRunLoopObserverInvalidate(data->lists_observer);
+    CFRelease(data->lists_observer);
+    data->lists_observer = NULL;
+  }
+
   for (i = 0; i < wlengthof(atomNames); i++)
     XDeleteProperty(dpy, scr->root_win, *atomNames[i].atom);
 }
@@ -838,65 +873,216 @@ Bool wNETWMGetUsableArea(WScreen *scr, int head, WArea *area)
   return True;
 }
 
-static void updateClientList(WScreen *scr)
+/*
+ * _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING are kept in NetData and
+ * updated in place on manage, unmanage and restack. Properties are written
+ * at most once per run loop iteration (before run loop goes to sleep) and
+ * only if lists were changed.
+ */
+static void ensureClientListsSize(NetData *data, int count)
 {
-  WWindow *wwin;
-  Window *windows;
-  int count;
+  if (count <= data->lists_size)
+    return;
+
+  data->lists_size = (data->lists_size > 0) ? data->lists_size : 32;
+  while (data->lists_size < count)
+    data->lists_size *= 2;
+
+  data->client_list = wrealloc(data->client_list, sizeof(Window) * data->lists_size);
+  data->stacking_list = wrealloc(data->stacking_list, sizeof(Window) * data->lists_size);
+}
+
+static int indexOfWindowInList(Window *list, int count, Window window)
+{
+  int i;
+
+  for (i = count - 1; i >= 0; i--) {
+    if (list[i] == window)
+      return i;
+  }
+  return -1;
+}
+
+static Bool removeWindowFromList(Window *list, int *count, Window window)
+{
+  int index = indexOfWindowInList(list, *count, window);
+
+  if (index < 0)
+    return False;
+
+  (*count)--;
+  memmove(&list[index], &list[index + 1], sizeof(Window) * (*count - index));
+
+  return True;
+}
+
+static void insertWindowInList(Window *list, int *count, int index, Window window)
+{
+  memmove(&list[index + 1], &list[index], sizeof(Window) * (*count - index));
+  list[index] = window;
+  (*count)++;
+}
 
-  windows = (Window *)wmalloc(sizeof(Window) * (scr->window_count + 1));
+static void clientListsObserver(CFRunLoopObserverRef observer, CFRunLoopActivity activity,
+                                void *netData)
+{
+  NetData *data = (NetData *)netData;
+
+  if (data->dirty.client_list || data->dirty.stacking_list) {
+    flushClientLists(data);
+    XFlush(dpy);
+  }
+}
 
-  count = 0;
-  wwin = scr->focused_window;
-  while (wwin) {
-    windows[count++] = wwin->client_win;
-    wwin = wwin->prev;
+static void scheduleClientListsUpdate(NetData *data)
+{
+  if (wm_runloop == NULL) {
+    /* Events are processed by WMRunLoop_V0() - no run loop to wait for */
+    flushClientLists(data);
+    return;
   }
-  XChangeProperty(dpy, scr->root_win, net_client_list, XA_WINDOW, 32, PropModeReplace,
-                  (unsigned char *)windows, count);
 
-  wfree(windows);
-  XFlush(dpy);
+  if (data->lists_observer == NULL) {
+    CFRunLoopObserverContext ctx = {0, data, NULL, NULL, NULL};
+
+    data->lists_observer = CFRunLoopObserverCreate(kCFAllocatorDefault, kCFRunLoopBeforeWaiting,
+                                                   true, 0, clientListsObserver, &ctx);
+    CFRunLoopAddObserver(wm_runloop, data->lists_observer, kCFRunLoopCommonModes);
+  }
 }
 
-static void updateClientListStacking(WScreen *scr, WWindow *wwin_excl)
+/* Fills stacking list from the screen `stacking_list` bag: bottom to top. */
+static void rebuildClientListStacking(NetData *data)
 {
+  WScreen *scr = data->scr;
   WWindow *wwin;
-  Window *client_list, *client_list_reverse;
-  int client_count, i;
   WCoreWindow *tmp;
   WMBagIterator iter;
+  Window w;
+  int i, count = 0;
 
-  /* update client list */
-  i = scr->window_count + 1;
-  client_list = (Window *)wmalloc(sizeof(Window) * i);
-  client_list_reverse = (Window *)wmalloc(sizeof(Window) * i);
+  ensureClientListsSize(data, scr->window_count + 1);
 
-  client_count = 0;
   WM_ETARETI_BAG(scr->stacking_list, tmp, iter)
   {
     while (tmp) {
       wwin = wWindowFor(tmp->window);
-      /* wwin_excl is a window to exclude from the list
-         (e.g. it's now unmanaged) */
-      if (wwin && (wwin != wwin_excl))
-        client_list[client_count++] = wwin->client_win;
+      if (wwin) {
+        ensureClientListsSize(data, count + 1);
+        data->stacking_list[count++] = wwin->client_win;
+      }
+      tmp = tmp->stacking->under;
+    }
+  }
+
+  for (i = 0; i < count / 2; i++) {
+    w = data->stacking_list[i];
+    data->stacking_list[i] = data->stacking_list[count - i - 1];
+    data->stacking_list[count - i - 1] = w;
+  }
+  data->stacking_count = count;
+  data->dirty.stacking_rebuild = 0;
+}
+
+/* Returns the closest managed window above `frame` or NULL if `frame` is topmost. */
+static WWindow *managedWindowAbove(WScreen *scr, WCoreWindow *frame)
+{
+  WCoreWindow *tmp;
+  WWindow *wwin;
+  WMBagIterator iter;
+  int level = frame->stacking->window_level;
+
+  for (tmp = frame->stacking->above; tmp; tmp = tmp->stacking->above) {
+    if ((wwin = wWindowFor(tmp->window)) != NULL)
+      return wwin;
+  }
+
+  for (tmp = WMBagIteratorAtIndex(scr->stacking_list, level + 1, &iter); tmp != NULL;
+       tmp = WMBagNext(scr->stacking_list, &iter)) {
+    /* walk level from the bottom */
+    while (tmp->stacking->under)
       tmp = tmp->stacking->under;
+    for (; tmp; tmp = tmp->stacking->above) {
+      if ((wwin = wWindowFor(tmp->window)) != NULL)
+        return wwin;
     }
   }
 
-  for (i = 0; i < client_count; i++) {
-    Window w = client_list[client_count - i - 1];
-    client_list_reverse[i] = w;
+  return NULL;
+}
+
+static void flushClientLists(NetData *data)
+{
+  WScreen *scr = data->scr;
+
+  if (data->dirty.client_list) {
+    XChangeProperty(dpy, scr->root_win, net_client_list, XA_WINDOW, 32, PropModeReplace,
+                    (unsigned char *)data->client_list, data->client_count);
+    data->dirty.client_list = 0;
+  }
+
+  if (data->dirty.stacking_rebuild) {
+    rebuildClientListStacking(data);
+    data->dirty.stacking_list = 1;
+  }
+  if (data->dirty.stacking_list) {
+    XChangeProperty(dpy, scr->root_win, net_client_list_stacking, XA_WINDOW, 32,
+                    PropModeReplace, (unsigned char *)data->stacking_list,
+                    data->stacking_count);
+    data->dirty.stacking_list = 0;
+  }
+}
+
+static void updateClientList(WScreen *scr, WWindow *wwin, Bool adding)
+{
+  NetData *data = scr->netdata;
+
+  ensureClientListsSize(data, data->client_count + 1);
+
+  if (removeWindowFromList(data->client_list, &data->client_count, wwin->client_win))
+    data->dirty.client_list = 1;
+  if (adding) {
+    data->client_list[data->client_count++] = wwin->client_win;
+    data->dirty.client_list = 1;
   }
 
-  XChangeProperty(dpy, scr->root_win, net_client_list_stacking, XA_WINDOW, 32, PropModeReplace,
-                  (unsigned char *)client_list_reverse, client_count);
+  if (data->dirty.client_list)
+    scheduleClientListsUpdate(data);
+}
 
-  wfree(client_list);
-  wfree(client_list_reverse);
+/*
+ * Moves `wwin` to its place in the stacking list or removes it from list.
+ * If `wwin` is NULL or the list is out of sync with screen `stacking_list`,
+ * the whole list will be rebuilt on flush.
+ */
+static void updateClientListStacking(WScreen *scr, WWindow *wwin, Bool adding)
+{
+  NetData *data = scr->netdata;
+  WWindow *above;
+  int index;
+
+  if (wwin == NULL) {
+    data->dirty.stacking_rebuild = 1;
+  } else if (!data->dirty.stacking_rebuild) {
+    ensureClientListsSize(data, data->stacking_count + 1);
+    removeWindowFromList(data->stacking_list, &data->stacking_count, wwin->client_win);
+
+    if (adding && wwin->frame) {
+      above = managedWindowAbove(scr, wwin->frame->core);
+      if (above == NULL) {
+        data->stacking_list[data->stacking_count++] = wwin->client_win;
+      } else {
+        index = indexOfWindowInList(data->stacking_list, data->stacking_count, above->client_win);
+        if (index < 0)
+          data->dirty.stacking_rebuild = 1;
+        else
+          insertWindowInList(data->stacking_list, &data->stacking_count, index, wwin->client_win);
+      }
+    }
+  }
 
-  XFlush(dpy);
+  data->dirty.stacking_list = 1;
+  scheduleClientListsUpdate(data);
 }
 
 static void updateDesktopCount(WScreen *scr)
@@ -1905,27 +2091,24 @@ static void windowObserver(CFNotificationCenterRef center, void *netData, CFNoti
     return;
 
   if (CFStringCompare(name, WMDidManageWindowNotification, 0) == 0) {
-    updateClientList(wwin->screen);
-    updateClientListStacking(wwin->screen, NULL);
+    updateClientList(wwin->screen, wwin, True);
+    updateClientListStacking(wwin->screen, wwin, True);
     updateStateHint(wwin, True, False);
 
     updateStrut(wwin->screen, wwin->client_win, False);
     updateStrut(wwin->screen, wwin->client_win, True);
     wScreenUpdateUsableArea(wwin->screen);
   } else if (CFStringCompare(name, WMDidUnmanageWindowNotification, 0) == 0) {
-    updateClientList(wwin->screen);
-    updateClientListStacking(wwin->screen, wwin);
+    updateClientList(wwin->screen, wwin, False);
+    updateClientListStacking(wwin->screen, wwin, False);
     updateDesktopHint(wwin, False, True);
     updateStateHint(wwin, False, True);
     wNETWMUpdateActions(wwin, True);
 
     updateStrut(wwin->screen, wwin->client_win, False);
     wScreenUpdateUsableArea(wwin->screen);
-  } else if (CFStringCompare(name, WMDidResetWindowStackingNotification, 0) == 0) {
-    updateClientListStacking(wwin->screen, NULL);
-    updateStateHint(wwin, False, False);
   } else if (CFStringCompare(name, WMDidChangeWindowStackingNotification, 0) == 0) {
-    updateClientListStacking(wwin->screen, NULL);
+    updateClientListStacking(wwin->screen, wwin, True);
     updateStateHint(wwin, False, False);
   } else if (CFStringCompare(name, WMDidChangeWindowFocusNotification, 0) == 0) {
     updateFocusHint(ndata->scr);
@@ -1955,5 +2138,7 @@ static void desktopObserver(CFNotificationCenterRef center, void *netData, CFNot
     updateCurrentDesktop(scr);
   } else if (CFStringCompare(name, WMDidChangeDesktopNameNotification, 0) == 0) {
     updateDesktopNames(scr);
+  } else if (CFStringCompare(name, WMDidResetWindowStackingNotification, 0) == 0) {
+    updateClientListStacking(scr, NULL, False);
   }
 }
@@ -33,13 +33,19 @@
    The layout starts at the upper left corner (slot 0x0) and continues
    to the right-bottom.
 
+   Instead of icons an icon view can show items of a data source
+   (see NXTIconViewDataSource). Item `i' occupies slot `i' and icons are
+   created only for items in visible part of the view. Icons of items
+   scrolled out are kept in a pool and reused for items scrolled in, so
+   number of icons doesn't depend on number of items.
+
    @author Saso Kiselkov, Sergii Stoian
 */
 
 #import <AppKit/NSView.h>
 #import <AppKit/NSDragging.h>
 
-@class NSMutableArray, NXTIcon;
+@class NSMutableArray, NSMutableIndexSet, NSIndexSet, NSMapTable, NXTIcon;
 @protocol NSDraggingInfo;
 
 /** @struct NXTIconSlot
@@ -85,10 +91,28 @@ static inline NXTIconSlot NXTMakeIconSlot(NSUInteger x, NSUInteger y)
     Empty positions are represented by an NSNull. */
   NSMutableArray * icons;
 
-  /** Marks the number of holes in the `icons' array - if its not
-    zero then we can search for holes inside the view when adding
-    icons. */
-  unsigned int numHoles;
+  /** Indexes of holes in the `icons' array. The first free slot is
+    taken from here when adding icons so `icons' is never searched. */
+  NSMutableIndexSet *freeSlots;
+
+  /** YES if only icons in visible part of the receiver are put into
+    view hierarchy. All icons are still kept in `icons'. */
+  BOOL isVirtualized;
+  /** Range of `icons' indexes which are put into the receiver when
+    it's virtualized. */
+  NSRange materializedRange;
+
+  /** Object which supplies items. If set, `icons' is empty and icons
+    are put into the receiver for visible items only. */
+  id                dataSource;
+  NSUInteger        numberOfItems;
+  /** Icons of items in visible part of the receiver keyed by item index. */
+  NSMapTable        *itemIcons;
+  /** Icons of items that were scrolled out. Reused for items scrolled in. */
+  NSMutableArray    *reusableIcons;
+  /** Indexes of selected items. Icons of selected items are in
+    `selectedIcons' while they are visible. */
+  NSMutableIndexSet *selectedItems;
 
   /** Contains the slot of the last added icon so we can more
     quickly determine the last icon's location without
@@ -277,6 +301,50 @@ static inline NXTIconSlot NXTMakeIconSlot(NSUInteger x, NSUInteger y)
 - (unsigned int)slotsTall;
 - (unsigned int)slotsTallVisible;
 
+/** Sets whether the receiver should keep in view hierarchy only icons which
+    are in its visible part. Other icons are put into the receiver when
+    enclosing clip view scrolls to them. This saves display, layout and
+    hit testing of icons which can't be seen, but every icon (with its
+    labels) is still created and owned by the receiver, so memory use grows
+    with the number of icons. See -setDataSource: for a way to avoid it.
+    Default is NO. */
+- (void)setVirtualized:(BOOL)flag;
+/** Returns YES if the receiver puts into view hierarchy only visible icons. */
+- (BOOL)isVirtualized;
+
+/** Sets the object which supplies items to the receiver. Icons which
+    were added to the receiver are removed. Icons are created (or taken
+    from pool of scrolled out ones) only for visible items and data source
+    is asked to set them up for item. Methods that add or remove icons
+    must not be used while data source is set. Pass `nil' to return to
+    managing icons with -addIcon: and friends. */
+- (void)setDataSource:(id)aSource;
+/** Returns the data source of the receiver. */
+- (id)dataSource;
+
+/** Asks data source for number of items, clears selection and sets up
+    icons of visible items again. */
+- (void)reloadData;
+/** Asks data source to set up icons of visible items at `indexes' again.
+    Use it when item has changed but number of items hasn't. */
+- (void)reloadItemsAtIndexes:(NSIndexSet *)indexes;
+/** Returns number of items the receiver shows. */
+- (NSUInteger)numberOfItems;
+
+/** Returns icon which shows item at `index' or `nil' if there's no such
+    item. Icon is created for item out of visible part of the receiver and
+    is valid until the receiver scrolls. */
+- (NXTIcon *)iconForItemAtIndex:(NSUInteger)index;
+/** Returns index of item `anIcon' shows, or NSNotFound. */
+- (NSUInteger)indexOfItemForIcon:(NXTIcon *)anIcon;
+
+/** Selects items at `indexes'. Modifier flags select the mode as for
+    clicks: Shift adds, Control removes items from selection. */
+- (void)selectItemsAtIndexes:(NSIndexSet *)indexes withModifiers:(unsigned)flags;
+/** Returns indexes of selected items. -selectedIcons returns icons of
+    selected items that are visible. */
+- (NSIndexSet *)selectedItemIndexes;
+
 /** Sets whether the receiver allows the user to select icons in it. */
 - (void)setSelectable:(BOOL)flag;
 /** Returns YES if the user can select icons in the receiver, and NO otherwise.*/
@@ -358,6 +426,24 @@ static inline NXTIconSlot NXTMakeIconSlot(NSUInteger x, NSUInteger y)
 
 @end
 
+/** @brief NXTIconView data source methods. */
+@protocol NXTIconViewDataSource
+
+/** Returns number of items icon view should show. */
+- (NSUInteger)numberOfItemsInIconView:(NXTIconView *)anIconView;
+
+/** Sets up `anIcon' (label, image, etc.) to show item at `index'.
+    Icon may have been used for other item before. */
+- (void)  iconView:(NXTIconView *)anIconView
+       prepareIcon:(NXTIcon *)anIcon
+    forItemAtIndex:(NSUInteger)index;
+
+/** Optional. Returns new autoreleased icon when there are no icons
+    to reuse. If not implemented NXTIcon is created. */
+- (NXTIcon *)iconForIconView:(NXTIconView *)anIconView;
+
+@end
+
 /** @brief NXTIconView delegate methods. */
 @protocol NXTIconViewDelegate
 
@@ -66,14 +66,68 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   return NXTMakeIconSlot(x, (i - x) / slotsWide);
 }
 
+static inline NXTIconSelectionMode SelectionModeFromFlags(unsigned flags)
+{
+  if (flags & NSShiftKeyMask) {
+    return NXTIconSelectionAdditiveMode;
+  }
+  else if (flags & NSControlKeyMask) {
+    return NXTIconSelectionSubtractiveMode;
+  }
+  return NXTIconSelectionExclusiveMode;
+}
+
+// Returns indexes of items which have icons in `table'.
+static NSMutableIndexSet *IndexesOfItemIcons(NSMapTable *table)
+{
+  NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+  NSMapEnumerator   e = NSEnumerateMapTable(table);
+  void              *key, *value;
+
+  while (NSNextMapEnumeratorPair(&e, &key, &value)) {
+    [indexes addIndex:(NSUInteger)key];
+  }
+  NSEndMapTableEnumeration(&e);
+
+  return indexes;
+}
+
 /// Private NXTIconView methods.
 @interface NXTIconView (Private)
 
 /* Removes all icons from the superview and puts them at recomputed
    positions where they belong. This method is invoked e.g. after a
-   slot size change, when the icon positions need to be updated. */
+   slot size change, when the icon positions need to be updated.
+   If receiver is virtualized only visible icons are put back. */
 - (void)relayoutIcons;
 
+/* Returns range of `icons' indexes which slots intersect visible rectangle
+   of the receiver. One row above and below is included so icons with long
+   labels are put into view before they scrolled in. */
+- (NSRange)visibleIconsRange;
+
+/* Puts into the receiver icons which became visible and removes icons which
+   went out of visible rectangle. Does nothing if receiver is not
+   virtualized. */
+- (void)updateVisibleIcons;
+
+/* The same as -updateVisibleIcons but for data source items: icons of
+   items which went out of visible rectangle are put into the pool of
+   reusable icons, items which became visible get icons from the pool. */
+- (void)updateVisibleItems;
+
+/* Removes icon of item at `index' from the receiver and puts it into
+   the pool of reusable icons. */
+- (void)recycleIconOfItemAtIndex:(NSUInteger)index;
+
+/* Puts icons of all items into the pool of reusable icons. */
+- (void)recycleAllItemIcons;
+
+/* Returns frame of icon in slot `aSlot'. Icons which are not put into the
+   receiver (virtualized mode) get frame they would have in the slot.
+   Returns NSZeroRect if there's no icon in slot. */
+- (NSRect)frameOfIconInSlot:(NXTIconSlot)aSlot;
+
 /* Does a reverse search in the receiver's list of icons and removes
    any trailing holes and if autoAdjustsToFitIcons is YES, then it
    also invokes adjustToFitIcons. */
@@ -95,6 +149,11 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 - (void)updateSelectionWithIcons:(NSSet *)someIcons
                    modifierFlags:(unsigned)flags;
 
+/* Changes the selection of data source items. Icons of visible items
+   are selected or deselected accordingly. */
+- (void)updateSelectionWithItems:(NSIndexSet *)indexes
+                            mode:(NXTIconSelectionMode)mode;
+
 @end
 
 @implementation NXTIconView
@@ -127,8 +186,14 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   [super initWithFrame:r];
 
   icons = [NSMutableArray new];
+  freeSlots = [NSMutableIndexSet new];
   selectedIcons = [NSMutableSet new];
 
+  itemIcons = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+                               NSObjectMapValueCallBacks, 64);
+  reusableIcons = [NSMutableArray new];
+  selectedItems = [NSMutableIndexSet new];
+
   autoAdjustsToFitIcons = YES;
   adjustsToFillEnclosingScrollView = YES;
   fillWithHoleWhenRemovingIcon = YES;
@@ -166,9 +231,18 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
 - (void)dealloc
 {
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+
   TEST_RELEASE(icons);
+  TEST_RELEASE(freeSlots);
   TEST_RELEASE(selectedIcons);
 
+  if (itemIcons != NULL) {
+    NSFreeMapTable(itemIcons);
+  }
+  TEST_RELEASE(reusableIcons);
+  TEST_RELEASE(selectedItems);
+
   [super dealloc];
 }
 
@@ -210,28 +284,22 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 - (void)addIcon:(NXTIcon *)anIcon
 {
   NXTIconSlot slot;
-  NSUInteger i, n;
+  NSUInteger i;
 
   slot.x = 0;
   slot.y = 0;
 
-  if (numHoles != 0) {
-    // find a free spot - there _must_ be something, because
-    // we remember to have some holes somewhere
-    // NSLog(@"[NXTIconView] icons: %@", icons);
-    for (i = 0, n = [icons count]; i < n; i++) {
-      if ([[icons objectAtIndex:i] isKindOfClass:[NSNull class]]) {
-        slot = SlotFromIndex(slotsWide, i);
-        break;
-      }
-    }
-    if (i >= n) {
+  if ([freeSlots count] != 0) {
+    // take the first free spot
+    i = [freeSlots firstIndex];
+    if (i >= [icons count] || ![[icons objectAtIndex:i] isKindOfClass:[NSNull class]]) {
       [NSException raise:NSInternalInconsistencyException
                   format:_(@"NXTIconView:tried to pack "
                            @"a icon into free slots, but "
                            @"none were found (even though "
                            @"I thought there were!)")];
     }
+    slot = SlotFromIndex(slotsWide, i);
     // NSLog(@"[NXTIconView] found hole at index: %lu", i);
   }
   else {
@@ -274,9 +342,11 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     unsigned i;
 
     slotsTall = aSlot.y + 1;
+    if (index > [icons count]) {
+      [freeSlots addIndexesInRange:NSMakeRange([icons count], index - [icons count])];
+    }
     for (i = [icons count]; i < index; i++) {
       [icons addObject:[NSNull null]];
-      numHoles++;
     }
     [icons addObject:anIcon];
     if (autoAdjustsToFitIcons) {
@@ -289,7 +359,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
     oldIcon = [icons objectAtIndex:index];
     if ([oldIcon isKindOfClass:[NSNull class]]) {
-      numHoles--;
+      [freeSlots removeIndex:index];
     }
     else {
       [oldIcon removeFromSuperview];
@@ -303,8 +373,20 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   [anIcon setDragAction:@selector(iconDragged:event:)];
   [anIcon setDoubleAction:@selector(iconDoubleClicked:)];
   
-  [anIcon putIntoView:self
-              atPoint:PointForSlot(slotSize, aSlot)];
+  if (isVirtualized == NO) {
+    [anIcon putIntoView:self
+                atPoint:PointForSlot(slotSize, aSlot)];
+  }
+  else if (NSLocationInRange(index, [self visibleIconsRange])) {
+    [anIcon putIntoView:self
+                atPoint:PointForSlot(slotSize, aSlot)];
+    if (materializedRange.length == 0) {
+      materializedRange = NSMakeRange(index, 1);
+    }
+    else {
+      materializedRange = NSUnionRange(materializedRange, NSMakeRange(index, 1));
+    }
+  }
   [anIcon setMaximumCollapsedLabelWidth:
             slotSize.width - maximumCollapsedLabelWidthSpace];
 }
@@ -330,10 +412,11 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   [anIcon removeFromSuperview];
   if (fillWithHoleWhenRemovingIcon) {
     [icons replaceObjectAtIndex:i withObject:[NSNull null]];
-    numHoles++;
+    [freeSlots addIndex:i];
   }
   else {
     [icons removeObjectAtIndex:i];
+    [freeSlots shiftIndexesStartingAtIndex:i + 1 by:-1];
   }
 
   // [self checkWrapDown];
@@ -392,7 +475,8 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   [selectedIcons removeAllObjects];
 
   slotsTall = 0;
-  numHoles = 0;
+  [freeSlots removeAllIndexes];
+  materializedRange = NSMakeRange(0, 0);
   lastIcon = NXTMakeIconSlot(-1, 0);
 
   selectedIconSlot.x = -1;
@@ -423,6 +507,10 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   NXTIcon        *icon;
   Class          iconClass = [NXTIcon class];
 
+  if (dataSource != nil) {
+    return NSAllMapTableValues(itemIcons);
+  }
+
   while ((icon = [e nextObject]) != nil) {
     if ([icon isKindOfClass:iconClass]) {
       [array addObject:icon];
@@ -442,6 +530,10 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
   i = IndexFromSlot(slotsWide, aSlot);
 
+  if (dataSource != nil) {
+    return [self iconForItemAtIndex:i];
+  }
+
   if (i >= [icons count]) {
     return nil;
   }
@@ -457,7 +549,14 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
 - (NXTIconSlot)slotForIcon:(NXTIcon *)anIcon
 {
-  NSUInteger i = [icons indexOfObjectIdenticalTo:anIcon];
+  NSUInteger i;
+
+  if (dataSource != nil) {
+    i = [self indexOfItemForIcon:anIcon];
+  }
+  else {
+    i = [icons indexOfObjectIdenticalTo:anIcon];
+  }
 
   if (i == NSNotFound) {
     return NXTMakeIconSlot(-1, -1);
@@ -630,7 +729,8 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   
   // Height of icon view
   if (isSlotsTallFixed == NO) {
-    slotsTall = ceilf((float)[icons count] / slotsWide);
+    slotsTall = ceilf((float)((dataSource != nil) ? numberOfItems : [icons count])
+                      / slotsWide);
   }
   newFrame.size.height = slotSize.height * slotsTall;
   
@@ -725,6 +825,197 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   return (unsigned int)(svHeight / slotSize.height);
 }
 
+//------------------------------------------------------------------------------
+// Virtualization
+//------------------------------------------------------------------------------
+- (void)setVirtualized:(BOOL)flag
+{
+  if (isVirtualized == flag) {
+    return;
+  }
+  isVirtualized = flag;
+  materializedRange = NSMakeRange(0, 0);
+  [self relayoutIcons];
+}
+
+- (BOOL)isVirtualized
+{
+  return isVirtualized;
+}
+
+//------------------------------------------------------------------------------
+// Data source
+//------------------------------------------------------------------------------
+- (void)setDataSource:(id)aSource
+{
+  dataSource = nil;
+  [self removeAllIcons];
+  [self recycleAllItemIcons];
+  // Pool may contain icons of other class created by previous data source
+  [reusableIcons removeAllObjects];
+
+  dataSource = aSource;
+  [self reloadData];
+}
+
+- (id)dataSource
+{
+  return dataSource;
+}
+
+- (void)reloadData
+{
+  [self recycleAllItemIcons];
+  numberOfItems = (dataSource != nil) ? [dataSource numberOfItemsInIconView:self] : 0;
+
+  [selectedItems removeAllIndexes];
+  [selectedIcons removeAllObjects];
+  selectedIconSlot.x = -1;
+  selectedIconSlot.y = -1;
+
+  if (isSlotsTallFixed == NO && slotsWide > 0) {
+    slotsTall = ceilf((float)numberOfItems / slotsWide);
+  }
+
+  if (autoAdjustsToFitIcons) {
+    [self adjustToFitIcons];
+  }
+  else {
+    [self adjustFrame];
+  }
+}
+
+- (void)reloadItemsAtIndexes:(NSIndexSet *)indexes
+{
+  NSUInteger index;
+  NXTIcon    *icon;
+
+  for (index = [indexes firstIndex]; index != NSNotFound;
+       index = [indexes indexGreaterThanIndex:index]) {
+    if ((icon = NSMapGet(itemIcons, (void *)index)) != nil) {
+      [icon removeFromSuperview];
+      [dataSource iconView:self prepareIcon:icon forItemAtIndex:index];
+      [icon putIntoView:self
+                atPoint:PointForSlot(slotSize, SlotFromIndex(slotsWide, index))];
+    }
+  }
+}
+
+- (NSUInteger)numberOfItems
+{
+  return numberOfItems;
+}
+
+- (NXTIcon *)iconForItemAtIndex:(NSUInteger)index
+{
+  NXTIcon *icon;
+
+  if (dataSource == nil || index >= numberOfItems || slotsWide == 0) {
+    return nil;
+  }
+
+  if ((icon = NSMapGet(itemIcons, (void *)index)) != nil) {
+    return icon;
+  }
+
+  if ([reusableIcons count] > 0) {
+    icon = [[[reusableIcons lastObject] retain] autorelease];
+    [reusableIcons removeLastObject];
+  }
+  else if ([dataSource respondsToSelector:@selector(iconForIconView:)]) {
+    icon = [dataSource iconForIconView:self];
+  }
+  else {
+    icon = [[NXTIcon new] autorelease];
+  }
+
+  [icon setTarget:self];
+  [icon setAction:@selector(iconClicked:)];
+  [icon setDragAction:@selector(iconDragged:event:)];
+  [icon setDoubleAction:@selector(iconDoubleClicked:)];
+  [icon setMaximumCollapsedLabelWidth:
+          slotSize.width - maximumCollapsedLabelWidthSpace];
+
+  [dataSource iconView:self prepareIcon:icon forItemAtIndex:index];
+  NSMapInsert(itemIcons, (void *)index, icon);
+
+  if ([selectedItems containsIndex:index]) {
+    [icon select:self];
+    [selectedIcons addObject:icon];
+  }
+  [icon putIntoView:self
+            atPoint:PointForSlot(slotSize, SlotFromIndex(slotsWide, index))];
+
+  return icon;
+}
+
+- (NSUInteger)indexOfItemForIcon:(NXTIcon *)anIcon
+{
+  NSMapEnumerator e;
+  void            *key, *value;
+  NSUInteger      index = NSNotFound;
+
+  if (dataSource == nil) {
+    return NSNotFound;
+  }
+
+  // Only icons of visible items are here, so it's short
+  e = NSEnumerateMapTable(itemIcons);
+  while (NSNextMapEnumeratorPair(&e, &key, &value)) {
+    if (value == anIcon) {
+      index = (NSUInteger)key;
+      break;
+    }
+  }
+  NSEndMapTableEnumeration(&e);
+
+  return index;
+}
+
+- (void)selectItemsAtIndexes:(NSIndexSet *)indexes withModifiers:(unsigned)flags
+{
+  [self updateSelectionWithItems:indexes mode:SelectionModeFromFlags(flags)];
+}
+
+- (NSIndexSet *)selectedItemIndexes
+{
+  return [[selectedItems copy] autorelease];
+}
+
+- (void)clipViewBoundsDidChange:(NSNotification *)aNotif
+{
+  [self updateVisibleIcons];
+}
+
+// Override of NSView methods.
+// Track scrolling of enclosing clip view to put icons into view when they
+// become visible.
+- (void)viewWillMoveToSuperview:(NSView *)newSuperview
+{
+  [super viewWillMoveToSuperview:newSuperview];
+
+  if ([[self superview] isKindOfClass:[NSClipView class]]) {
+    [[NSNotificationCenter defaultCenter] removeObserver:self
+                                                    name:NSViewBoundsDidChangeNotification
+                                                  object:[self superview]];
+  }
+}
+
+- (void)viewDidMoveToSuperview
+{
+  NSView *clipView = [self superview];
+
+  [super viewDidMoveToSuperview];
+
+  if ([clipView isKindOfClass:[NSClipView class]]) {
+    [clipView setPostsBoundsChangedNotifications:YES];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(clipViewBoundsDidChange:)
+                                                 name:NSViewBoundsDidChangeNotification
+                                               object:clipView];
+  }
+}
+
 //------------------------------------------------------------------------------
 // Selection
 //------------------------------------------------------------------------------
@@ -798,6 +1089,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 {
   NSPoint      p;
   NSMutableSet *sel;
+  NSMutableIndexSet *items;
   NSRect       intersect;
   unsigned     modifierFlags;
 
@@ -882,19 +1174,61 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     selectionRect.origin.y -= selectionRect.size.height;
   }
 
+  // Check only slots covered by selection rectangle (plus adjacent ones
+  // for icons which are larger than slot).
   sel = [[NSMutableSet new] autorelease];
-  for (NXTIcon *icon in icons) {
-    if (!icon || [icon isKindOfClass:[NSNull class]])
-      continue;
-    
-    intersect = NSIntersectionRect(selectionRect, [icon frame]);
-    if (intersect.size.width == 0)
-      continue;
-    
-    [sel addObject:icon];
+  items = [NSMutableIndexSet indexSet];
+  if (slotsWide > 0 && slotSize.width > 0 && slotSize.height > 0) {
+    int         firstCol, lastCol, firstRow, lastRow, x, y;
+    NXTIconSlot slot;
+
+    firstCol = floorf(NSMinX(selectionRect) / slotSize.width) - 1;
+    lastCol = floorf(NSMaxX(selectionRect) / slotSize.width) + 1;
+    firstRow = floorf(NSMinY(selectionRect) / slotSize.height) - 1;
+    lastRow = floorf(NSMaxY(selectionRect) / slotSize.height) + 1;
+    if (firstCol < 0)
+      firstCol = 0;
+    if (lastCol >= (int)slotsWide)
+      lastCol = slotsWide - 1;
+    if (firstRow < 0)
+      firstRow = 0;
+
+    for (y = firstRow; y <= lastRow; y++) {
+      for (x = firstCol; x <= lastCol; x++) {
+        NXTIcon *icon;
+
+        slot = NXTMakeIconSlot(x, y);
+        // Don't create icons for items scrolled out - check slot rect
+        if (dataSource != nil) {
+          NSUInteger index = IndexFromSlot(slotsWide, slot);
+          NSRect     slotRect = NSMakeRect(x * slotSize.width, y * slotSize.height,
+                                           slotSize.width, slotSize.height);
+
+          if (index < numberOfItems &&
+              !NSIsEmptyRect(NSIntersectionRect(selectionRect, slotRect))) {
+            [items addIndex:index];
+          }
+          continue;
+        }
+        if ((icon = [self iconInSlot:slot]) == nil)
+          continue;
+
+        intersect = NSIntersectionRect(selectionRect, [self frameOfIconInSlot:slot]);
+        if (intersect.size.width == 0)
+          continue;
+
+        [sel addObject:icon];
+      }
+    }
   }
 
-  if ([sel count] > 0 || allowsEmptySelection == YES) {
+  if (dataSource != nil) {
+    if ([items count] > 0 || allowsEmptySelection == YES) {
+      [self updateSelectionWithItems:items
+                                mode:SelectionModeFromFlags(modifierFlags)];
+    }
+  }
+  else if ([sel count] > 0 || allowsEmptySelection == YES) {
     [self updateSelectionWithIcons:sel modifierFlags:modifierFlags];
   }
 }
@@ -1249,7 +1583,12 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
 - (void)selectAll:sender
 {
-  if (allowsMultipleSelection) {
+  if (allowsMultipleSelection && dataSource != nil) {
+    [self updateSelectionWithItems:
+            [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, numberOfItems)]
+                              mode:NXTIconSelectionAdditiveMode];
+  }
+  else if (allowsMultipleSelection) {
     [self updateSelectionWithIcons:[NSSet setWithArray:icons]
 		     modifierFlags:NSShiftKeyMask];
   }
@@ -1376,13 +1715,46 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 {
   unsigned i, n;
   Class    nullClass = [NSNull class];
-  unsigned holesLeft = numHoles;
+  unsigned holesLeft = [freeSlots count];
 
   // no need to relayout - the change wouldn't be visible anyways
   if (slotsWide == 0) {
     return;
   }
 
+  if (dataSource != nil) {
+    NSIndexSet *materialized = IndexesOfItemIcons(itemIcons);
+    NSUInteger index;
+    NXTIcon    *icon;
+
+    for (index = [materialized firstIndex]; index != NSNotFound;
+         index = [materialized indexGreaterThanIndex:index]) {
+      icon = NSMapGet(itemIcons, (void *)index);
+      [icon removeFromSuperview];
+      [icon setMaximumCollapsedLabelWidth:
+              slotSize.width - maximumCollapsedLabelWidthSpace];
+      [icon putIntoView:self
+                atPoint:PointForSlot(slotSize, SlotFromIndex(slotsWide, index))];
+    }
+    [self updateVisibleItems];
+    return;
+  }
+
+  if (isVirtualized) {
+    Class iconClass = [NXTIcon class];
+
+    // Subviews are icons in visible part and their labels - remove icons
+    // and put visible ones at new positions.
+    for (NSView *view in [[[self subviews] copy] autorelease]) {
+      if ([view isKindOfClass:iconClass]) {
+        [view removeFromSuperview];
+      }
+    }
+    materializedRange = NSMakeRange(0, 0);
+    [self updateVisibleIcons];
+    return;
+  }
+
   for (i = 0, n = [icons count]; i<n; i++) {
     NXTIcon     *icon = [icons objectAtIndex:i];
     NXTIconSlot slot;
@@ -1401,6 +1773,149 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   }
 }
 
+- (NSRange)visibleIconsRange
+{
+  NSRect     r = [self visibleRect];
+  NSUInteger count = (dataSource != nil) ? numberOfItems : [icons count];
+  NSUInteger firstRow, lastRow, first, last;
+
+  if (slotsWide == 0 || slotSize.height <= 0 || NSIsEmptyRect(r)) {
+    return NSMakeRange(0, 0);
+  }
+
+  firstRow = floorf(NSMinY(r) / slotSize.height);
+  firstRow = (firstRow > 0) ? firstRow - 1 : 0;
+  lastRow = ceilf(NSMaxY(r) / slotSize.height) + 1;
+
+  first = MIN(firstRow * slotsWide, count);
+  last = MIN(lastRow * slotsWide, count);
+
+  return NSMakeRange(first, last - first);
+}
+
+- (void)updateVisibleIcons
+{
+  NSRange    visibleRange;
+  NSUInteger i, n = [icons count];
+  Class      iconClass = [NXTIcon class];
+  NXTIcon    *icon;
+
+  if (dataSource != nil) {
+    [self updateVisibleItems];
+    return;
+  }
+
+  if (isVirtualized == NO || slotsWide == 0) {
+    return;
+  }
+
+  visibleRange = [self visibleIconsRange];
+
+  // icons scrolled out
+  for (i = materializedRange.location; i < NSMaxRange(materializedRange) && i < n; i++) {
+    if (NSLocationInRange(i, visibleRange)) {
+      continue;
+    }
+    icon = [icons objectAtIndex:i];
+    if ([icon isKindOfClass:iconClass] && [icon superview] == self) {
+      [icon removeFromSuperview];
+    }
+  }
+
+  // icons scrolled in
+  for (i = visibleRange.location; i < NSMaxRange(visibleRange); i++) {
+    icon = [icons objectAtIndex:i];
+    if ([icon isKindOfClass:iconClass] && [icon superview] != self) {
+      [icon putIntoView:self atPoint:PointForSlot(slotSize, SlotFromIndex(slotsWide, i))];
+    }
+  }
+
+  materializedRange = visibleRange;
+}
+
+- (void)updateVisibleItems
+{
+  NSRange    visibleRange;
+  NSIndexSet *materialized;
+  NSUInteger index, spare;
+
+  if (slotsWide == 0) {
+    return;
+  }
+
+  visibleRange = [self visibleIconsRange];
+
+  // items scrolled out
+  materialized = IndexesOfItemIcons(itemIcons);
+  for (index = [materialized firstIndex]; index != NSNotFound;
+       index = [materialized indexGreaterThanIndex:index]) {
+    if (!NSLocationInRange(index, visibleRange)) {
+      [self recycleIconOfItemAtIndex:index];
+    }
+  }
+
+  // items scrolled in
+  for (index = visibleRange.location; index < NSMaxRange(visibleRange); index++) {
+    [self iconForItemAtIndex:index];
+  }
+
+  // Icons left after a long jump are not needed - keep one row for scrolling
+  spare = [reusableIcons count];
+  if (spare > slotsWide) {
+    [reusableIcons removeObjectsInRange:NSMakeRange(slotsWide, spare - slotsWide)];
+  }
+
+  materializedRange = visibleRange;
+}
+
+- (void)recycleIconOfItemAtIndex:(NSUInteger)index
+{
+  NXTIcon *icon = NSMapGet(itemIcons, (void *)index);
+
+  if (icon == nil) {
+    return;
+  }
+
+  [reusableIcons addObject:icon];
+  NSMapRemove(itemIcons, (void *)index);
+  [selectedIcons removeObject:icon];
+  [icon removeFromSuperview];
+  [icon deselect:self];
+}
+
+- (void)recycleAllItemIcons
+{
+  NSIndexSet *materialized = IndexesOfItemIcons(itemIcons);
+  NSUInteger index;
+
+  for (index = [materialized firstIndex]; index != NSNotFound;
+       index = [materialized indexGreaterThanIndex:index]) {
+    [self recycleIconOfItemAtIndex:index];
+  }
+  materializedRange = NSMakeRange(0, 0);
+}
+
+- (NSRect)frameOfIconInSlot:(NXTIconSlot)aSlot
+{
+  NXTIcon *icon = [self iconInSlot:aSlot];
+  NSRect  frame;
+  NSPoint p;
+
+  if (icon == nil) {
+    return NSZeroRect;
+  }
+
+  frame = [icon frame];
+  if ([icon superview] != self) {
+    // the same as -[NXTIcon putIntoView:atPoint:] does
+    p = PointForSlot(slotSize, aSlot);
+    frame.origin.x = p.x - roundf(frame.size.width / 2);
+    frame.origin.y = p.y - roundf((frame.size.height + [[icon shortLabel] frame].size.height) / 2);
+  }
+
+  return frame;
+}
+
 // TODO: This method changes view frame in unpredictable manner.
 // For example, if icon dragged in/out of view (Shelf in Workspace)
 // Maybe i'll return to it during Workspace's Icon Viewer cleanup
@@ -1417,7 +1932,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
 
     if ([icon isKindOfClass:nullClass]) {
       [icons removeObjectAtIndex:i];
-      numHoles--;
+      [freeSlots removeIndex:i];
       didChange = YES;
     } 
     else {
@@ -1461,15 +1976,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     selectedIconSlot.y = -1;
   }
 
-  if (flags & NSShiftKeyMask) {
-    mode = NXTIconSelectionAdditiveMode;
-  }
-  else if (flags & NSControlKeyMask) {
-    mode = NXTIconSelectionSubtractiveMode;
-  }
-  else {
-    mode = NXTIconSelectionExclusiveMode;
-  }
+  mode = SelectionModeFromFlags(flags);
 
   shouldSelectIconsSEL = @selector(iconView:shouldSelectIcons:selectionMode:);
   if (delegate && [delegate respondsToSelector:shouldSelectIconsSEL]) {
@@ -1478,6 +1985,19 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
                      selectionMode:mode];
   }
 
+  if (dataSource != nil) {
+    NSMutableIndexSet *items = [NSMutableIndexSet indexSet];
+    NSUInteger        index;
+
+    for (NXTIcon *icon in someIcons) {
+      if ((index = [self indexOfItemForIcon:icon]) != NSNotFound) {
+        [items addIndex:index];
+      }
+    }
+    [self updateSelectionWithItems:items mode:mode];
+    return;
+  }
+
   if (mode == NXTIconSelectionSubtractiveMode) {
     for (NXTIcon *icon in someIcons) {
       if (icon && ![icon isKindOfClass:[NSNull class]])
@@ -1558,7 +2078,12 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
         else if (newSlot.y == minSelectedIconSlot.y && newSlot.x < minSelectedIconSlot.x) {
           minSelectedIconSlot = newSlot;
         }
-        r = NSUnionRect(r, NSUnionRect([icon frame], [[icon label] frame]));
+        if ([icon superview] == self) {
+          r = NSUnionRect(r, NSUnionRect([icon frame], [[icon label] frame]));
+        }
+        else {
+          r = NSUnionRect(r, [self frameOfIconInSlot:newSlot]);
+        }
       }
     }
     // NSLog(@"[NXTIconView] top left slot: (%i, %i) bottom right: (%i, %i)",
@@ -1569,7 +2094,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     if (minOldSlot.y >= minSelectedIconSlot.y) { // Shift+UpArrow or UpArrow
       // NSLog(@"===>>> Up");
       if (r.size.height > f.size.height) {
-        r.origin.y = [[self iconInSlot:minSelectedIconSlot] frame].origin.y;
+        r.origin.y = [self frameOfIconInSlot:minSelectedIconSlot].origin.y;
         r.size.height = f.size.height;
       }
       if (r.origin.y < slotSize.height) { // first row
@@ -1579,8 +2104,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     else if (maxOldSlot.y < maxSelectedIconSlot.y) { // Shift+Down or DownArrow
       // NSLog(@"===>>> Down");
       if (maxSelectedIconSlot.y == slotsTall-1) {
-        NXTIcon *icon = [self iconInSlot:maxSelectedIconSlot];
-        r.origin.y = [icon frame].origin.y;
+        r.origin.y = [self frameOfIconInSlot:maxSelectedIconSlot].origin.y;
         r.size.height = slotSize.height + 5;
       }
       if (r.size.height > f.size.height) {
@@ -1589,7 +2113,7 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
     }
     else { // single icon click, End - last row
       // NSLog(@"===>>> Single Icon");
-      r.origin.y = [[self iconInSlot:maxSelectedIconSlot] frame].origin.y;
+      r.origin.y = [self frameOfIconInSlot:maxSelectedIconSlot].origin.y;
       r.size.height = slotSize.height;
     }
     
@@ -1607,5 +2131,81 @@ static inline NXTIconSlot SlotFromIndex(unsigned slotsWide, unsigned i)
   }
 }
 
-@end
+- (void)updateSelectionWithItems:(NSIndexSet *)indexes
+                            mode:(NXTIconSelectionMode)mode
+{
+  NSIndexSet *materialized;
+  NSUInteger index;
+  NXTIcon    *icon;
+
+  if (indexes == nil) {
+    indexes = [NSIndexSet indexSet];
+  }
+
+  if (mode == NXTIconSelectionSubtractiveMode) {
+    [selectedItems removeIndexes:indexes];
+  }
+  else if (allowsMultipleSelection) {
+    if (mode == NXTIconSelectionExclusiveMode) {
+      [selectedItems removeAllIndexes];
+    }
+    [selectedItems addIndexes:indexes];
+  }
+  else {
+    if ([indexes count] > 1) {
+      [NSException raise:NSInvalidArgumentException
+                  format:_(@"NXTIconView:requested the selection "
+                           @"of several icons in an icon view "
+                           @"which doesn't allow multiple selection")];
+    }
+    [selectedItems removeAllIndexes];
+    [selectedItems addIndexes:indexes];
+  }
+
+  // Only icons of visible items show selection
+  [selectedIcons removeAllObjects];
+  materialized = IndexesOfItemIcons(itemIcons);
+  for (index = [materialized firstIndex]; index != NSNotFound;
+       index = [materialized indexGreaterThanIndex:index]) {
+    icon = NSMapGet(itemIcons, (void *)index);
+    if ([selectedItems containsIndex:index]) {
+      [icon select:self];
+      [selectedIcons addObject:icon];
+    }
+    else {
+      [icon deselect:self];
+    }
+  }
+
+  if ([selectedItems count] > 0) {
+    minSelectedIconSlot = SlotFromIndex(slotsWide, [selectedItems firstIndex]);
+    maxSelectedIconSlot = SlotFromIndex(slotsWide, [selectedItems lastIndex]);
+
+    // Scroll to rows of items which were just changed
+    if ([indexes count] > 0) {
+      NXTIconSlot first = SlotFromIndex(slotsWide, [indexes firstIndex]);
+      NXTIconSlot last = SlotFromIndex(slotsWide, [indexes lastIndex]);
+      NSRect      r, f = [self visibleRect];
 
+      selectedIconSlot = first;
+      r = NSMakeRect(0, first.y * slotSize.height, slotsWide * slotSize.width,
+                     (last.y - first.y + 1) * slotSize.height);
+      if (r.size.height > f.size.height) {
+        r.size.height = f.size.height;
+      }
+      [self scrollRectToVisible:r];
+    }
+  }
+  else {
+    selectedIconSlot.x = -1;
+    selectedIconSlot.y = -1;
+    minSelectedIconSlot = NXTMakeIconSlot(0,0);
+    maxSelectedIconSlot = NXTMakeIconSlot(0,slotsTall-1);
+  }
+
+  if ([delegate respondsToSelector:@selector(iconView:didChangeSelectionTo:)]) {
+    [delegate iconView:self didChangeSelectionTo:selectedIcons];
+  }
+}
+
+@end
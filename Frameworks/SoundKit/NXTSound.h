@@ -38,6 +38,7 @@ typedef NS_ENUM (NSUInteger, NXTSoundState) {
   NXTSoundState _state;
   SNDStreamType _streamType;
   BOOL          _isShort;
+  NSString      *_sampleName; // short sounds are played from server cache
   NSTimer       *releaseTimer;
 }
 
@@ -20,6 +20,7 @@
 //
 
 #import "NXTSound.h"
+#import "SNDSampleCache.h"
 #import <GNUstepGUI/GSSoundSource.h>
 
 @implementation NXTSound
@@ -33,6 +34,7 @@
     [_stream release];
     _stream = nil;
   }
+  [_sampleName release];
   
   [super dealloc];
 }
@@ -75,8 +77,54 @@
   return format;
 }
 
+// Decodes whole sound and uploads it into server sample cache if it's not
+// uploaded yet. Returns NO if sound can't be played as sample.
+- (BOOL)_uploadSample
+{
+  SNDSampleCache *cache = [SNDSampleCache sharedCache];
+  SNDSampleState state = [cache stateOfSample:_sampleName];
+  NSMutableData  *data;
+  char           buffer[4096];
+  NSUInteger     length;
+
+  if (state == SNDSampleUnknown) {
+    data = [NSMutableData new];
+    [_source setCurrentTime:0];
+    while ((length = [_source readBytes:buffer length:sizeof(buffer)]) > 0) {
+      [data appendBytes:buffer length:length];
+      if ([data length] > SND_SAMPLE_MAX_BYTES) {
+        break;
+      }
+    }
+    [_source setCurrentTime:0];
+    
+    [cache uploadSample:_sampleName
+                   data:data
+           samplingRate:[_source sampleRate]
+           channelCount:[_source channelCount]
+                 format:[self _sourceFormat]];
+    [data release];
+    state = [cache stateOfSample:_sampleName];
+  }
+
+  return (state == SNDSampleUploading || state == SNDSampleReady);
+}
+
 - (void)_initStream
 {
+  if (_sampleName != nil) {
+    if ([self _uploadSample] != NO) {
+      if (_state == NXTSoundPlay) {
+        _state = NXTSoundInitial;
+        [self play];
+      }
+      return;
+    }
+    NSDebugLLog(@"SoundKit", @"[NXTSound] sample upload failed, using stream");
+    [_sampleName release];
+    _sampleName = nil;
+  }
+  
   if (_stream != nil) {
     return;
   }
@@ -127,6 +175,9 @@
 
   if ([_source duration] < 0.30) {
     _isShort = YES;
+    if ([self _sourceFormat] != PA_SAMPLE_INVALID) {
+      _sampleName = [[[SNDSampleCache sharedCache] sampleNameForFile:path] retain];
+    }
   }
 
   NSDebugLLog(@"SoundKit",
@@ -167,6 +218,31 @@
 
   // Mark as 'Play' no matter if _stream exist or doesn't
   _state = NXTSoundPlay;
+
+  if (_sampleName != nil) {
+    SNDSampleCache *cache = [SNDSampleCache sharedCache];
+    
+    if ([SNDServer sharedServer].status != SNDServerReadyState) {
+      NSDebugLLog(@"SoundKit", @"[NXTSound] PLAY postponed - server is not ready.\n");
+      return NO;
+    }
+    // Sample could be removed from server (e.g. server was restarted)
+    if ([cache playSample:_sampleName type:_streamType] != NO ||
+        ([self _uploadSample] != NO &&
+         [cache playSample:_sampleName type:_streamType] != NO)) {
+      // Balanced in -_sampleDidFinish:
+      [self retain];
+      [self performSelectorOnMainThread:@selector(_startSampleTimer)
+                             withObject:nil
+                          waitUntilDone:NO];
+      return YES;
+    }
+    // Play as stream
+    [_sampleName release];
+    _sampleName = nil;
+    [self _initStream];
+    return (_state == NXTSoundPlay);
+  }
   
   if (_stream != nil) {
     if (_stream.isActive == NO) {
@@ -218,7 +294,7 @@
 }
 - (BOOL)isPlaying
 {
-  if (_stream == nil)
+  if (_stream == nil && _sampleName == nil)
     return NO;
   
   if (_state != NXTSoundPlay && _state != NXTSoundPause)
@@ -232,7 +308,7 @@
 {
   NSUInteger bytes_length;
   NSUInteger bytes_read;
-  float      *buffer;
+  void       *buffer;
 
   if (_state != NXTSoundPlay) {
     return;
@@ -240,20 +316,28 @@
 
   bytes_length = [count unsignedIntValue];
   // NSDebugLLog(@"SoundKit", @"[NXTSound] PLAY %lu bytes of sound", bytes_length);
-  
-  buffer = malloc(sizeof(short) * bytes_length);
+
+  // Decode directly into PulseAudio memory pool. This method is called from
+  // -play on main thread too - hold lock until buffer is written.
+  [[SNDServer sharedServer] lock];
+  buffer = [_stream bufferForWriting:&bytes_length];
+  if (buffer == NULL) {
+    [[SNDServer sharedServer] unlock];
+    return;
+  }
   bytes_read = [_source readBytes:buffer length:bytes_length];
   // NSDebugLLog(@"SoundKit", @"[NXTSound] READ %lu bytes of sound", bytes_read);
   
   if (bytes_read == 0) {
-    free(buffer);
+    [_stream cancelWrittenBuffer];
+    [[SNDServer sharedServer] unlock];
     _state = NXTSoundFinished;
     [_stream empty:NO];
     return;
   }
   
-  // `buffer` will be freed by PA function called by SNDPlayStream
-  [_stream playBuffer:buffer size:bytes_read tag:0];
+  [_stream playWrittenBuffer:buffer size:bytes_read];
+  [[SNDServer sharedServer] unlock];
   if (_isShort) {
     [_stream empty:NO];
   }
@@ -272,13 +356,36 @@
     }
 
     [self setCurrentTime:0];
-    // Complementary timed -release for -retain called from -play
+    // Complementary timed -release for -retain called from -play.
+    // Don't wait: main thread may be waiting for server lock held by us.
     [self performSelectorOnMainThread:@selector(startReleaseTimer)
                            withObject:nil
-                        waitUntilDone:YES];
+                        waitUntilDone:NO];
   }
 }
 
+// --- Sample playback
+// Server doesn't notify about end of sample playback.
+- (void)_startSampleTimer
+{
+  [NSTimer scheduledTimerWithTimeInterval:[_source duration]
+                                   target:self
+                                 selector:@selector(_sampleDidFinish:)
+                                 userInfo:nil
+                                  repeats:NO];
+}
+
+- (void)_sampleDidFinish:(NSTimer *)timer
+{
+  _state = NXTSoundFinished;
+  if (_delegate &&
+      [_delegate respondsToSelector:@selector(sound:didFinishPlaying:)] != NO) {
+    [_delegate sound:self didFinishPlaying:YES];
+  }
+  // Complementary -release for -retain called from -play
+  [self release];
+}
+
 - (void)startReleaseTimer
 {
   if (releaseTimer != nil) {
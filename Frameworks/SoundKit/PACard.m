@@ -19,6 +19,7 @@
 // Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 //
 
+#import "SNDServer.h"
 #import "PACard.h"
 
 @interface PACard ()
@@ -159,10 +160,12 @@
     }
   }
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_card_profile_by_index(_context, _index, profile, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 @end
@@ -19,6 +19,7 @@
 // Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 //
 
+#import "SNDServer.h"
 #import "PASink.h"
 
 @interface PASink ()
@@ -238,20 +239,24 @@
       break;
     }
   }
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_sink_port_by_index(_context, _index, port, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 - (void)applyMute:(BOOL)isMute
 {
   pa_operation *o;
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_sink_mute_by_index(_context, _index, (int)isMute, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 - (NSUInteger)volume
@@ -275,10 +280,12 @@
   pa_cvolume_init(new_volume);
   pa_cvolume_set(new_volume, _channelCount, v);
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_sink_volume_by_index(_context, _index, new_volume, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
   
   free(new_volume);
 }
@@ -293,10 +300,12 @@
   pa_cvolume_set(volume, _channelCount, self.volume);
   
   pa_cvolume_set_balance(volume, _channel_map, balance);
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_sink_volume_by_index(_context, _index, volume, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
   
   free(volume);
 }
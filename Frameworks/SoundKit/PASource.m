@@ -19,6 +19,7 @@
 // Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 //
 
+#import "SNDServer.h"
 #import "PASource.h"
 
 @interface PASource ()
@@ -239,20 +240,24 @@
       break;
     }
   }
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_source_port_by_index(_context, _index, port, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 - (void)applyMute:(BOOL)isMute
 {
   pa_operation *o;
   
+  [[SNDServer sharedServer] lock];
   o =pa_context_set_source_mute_by_index(_context, _index, (int)isMute, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 - (NSUInteger)volume
@@ -276,10 +281,12 @@
   pa_cvolume_init(new_volume);
   pa_cvolume_set(new_volume, _channelCount, v);
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_source_volume_by_index(_context, _index, new_volume, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
  
   free(new_volume);
 }
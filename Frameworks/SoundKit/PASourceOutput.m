@@ -19,6 +19,7 @@
 // Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 //
 
+#import "SNDServer.h"
 #import "PAClient.h"
 #import "PAStream.h"
 #import "PASource.h"
@@ -166,10 +167,12 @@
   pa_cvolume_init(new_volume);
   pa_cvolume_set(new_volume, _channelCount, v);
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_source_output_volume(_context, _index, new_volume, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
   
   free(new_volume);
 }
@@ -183,10 +186,12 @@
   pa_cvolume_set(volume, _channelCount, self.volume);
   
   pa_cvolume_set_balance(volume, channel_map, balance);
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_source_output_volume(_context, _index, volume, NULL, self);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
   
   free(volume);
 }
@@ -194,10 +199,12 @@
 {
   pa_operation *o;
   
+  [[SNDServer sharedServer] lock];
   o = pa_context_set_source_output_mute(_context, _index, isMute, NULL, NULL);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 @end
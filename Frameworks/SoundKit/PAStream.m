@@ -21,6 +21,7 @@
 
 #include <pulse/ext-stream-restore.h>
 
+#import "SNDServer.h"
 #import "PAClient.h"
 #import "PAStream.h"
 
@@ -149,11 +150,13 @@
     info_copy->volume.values[i] = volume;
   }
 
+  [[SNDServer sharedServer] lock];
   o = pa_ext_stream_restore_write(_context, PA_UPDATE_REPLACE, info_copy,
                                   1, YES, NULL, NULL);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 - (void)applyBalance:(CGFloat)balance
 {
@@ -161,22 +164,26 @@
   
   pa_cvolume_set_balance(&info_copy->volume, &info_copy->channel_map, balance);
   
+  [[SNDServer sharedServer] lock];
   o = pa_ext_stream_restore_write(_context, PA_UPDATE_REPLACE, info_copy,
                               1, YES, NULL, NULL);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 - (void)applyMute:(BOOL)isMute
 {
   pa_operation *o;
   
   info_copy->mute = isMute;
+  [[SNDServer sharedServer] lock];
   o = pa_ext_stream_restore_write(_context, PA_UPDATE_REPLACE, info_copy,
                                   1, YES, NULL, NULL);
   if (o) {
     pa_operation_unref(o);
   }
+  [[SNDServer sharedServer] unlock];
 }
 
 @end
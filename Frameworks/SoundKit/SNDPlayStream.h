@@ -34,4 +34,13 @@
               size:(NSUInteger)bytes
                tag:(NSUInteger)anUInt;
 
+// Zero-copy writing into PulseAudio memory pool. On return `bytes` contains
+// size of returned buffer which may be less than requested. Buffer must be
+// passed to -playWrittenBuffer:size: or discarded with -cancelWrittenBuffer
+// while server lock is held.
+- (void *)bufferForWriting:(NSUInteger *)bytes;
+- (void)playWrittenBuffer:(void *)data
+                     size:(NSUInteger)bytes;
+- (void)cancelWrittenBuffer;
+
 @end
@@ -57,19 +57,23 @@ void _stream_overflow(pa_stream *stream, void *sndStream)
   }
   output = (SNDOut *)super.device;
   
+  [super.server lock];
   pa_stream_connect_playback(_pa_stream, [output.sink.name cString], NULL, 0, NULL, NULL);
   pa_stream_set_write_callback(_pa_stream, _stream_buffer_ready, self);
   pa_stream_set_underflow_callback(_pa_stream, _stream_underflow, self);
   pa_stream_set_overflow_callback(_pa_stream, _stream_overflow, self);
+  [super.server unlock];
   
   super.isActive = YES;
 }
 - (void)deactivate
 {
+  [super.server lock];
   pa_stream_set_write_callback(_pa_stream, NULL, NULL);
   pa_stream_set_underflow_callback(_pa_stream, NULL, NULL);
   pa_stream_set_overflow_callback(_pa_stream, NULL, NULL);
   pa_stream_disconnect(_pa_stream);
+  [super.server unlock];
   super.isActive = NO;
 }
 
@@ -82,7 +86,42 @@ void _stream_overflow(pa_stream *stream, void *sndStream)
               size:(NSUInteger)bytes
                tag:(NSUInteger)anUInt
 {
+  [super.server lock];
   pa_stream_write(_pa_stream, data, bytes, pa_xfree, 0, PA_SEEK_RELATIVE);
+  [super.server unlock];
+}
+
+- (void *)bufferForWriting:(NSUInteger *)bytes
+{
+  void   *data = NULL;
+  size_t length = *bytes;
+  int    result;
+
+  [super.server lock];
+  result = pa_stream_begin_write(_pa_stream, &data, &length);
+  [super.server unlock];
+  
+  if (result < 0 || data == NULL) {
+    *bytes = 0;
+    return NULL;
+  }
+  *bytes = length;
+  
+  return data;
+}
+- (void)playWrittenBuffer:(void *)data
+                     size:(NSUInteger)bytes
+{
+  // `data` belongs to PulseAudio memory pool - no free callback
+  [super.server lock];
+  pa_stream_write(_pa_stream, data, bytes, NULL, 0, PA_SEEK_RELATIVE);
+  [super.server unlock];
+}
+- (void)cancelWrittenBuffer
+{
+  [super.server lock];
+  pa_stream_cancel_write(_pa_stream);
+  [super.server unlock];
 }
 
 - (NSUInteger)volume
@@ -113,24 +152,31 @@ void _stream_overflow(pa_stream *stream, void *sndStream)
 - (NSString *)activePort
 {
   SNDServer *server = [SNDServer sharedServer];
-  PASink    *sink = [server sinkWithIndex:_sinkInput.sinkIndex];
+  PASink    *sink;
+  NSString  *port;
 
+  [server lock];
+  sink = [server sinkWithIndex:_sinkInput.sinkIndex];
   if (sink == nil) {
     sink = [server defaultOutput].sink;
   }
+  port = [[sink.activePort retain] autorelease];
+  [server unlock];
 
-  return sink.activePort;
+  return port;
 }
 - (void)setActivePort:(NSString *)portName
 {
   SNDServer *server = [SNDServer sharedServer];
-  PASink    *sink = [server sinkWithIndex:_sinkInput.sinkIndex];
+  PASink    *sink;
 
+  [server lock];
+  sink = [server sinkWithIndex:_sinkInput.sinkIndex];
   if (sink == nil) {
     sink = [server defaultOutput].sink;
   }
-
   [sink applyActivePort:portName];
+  [server unlock];
 }
 
 @end
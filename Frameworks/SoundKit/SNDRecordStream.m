@@ -48,15 +48,19 @@ extern void _stream_buffer_empty(pa_stream *stream, int success, void *sndStream
   }
   input = (SNDIn *)super.device;
 
+  [super.server lock];
   pa_stream_connect_record(_pa_stream, [input.source.name cString], NULL, 0);
   pa_stream_set_read_callback(_pa_stream, _stream_buffer_ready, NULL);
+  [super.server unlock];
   
   super.isActive = YES;
 }
 - (void)deactivate
 {
+  [super.server lock];
   pa_stream_set_read_callback(_pa_stream, NULL, NULL);
   pa_stream_disconnect(_pa_stream);
+  [super.server unlock];
   super.isActive = NO;
 }
 
@@ -87,23 +91,30 @@ extern void _stream_buffer_empty(pa_stream *stream, int success, void *sndStream
 
 - (NSString *)activePort
 {
-  PASource *source = [super.server sourceWithIndex:_sourceOutput.sourceIndex];
+  PASource *source;
+  NSString *port;
 
+  [super.server lock];
+  source = [super.server sourceWithIndex:_sourceOutput.sourceIndex];
   if (source == nil) {
     source = [super.server defaultInput].source;
   }
+  port = [[source.activePort retain] autorelease];
+  [super.server unlock];
 
-  return source.activePort;
+  return port;
 }
 - (void)setActivePort:(NSString *)portName
 {
-  PASource *source = [super.server sourceWithIndex:_sourceOutput.sourceIndex];
+  PASource *source;
 
+  [super.server lock];
+  source = [super.server sourceWithIndex:_sourceOutput.sourceIndex];
   if (source == nil) {
     source = [super.server defaultInput].source;
   }
-
   [source applyActivePort:portName];
+  [super.server unlock];
 }
 
 @end
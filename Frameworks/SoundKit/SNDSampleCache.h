@@ -0,0 +1,63 @@
+/* -*- mode: objc -*- */
+//
+// Project: SoundKit framework.
+//
+// Copyright (C) 2019 Sergii Stoian
+//
+// This application is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This application is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+//
+
+#import <Foundation/Foundation.h>
+#import <SoundKit/SNDStream.h>
+
+// Short sounds (UI feedback) are decoded once and uploaded into the
+// PulseAudio sample cache. Server plays them without stream setup.
+// Sample names are derived from file path and modification date, so
+// applications playing the same file share one server-side sample.
+
+typedef NS_ENUM(NSUInteger, SNDSampleState) {
+  SNDSampleUnknown   = 0, // never uploaded by this process
+  SNDSampleUploading = 1,
+  SNDSampleReady     = 2,
+  SNDSampleFailed    = 3  // upload or play failed, use stream instead
+};
+
+// Sounds with bigger decoded data are not uploaded.
+#define SND_SAMPLE_MAX_BYTES (1024 * 1024)
+
+@interface SNDSampleCache : NSObject
+{
+  NSLock              *lock;
+  NSMutableDictionary *samples; // sample name -> SNDSample
+}
+
++ (instancetype)sharedCache;
+
+// Returns nil if file doesn't exist.
+- (NSString *)sampleNameForFile:(NSString *)path;
+- (SNDSampleState)stateOfSample:(NSString *)name;
+
+// Uploads decoded `data` under `name`. Sample is played when upload finishes
+// if -playSample:type: was called in the meantime.
+- (BOOL)uploadSample:(NSString *)name
+                data:(NSData *)data
+        samplingRate:(NSUInteger)rate
+        channelCount:(NSUInteger)channels
+              format:(NSUInteger)format;
+
+// Returns NO if sample is not uploaded and upload is not in progress.
+- (BOOL)playSample:(NSString *)name type:(SNDStreamType)streamType;
+
+@end
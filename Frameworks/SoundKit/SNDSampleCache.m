@@ -0,0 +1,363 @@
+//
+// Project: SoundKit framework.
+//
+// Copyright (C) 2019 Sergii Stoian
+//
+// This application is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This application is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+//
+
+#import "SNDServer.h"
+#import "SNDSampleCache.h"
+
+static SNDSampleCache *_sharedCache = nil;
+
+// Sample in PulseAudio server cache
+@interface SNDSample : NSObject
+{
+@public
+  SNDSampleCache *cache;
+  NSString       *name;
+  NSData         *data;     // kept until uploaded
+  pa_stream      *stream;   // upload stream
+  SNDSampleState state;
+  NSMutableArray *pendingPlays; // stream types (NSNumber) to play after upload
+}
+@end
+@implementation SNDSample
+- (void)dealloc
+{
+  [name release];
+  [data release];
+  [pendingPlays release];
+  [super dealloc];
+}
+@end
+
+@interface SNDSampleCache (Private)
+- (void)_sample:(SNDSample *)sample didUpload:(BOOL)success;
+- (void)_playSample:(SNDSample *)sample type:(SNDStreamType)streamType;
+@end
+
+static const char *_media_role(SNDStreamType streamType)
+{
+  switch (streamType) {
+  case SNDEventType:
+    return "event";
+  case SNDMusicType:
+    return "music";
+  case SNDVideoType:
+    return "video";
+  case SNDGameType:
+    return "game";
+  case SNDPhoneType:
+    return "phone";
+  case SNDAnimationType:
+    return "animation";
+  case SNDProductionType:
+    return "production";
+  case SNDAccessibilityType:
+    return "a11y";
+  case SNDTestType:
+    return "test";
+  default:
+    return NULL;
+  }
+}
+
+// Writes sample data into upload stream. Server buffer may be smaller than
+// sample - data is written in pieces of the size server gives.
+static BOOL _write_sample_data(pa_stream *stream, NSData *data)
+{
+  const uint8_t *bytes = [data bytes];
+  size_t        length = [data length];
+  size_t        offset = 0;
+  size_t        chunk;
+  void          *buffer;
+
+  while (offset < length) {
+    chunk = length - offset;
+    if (pa_stream_begin_write(stream, &buffer, &chunk) < 0 || buffer == NULL || chunk == 0) {
+      return NO;
+    }
+    if (chunk > length - offset) {
+      chunk = length - offset;
+    }
+    memcpy(buffer, bytes + offset, chunk);
+    if (pa_stream_write(stream, buffer, chunk, NULL, 0, PA_SEEK_RELATIVE) < 0) {
+      return NO;
+    }
+    offset += chunk;
+  }
+
+  return YES;
+}
+
+// Called by PulseAudio mainloop thread.
+static void _upload_state_cb(pa_stream *stream, void *userdata)
+{
+  SNDSample *sample = (SNDSample *)userdata;
+
+  switch (pa_stream_get_state(stream)) {
+  case PA_STREAM_READY:
+    if (_write_sample_data(stream, sample->data)) {
+      pa_stream_finish_upload(stream);
+    }
+    else {
+      NSDebugLLog(@"SoundKit", @"[SNDSampleCache] upload of %@ failed: %s", sample->name,
+                  pa_strerror(pa_context_errno(pa_stream_get_context(stream))));
+      // Don't get TERMINATED state - it means successful upload
+      pa_stream_set_state_callback(stream, NULL, NULL);
+      pa_stream_disconnect(stream);
+      [sample->cache _sample:sample didUpload:NO];
+    }
+    break;
+  case PA_STREAM_TERMINATED:
+    [sample->cache _sample:sample didUpload:YES];
+    break;
+  case PA_STREAM_FAILED:
+    NSDebugLLog(@"SoundKit", @"[SNDSampleCache] upload of %@ failed: %s", sample->name,
+                pa_strerror(pa_context_errno(pa_stream_get_context(stream))));
+    [sample->cache _sample:sample didUpload:NO];
+    break;
+  default:
+    break;
+  }
+}
+
+// Server removes samples only on request or exit. Failure means that sample
+// was removed (e.g. server was restarted) - upload it on next play.
+static void _play_sample_cb(pa_context *ctx, uint32_t idx, void *userdata)
+{
+  SNDSample *sample = (SNDSample *)userdata;
+
+  if (idx == PA_INVALID_INDEX) {
+    NSDebugLLog(@"SoundKit", @"[SNDSampleCache] play of %@ failed: %s", sample->name,
+                pa_strerror(pa_context_errno(ctx)));
+    [sample->cache->lock lock];
+    if (sample->state == SNDSampleReady) {
+      sample->state = SNDSampleUnknown;
+    }
+    [sample->cache->lock unlock];
+  }
+  [sample release];
+}
+
+@implementation SNDSampleCache
+
++ (instancetype)sharedCache
+{
+  if (_sharedCache == nil) {
+    _sharedCache = [SNDSampleCache new];
+  }
+  return _sharedCache;
+}
+
+- (id)init
+{
+  if ((self = [super init]) == nil)
+    return nil;
+
+  lock = [NSLock new];
+  samples = [NSMutableDictionary new];
+
+  return self;
+}
+
+- (void)dealloc
+{
+  [samples release];
+  [lock release];
+  [super dealloc];
+}
+
+- (NSString *)sampleNameForFile:(NSString *)path
+{
+  NSDictionary *attrs;
+
+  attrs = [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:YES];
+  if (attrs == nil) {
+    return nil;
+  }
+
+  return [NSString stringWithFormat:@"soundkit:%@:%lx:%llx", path,
+                   (unsigned long)[[attrs fileModificationDate] timeIntervalSince1970],
+                   [attrs fileSize]];
+}
+
+- (SNDSampleState)stateOfSample:(NSString *)name
+{
+  SNDSample      *sample;
+  SNDSampleState state;
+
+  [lock lock];
+  sample = [samples objectForKey:name];
+  state = sample ? sample->state : SNDSampleUnknown;
+  [lock unlock];
+
+  return state;
+}
+
+- (BOOL)uploadSample:(NSString *)name
+                data:(NSData *)data
+        samplingRate:(NSUInteger)rate
+        channelCount:(NSUInteger)channels
+              format:(NSUInteger)format
+{
+  SNDServer      *server = [SNDServer sharedServer];
+  SNDSample      *sample;
+  pa_sample_spec spec;
+
+  if (server.status != SNDServerReadyState || [data length] == 0 ||
+      [data length] > SND_SAMPLE_MAX_BYTES) {
+    return NO;
+  }
+
+  spec.rate = rate;
+  spec.channels = channels;
+  spec.format = format;
+  if (!pa_sample_spec_valid(&spec)) {
+    return NO;
+  }
+
+  // Server lock is always taken before `lock` - callbacks hold it
+  [server lock];
+  [lock lock];
+  sample = [samples objectForKey:name];
+  if (sample == nil) {
+    sample = [SNDSample new];
+    sample->cache = self;
+    sample->name = [name copy];
+    sample->pendingPlays = [NSMutableArray new];
+    [samples setObject:sample forKey:name];
+    [sample release];
+  }
+  if (sample->state == SNDSampleUploading || sample->state == SNDSampleReady) {
+    [lock unlock];
+    [server unlock];
+    return YES;
+  }
+
+  sample->stream = pa_stream_new(server.pa_ctx, [name UTF8String], &spec, NULL);
+  if (sample->stream == NULL) {
+    sample->state = SNDSampleFailed;
+    [lock unlock];
+    [server unlock];
+    return NO;
+  }
+  ASSIGN(sample->data, data);
+  sample->state = SNDSampleUploading;
+  [lock unlock];
+
+  NSDebugLLog(@"SoundKit", @"[SNDSampleCache] uploading %@ (%lu bytes)", name,
+              [data length]);
+  pa_stream_set_state_callback(sample->stream, _upload_state_cb, sample);
+  if (pa_stream_connect_upload(sample->stream, [data length]) < 0) {
+    [self _sample:sample didUpload:NO];
+    [server unlock];
+    return NO;
+  }
+  [server unlock];
+
+  return YES;
+}
+
+- (BOOL)playSample:(NSString *)name type:(SNDStreamType)streamType
+{
+  SNDServer *server = [SNDServer sharedServer];
+  SNDSample *sample;
+  BOOL      result = NO;
+
+  [server lock];
+  [lock lock];
+  sample = [[samples objectForKey:name] retain];
+  if (sample == nil) {
+    [lock unlock];
+  }
+  else if (sample->state == SNDSampleUploading) {
+    [sample->pendingPlays addObject:[NSNumber numberWithUnsignedInteger:streamType]];
+    [lock unlock];
+    result = YES;
+  }
+  else if (sample->state == SNDSampleReady) {
+    [lock unlock];
+    [self _playSample:sample type:streamType];
+    result = YES;
+  }
+  else {
+    [lock unlock];
+  }
+  [sample release];
+  [server unlock];
+
+  return result;
+}
+
+@end
+
+// Methods below are called with server lock held.
+@implementation SNDSampleCache (Private)
+
+- (void)_sample:(SNDSample *)sample didUpload:(BOOL)success
+{
+  NSArray *plays;
+
+  [lock lock];
+  pa_stream_set_state_callback(sample->stream, NULL, NULL);
+  pa_stream_unref(sample->stream);
+  sample->stream = NULL;
+  // Decoded data lives in the server now
+  [sample->data release];
+  sample->data = nil;
+  sample->state = success ? SNDSampleReady : SNDSampleFailed;
+  plays = [sample->pendingPlays copy];
+  [sample->pendingPlays removeAllObjects];
+  [sample retain];
+  [lock unlock];
+
+  if (success) {
+    for (NSNumber *type in plays) {
+      [self _playSample:sample type:[type unsignedIntegerValue]];
+    }
+  }
+  [plays release];
+  [sample release];
+}
+
+- (void)_playSample:(SNDSample *)sample type:(SNDStreamType)streamType
+{
+  SNDServer    *server = [SNDServer sharedServer];
+  pa_proplist  *proplist;
+  pa_operation *op;
+  const char   *role = _media_role(streamType);
+
+  proplist = pa_proplist_new();
+  if (role != NULL) {
+    pa_proplist_sets(proplist, PA_PROP_MEDIA_ROLE, role);
+  }
+  // Sample is released in callback
+  [sample retain];
+  op = pa_context_play_sample_with_proplist(server.pa_ctx, [sample->name UTF8String], NULL,
+                                            PA_VOLUME_INVALID, proplist,
+                                            _play_sample_cb, sample);
+  if (op != NULL) {
+    pa_operation_unref(op);
+  }
+  else {
+    [sample release];
+  }
+  pa_proplist_free(proplist);
+}
+
+@end
@@ -53,10 +53,15 @@ extern NSString *SNDDeviceDidRemoveNotification;
 @interface SNDServer : NSObject
 {
   // Define our pulse audio loop and connection variables
-  pa_mainloop		*_pa_loop;
+  pa_threaded_mainloop	*_pa_loop;
   pa_mainloop_api	*_pa_api;
   pa_operation		*_pa_op;
 
+  // Notifications queued by PulseAudio thread for main thread
+  NSMutableDictionary   *pendingNotifications;
+  NSMutableArray        *pendingNotificationKeys;
+  BOOL                  notificationsScheduled;
+
   // SNDDevice
   NSMutableArray        *cardList;
   // SNDOut
@@ -87,6 +92,13 @@ extern NSString *SNDDeviceDidRemoveNotification;
 - (void)connect;
 - (void)disconnect;
 
+// PulseAudio mainloop runs in separate thread. Object lists and PulseAudio
+// API calls made outside of PulseAudio callbacks must be guarded with these
+// methods. Lock is recursive and does nothing inside PulseAudio thread.
+// Notifications are delivered on main thread.
+- (void)lock;
+- (void)unlock;
+
 - (SNDDevice *)defaultCard;
 - (NSArray *)cardList;
 
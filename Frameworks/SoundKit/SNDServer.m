@@ -17,8 +17,6 @@
 // License along with this library; if not, write to the Free
 // Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 //
-                                      
-#import <dispatch/dispatch.h>
 
 #import "PACard.h"
 #import "PASink.h"
@@ -38,15 +36,21 @@
 
 #import "SNDServerCallbacks.h"
 
-static dispatch_queue_t _pa_q = NULL;
-static SNDServer        *_server = nil;
-static BOOL             mainLoopRunning = NO;
+static SNDServer *_server = nil;
+static BOOL      mainLoopRunning = NO;
 
 NSString *SNDServerStateDidChangeNotification = @"SNDServerStateDidChangeNotification";
 NSString *SNDDeviceDidAddNotification    = @"SNDDeviceDidAddNotification";
 NSString *SNDDeviceDidChangeNotification = @"SNDDeviceDidChangeNotification";
 NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
 
+@interface SNDServer (Private)
+- (void)_enqueueNotification:(NSString *)name
+                      object:(id)object
+                         key:(NSString *)key;
+- (void)_postNotifications;
+@end
+
 @implementation SNDServer
 
 // + (void)initialize
@@ -77,6 +81,8 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   [sinkInputList release];
   [sourceOutputList release];
   [savedStreamList release];
+  [pendingNotifications release];
+  [pendingNotificationKeys release];
   
   [_userName release];
   [_hostName release];
@@ -111,6 +117,10 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   sinkInputList = [NSMutableArray new];
   sourceOutputList = [NSMutableArray new];
   savedStreamList = [NSMutableArray new];
+  
+  pendingNotifications = [NSMutableDictionary new];
+  pendingNotificationKeys = [NSMutableArray new];
+  notificationsScheduled = NO;
 
   _pa_loop = NULL;
   _pa_api = NULL;
@@ -132,8 +142,8 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     pa_proplist *proplist;
     const char  *app_name = NULL;
 
-    _pa_loop = pa_mainloop_new();
-    _pa_api = pa_mainloop_get_api(_pa_loop);
+    _pa_loop = pa_threaded_mainloop_new();
+    _pa_api = pa_threaded_mainloop_get_api(_pa_loop);
 
     app_name = [[[NSProcessInfo processInfo] processName] cString];
   
@@ -153,46 +163,97 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     host_name = [_hostName cString];
   }
   pa_context_connect(_pa_ctx, host_name, 0, NULL);
-  
-  _pa_q = dispatch_queue_create("org.nextspace.soundkit", NULL);
-  dispatch_async(_pa_q, ^{
-      NSDebugLLog(@"SoundKit", @"[SNDServer] >>> PulseAudio mainloop started.");
-      while (pa_mainloop_iterate(_pa_loop, 1, NULL) >= 0) { ; }
-      NSDebugLLog(@"SoundKit", @"[SNDServer] <<< PulseAudio mainloop exited.");
-    });
+
+  if (pa_threaded_mainloop_start(_pa_loop) < 0) {
+    NSLog(@"[SoundKit] failed to start PulseAudio mainloop thread.");
+    return;
+  }
+  NSDebugLLog(@"SoundKit", @"[SNDServer] >>> PulseAudio mainloop started.");
   mainLoopRunning = YES;
 }
 - (void)disconnect
 {
-  int retval = 0;
-  
   NSDebugLLog(@"SoundKit", @"[SNDServer] === disconnect === START");
   if (_pa_ctx) {
     NSDebugLLog(@"SoundKit", @"[SNDServer] disconnect: clear PA context...");
+    [self lock];
     pa_context_disconnect(_pa_ctx);
     pa_context_set_state_callback(_pa_ctx, NULL, NULL);
     pa_context_unref(_pa_ctx);
     _pa_ctx = NULL;
+    [self unlock];
   }
   if (_pa_loop) {
     NSDebugLLog(@"SoundKit", @"[SNDServer] disconnect: stop PA mainloop...");
-    pa_mainloop_quit(_pa_loop, retval);
-    pa_mainloop_free(_pa_loop);
-  }
-  if (_pa_q) {
-    NSDebugLLog(@"SoundKit", @"[SNDServer] disconnect: release GCD queue...");
-    dispatch_release(_pa_q);
-    _pa_q = NULL;
+    // Must be called without lock held
+    pa_threaded_mainloop_stop(_pa_loop);
+    pa_threaded_mainloop_free(_pa_loop);
+    _pa_loop = NULL;
+    NSDebugLLog(@"SoundKit", @"[SNDServer] <<< PulseAudio mainloop exited.");
   }
   mainLoopRunning = NO;
   NSDebugLLog(@"SoundKit", @"[SNDServer] === disconnect === END");
 }
 
+- (void)lock
+{
+  if (_pa_loop != NULL && !pa_threaded_mainloop_in_thread(_pa_loop)) {
+    pa_threaded_mainloop_lock(_pa_loop);
+  }
+}
+- (void)unlock
+{
+  if (_pa_loop != NULL && !pa_threaded_mainloop_in_thread(_pa_loop)) {
+    pa_threaded_mainloop_unlock(_pa_loop);
+  }
+}
+
+// Called with lock held. Notifications with the same name and key queued
+// before main thread gets to them are coalesced into the last one - bursts
+// of sink input events result in one browser reload.
+- (void)_enqueueNotification:(NSString *)name
+                      object:(id)object
+                         key:(NSString *)key
+{
+  NSString *notifKey = [NSString stringWithFormat:@"%@-%@", name, key];
+
+  if ([pendingNotifications objectForKey:notifKey] == nil) {
+    [pendingNotificationKeys addObject:notifKey];
+  }
+  [pendingNotifications setObject:[NSNotification notificationWithName:name
+                                                                object:object]
+                           forKey:notifKey];
+  
+  if (notificationsScheduled == NO) {
+    notificationsScheduled = YES;
+    [self performSelectorOnMainThread:@selector(_postNotifications)
+                           withObject:nil
+                        waitUntilDone:NO];
+  }
+}
+- (void)_postNotifications
+{
+  NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+  NSArray              *notifications;
+
+  [self lock];
+  notifications = [pendingNotifications objectsForKeys:pendingNotificationKeys
+                                        notFoundMarker:[NSNull null]];
+  [pendingNotifications removeAllObjects];
+  [pendingNotificationKeys removeAllObjects];
+  notificationsScheduled = NO;
+  [self unlock];
+
+  for (NSNotification *notif in notifications) {
+    [nc postNotification:notif];
+  }
+}
+
 - (SNDDevice *)defaultCard
 {
   NSArray   *cards = [self cardList];
   PACard    *defOutCard = [self defaultOutput].card;
-  SNDDevice *defCard;
+  SNDDevice *defCard = nil;
 
   for (SNDDevice *device in cards) {
     if (device.card == defOutCard) {
@@ -208,12 +269,15 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   NSMutableArray *list = [NSMutableArray new];
   SNDDevice  *device;
 
+  [self lock];
   for (PACard *card in cardList) {
     device = [[SNDDevice alloc] initWithServer:self];
     device.card = card;
     [list addObject:device];
     [device release];
   }
+  [self unlock];
+  
   return [list autorelease];
 }
 
@@ -229,19 +293,29 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
 }
 - (SNDOut *)defaultOutput
 {
+  SNDOut *output;
+  
+  [self lock];
   if (_defaultSinkName == nil || [_defaultSinkName length] == 0) {
-    return [[self outputList] objectAtIndex:0];
+    output = [[self outputList] objectAtIndex:0];
+  }
+  else {
+    output = [self outputWithSink:[self sinkWithName:_defaultSinkName]];
   }
+  [self unlock];
   
-  return [self outputWithSink:[self sinkWithName:_defaultSinkName]];
+  return output;
 }
 - (NSArray *)outputList
 {
   NSMutableArray *list = [NSMutableArray new];
 
+  [self lock];
   for (PASink *sink in sinkList) {
     [list addObject:[self outputWithSink:sink]];
   }
+  [self unlock];
+  
   return [list autorelease];
 }
 
@@ -257,15 +331,24 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
 }
 - (SNDIn *)defaultInput
 {
-  return [self inputWithSource:[self sourceWithName:_defaultSourceName]];
+  SNDIn *input;
+  
+  [self lock];
+  input = [self inputWithSource:[self sourceWithName:_defaultSourceName]];
+  [self unlock];
+  
+  return input;
 }
 - (NSArray *)inputList
 {
   NSMutableArray *list = [NSMutableArray new];
 
+  [self lock];
   for (PASource *source in sourceList) {
     [list addObject:[self inputWithSource:source]];
   }
+  [self unlock];
+  
   return [list autorelease];
 }
 
@@ -288,6 +371,7 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   PASource         *source;
   PAClient         *client;
 
+  [self lock];
   // Pure virtual streams
   for (PAStream *stream in savedStreamList) {
     virtualStream = [[SNDVirtualStream alloc] initWithStream:stream];
@@ -329,6 +413,7 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
       [recordStream release];
     }
   }
+  [self unlock];
 
   return [list autorelease];
 }
@@ -348,9 +433,9 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
                            initWithCString:pa_strerror(pa_context_errno(_pa_ctx))];
   NSDebugLLog(@"SoundKit", @"[SNDServer] connection state was updated - %li.",
               _status);
-  [[NSNotificationCenter defaultCenter]
-      postNotificationName:SNDServerStateDidChangeNotification
-                    object:self];
+  [self _enqueueNotification:SNDServerStateDidChangeNotification
+                      object:self
+                         key:@"server"];
 }
 - (void)updateServer:(NSValue *)value // server_info_cb(...)
 {
@@ -427,7 +512,6 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   const pa_sink_info *info;
   PASink             *sink;
   BOOL               isUpdated = NO;
-  NSNotification     *aNotif;
 
   // Convert PA structure into NSDictionary
   info = malloc(sizeof(const pa_sink_info));
@@ -438,8 +522,9 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
       NSDebugLLog(@"SoundKit", @"[SNDServer] Sink Update: %s.", info->name);
       [sink updateWithValue:value];
       isUpdated = YES;
-      aNotif = [NSNotification notificationWithName:SNDDeviceDidChangeNotification
-                                             object:[self outputWithSink:sink]];
+      [self _enqueueNotification:SNDDeviceDidChangeNotification
+                          object:[self outputWithSink:sink]
+                             key:[NSString stringWithFormat:@"sink-%u", info->index]];
       break;
     }
   }
@@ -452,10 +537,10 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     sink.context = _pa_ctx;
     [sinkList addObject:sink];
     [sink release];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidAddNotification
-                                           object:[self outputWithSink:sink]];
+    [self _enqueueNotification:SNDDeviceDidAddNotification
+                        object:[self outputWithSink:sink]
+                           key:[NSString stringWithFormat:@"sink-%u", info->index]];
   }
-  [[NSNotificationCenter defaultCenter] postNotification:aNotif];
   
   free((void *)info);  
 }
@@ -492,7 +577,6 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   const pa_source_info *info;
   PASource             *source;
   BOOL                 isUpdated = NO;
-  NSNotification       *aNotif;
 
   // Convert PA structure into NSDictionary
   info = malloc(sizeof(const pa_source_info));
@@ -503,8 +587,9 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
       NSDebugLLog(@"SoundKit", @"[SNDServer] Source Update: %s.", info->name);
       [source updateWithValue:value];
       isUpdated = YES;
-      aNotif = [NSNotification notificationWithName:SNDDeviceDidChangeNotification
-                                             object:[self inputWithSource:source]];
+      [self _enqueueNotification:SNDDeviceDidChangeNotification
+                          object:[self inputWithSource:source]
+                             key:[NSString stringWithFormat:@"source-%u", info->index]];
       break;
     }
   }
@@ -516,12 +601,11 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     source.context = _pa_ctx;
     [sourceList addObject:source];
     [source release];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidAddNotification
-                                           object:[self inputWithSource:source]];
+    [self _enqueueNotification:SNDDeviceDidAddNotification
+                        object:[self inputWithSource:source]
+                           key:[NSString stringWithFormat:@"source-%u", info->index]];
   }
   
-  [[NSNotificationCenter defaultCenter] postNotification:aNotif];
-  
   free((void *)info);  
 }
 - (PASource *)sourceWithIndex:(NSUInteger)index
@@ -557,7 +641,6 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   const pa_sink_input_info *info;
   PASinkInput              *sinkInput;
   BOOL                     isUpdated = NO;
-  NSNotification           *aNotif;
 
   // Convert PA structure into NSDictionary
   info = malloc(sizeof(const pa_sink_input_info));
@@ -568,8 +651,9 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
       NSDebugLLog(@"SoundKit", @"[SNDServer] Sink Input Update: %s.", info->name);
       [sinkInput updateWithValue:value];
       isUpdated = YES;
-      aNotif = [NSNotification notificationWithName:SNDDeviceDidChangeNotification
-                                             object:self];
+      [self _enqueueNotification:SNDDeviceDidChangeNotification
+                          object:self
+                             key:@"sink-inputs"];
       break;
     }
   }
@@ -581,10 +665,10 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     sinkInput.context = _pa_ctx;
     [sinkInputList addObject:sinkInput];
     [sinkInput release];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidAddNotification
-                                           object:self];
+    [self _enqueueNotification:SNDDeviceDidAddNotification
+                        object:self
+                           key:@"sink-inputs"];
   }
-  [[NSNotificationCenter defaultCenter] postNotification:aNotif];
   
   free((void *)info);
 }
@@ -609,12 +693,11 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
 - (void)removeSinkInputWithIndex:(NSUInteger)index // context_subscribe_cb(...)
 {
   PASinkInput    *sinkInput = [self sinkInputWithIndex:index];
-  NSNotification *aNotif;
   if (sinkInput != nil) {
     [sinkInputList removeObject:sinkInput];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidRemoveNotification
-                                           object:self];
-    [[NSNotificationCenter defaultCenter] postNotification:aNotif];
+    [self _enqueueNotification:SNDDeviceDidRemoveNotification
+                        object:self
+                           key:@"sink-inputs"];
   }
 }
 
@@ -624,7 +707,6 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
   const pa_source_output_info *info;
   PASourceOutput              *sourceOutput;
   BOOL                        isUpdated = NO;
-  NSNotification              *aNotif;
 
   // Convert PA structure into NSDictionary
   info = malloc(sizeof(const pa_source_output_info));
@@ -635,8 +717,9 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
       NSDebugLLog(@"SoundKit", @"[SNDServer] Source Output Update: %s.", info->name);
       [sourceOutput updateWithValue:value];
       isUpdated = YES;
-      aNotif = [NSNotification notificationWithName:SNDDeviceDidChangeNotification
-                                             object:self];
+      [self _enqueueNotification:SNDDeviceDidChangeNotification
+                          object:self
+                             key:@"source-outputs"];
       break;
     }
   }
@@ -648,10 +731,10 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
     sourceOutput.context = _pa_ctx;
     [sourceOutputList addObject:sourceOutput];
     [sourceOutput release];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidAddNotification
-                                           object:self];
+    [self _enqueueNotification:SNDDeviceDidAddNotification
+                        object:self
+                           key:@"source-outputs"];
   }
-  [[NSNotificationCenter defaultCenter] postNotification:aNotif];
  
   free((void *)info);
 }
@@ -676,12 +759,11 @@ NSString *SNDDeviceDidRemoveNotification = @"SNDDeviceDidRemoveNotification";
 - (void)removeSourceOutputWithIndex:(NSUInteger)index // context_subscribe_cb(...)
 {
   PASourceOutput *sourceOutput = [self sourceOutputWithIndex:index];
-  NSNotification *aNotif;
   if (sourceOutput != nil) {
     [sourceOutputList removeObject:sourceOutput];
-    aNotif = [NSNotification notificationWithName:SNDDeviceDidRemoveNotification
-                                           object:self];
-    [[NSNotificationCenter defaultCenter] postNotification:aNotif];
+    [self _enqueueNotification:SNDDeviceDidRemoveNotification
+                        object:self
+                           key:@"source-outputs"];
   }
 }
 
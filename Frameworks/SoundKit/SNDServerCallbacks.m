@@ -23,6 +23,10 @@
 
 static int n_outstanding = 0;
 
+// Callbacks are called in PulseAudio mainloop thread with mainloop lock held,
+// so SNDServer object lists are updated directly. SNDServer delivers
+// resulting notifications on main thread.
+
 @implementation SNDServer (Callbacks)
 
 // --- SNDServer: Server and Card---
@@ -44,9 +48,6 @@ void card_cb(pa_context *ctx, const pa_card_info *info, int eol, void *userdata)
     
     value = [NSValue value:info withObjCType:@encode(const pa_card_info)];
     [(SNDServer *)userdata updateCard:value];
-    // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateCard:)
-    //                                         withObject:value
-    //                                      waitUntilDone:YES];
   }
 }
 void server_info_cb(pa_context *ctx, const pa_server_info *info, void *userdata)
@@ -61,9 +62,6 @@ void server_info_cb(pa_context *ctx, const pa_server_info *info, void *userdata)
   
   value = [NSValue value:info withObjCType:@encode(const pa_server_info)];
   [(SNDServer *)userdata updateServer:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateServer:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 
 // --- SNDOut: Sink --> [Card, Server] ---
@@ -86,9 +84,6 @@ void sink_cb(pa_context *ctx, const pa_sink_info *info, int eol, void *userdata)
 
   value = [NSValue value:info withObjCType:@encode(const pa_sink_info)];
   [(SNDServer *)userdata updateSink:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateSink:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 
 // --- SNDIn: Source --> [Card, Server] ---
@@ -111,9 +106,6 @@ void source_cb(pa_context *ctx, const pa_source_info *info,
   NSValue *value = [NSValue value:info
                      withObjCType:@encode(const pa_source_info)];
   [(SNDServer *)userdata updateSource:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateSource:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 
 // --- SNDStream: SinkInput | SourceOutput, Client, Saved Stream(?) ---
@@ -138,9 +130,6 @@ void sink_input_cb(pa_context *ctx, const pa_sink_input_info *info,
 
   value = [NSValue value:info withObjCType:@encode(const pa_sink_input_info)];
   [(SNDServer *)userdata updateSinkInput:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateSinkInput:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 // SourceOutput
 void source_output_cb(pa_context *ctx, const pa_source_output_info *info,
@@ -162,9 +151,6 @@ void source_output_cb(pa_context *ctx, const pa_source_output_info *info,
   NSValue *value = [NSValue value:info
                      withObjCType:@encode(const pa_source_output_info)];
   [(SNDServer *)userdata updateSourceOutput:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateSourceOutput:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 // Client
 void client_cb(pa_context *ctx, const pa_client_info *info,
@@ -187,9 +173,6 @@ void client_cb(pa_context *ctx, const pa_client_info *info,
   
   value = [NSValue value:info withObjCType:@encode(const pa_client_info)];
   [(SNDServer *)userdata updateClient:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateClient:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 // Saved Stream
 void ext_stream_restore_read_cb(pa_context *ctx,
@@ -217,9 +200,6 @@ void ext_stream_restore_read_cb(pa_context *ctx,
   value = [NSValue value:info
             withObjCType:@encode(const pa_ext_stream_restore_info)];
   [(SNDServer *)userdata updateStream:value];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateStream:)
-  //                                         withObject:value
-  //                                      waitUntilDone:YES];
 }
 void ext_stream_restore_subscribe_cb(pa_context *ctx, void *userdata)
 {
@@ -393,9 +373,6 @@ void context_state_cb(pa_context *ctx, void *userdata)
 
   // fprintf(stderr, "[SoundKit] send notification.\n");
   [(SNDServer *)userdata updateConnectionState:[NSNumber numberWithInt:state]];
-  // [(SNDServer *)userdata performSelectorOnMainThread:@selector(updateConnectionState:)
-  //                                         withObject:[NSNumber numberWithInt:state]
-  //                                      waitUntilDone:YES];
 }
 
 // --- Initial inventory of PulseAudio objects ---
@@ -65,8 +65,11 @@ static void _stream_resumed(pa_stream *stream, int success, void *sndStream)
 - (void)dealloc
 {
   NSDebugLLog(@"Memory", @"[SNDStream] dealloc");
-  if (_pa_stream != NULL)
+  if (_pa_stream != NULL) {
+    [_server lock];
     pa_stream_unref(_pa_stream);
+    [_server unlock];
+  }
 
   [_server release];
   [_device release];
@@ -148,8 +151,10 @@ static void _stream_resumed(pa_stream *stream, int success, void *sndStream)
   }
   _name = [[NSProcessInfo processInfo] processName];
   
+  [_server lock];
   _pa_stream = pa_stream_new_with_proplist(_server.pa_ctx, [_name cString],
                                            &sample_spec, NULL, proplist);
+  [_server unlock];
   pa_xfree(proplist);
   
   return self;
@@ -183,7 +188,9 @@ static void _stream_resumed(pa_stream *stream, int success, void *sndStream)
 - (void)empty:(BOOL)flush
 {
   if (flush == NO) {
+    [_server lock];
     pa_stream_drain(_pa_stream, _stream_buffer_empty, self);
+    [_server unlock];
   }
   else {
     [self abort:self];
@@ -198,24 +205,35 @@ static void _stream_resumed(pa_stream *stream, int success, void *sndStream)
 }
 - (void)pause:(id)sender
 {
+  [_server lock];
   pa_stream_cork(_pa_stream, 1, _stream_paused, self);
+  [_server unlock];
 }
 - (void)resume:(id)sender
 {
+  [_server lock];
   pa_stream_cork(_pa_stream, 0, _stream_resumed, self);
+  [_server unlock];
 }
 - (void)abort:(id)sender
 {
+  [_server lock];
   pa_stream_flush(_pa_stream, _stream_buffer_empty, self);
+  [_server unlock];
 }
 
 
 - (NSNumber *)bufferLength
 {
   const pa_buffer_attr *buffer_attr;
+  NSUInteger           length;
+
+  [_server lock];
   buffer_attr = pa_stream_get_buffer_attr(_pa_stream);
+  length = buffer_attr->tlength;
+  [_server unlock];
 
-  return [NSNumber numberWithUnsignedInteger:buffer_attr->tlength];
+  return [NSNumber numberWithUnsignedInteger:length];
 }
 - (NSUInteger)volume
 {
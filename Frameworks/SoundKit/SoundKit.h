@@ -27,4 +27,5 @@
 #import <SoundKit/SNDPlayStream.h>
 #import <SoundKit/SNDRecordStream.h>
 #import <SoundKit/SNDVirtualStream.h>
+#import <SoundKit/SNDSampleCache.h>
 #import <SoundKit/NXTSound.h>
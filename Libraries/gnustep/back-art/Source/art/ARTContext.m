@@ -38,6 +38,8 @@
 
 + (void)initializeBackend
 {
+  NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+  const char *simd;
   float gamma;
 
   NSDebugLLog(@"back-art", @"Initializing libart/freetype backend");
@@ -45,8 +47,11 @@
   [NSGraphicsContext setDefaultContextClass:[ARTContext class]];
   [FTFontInfo initializeBackend];
 
-  gamma = [[NSUserDefaults standardUserDefaults] floatForKey:@"back-art-text-gamma"];
+  gamma = [defaults floatForKey:@"back-art-text-gamma"];
   artcontext_setup_gamma(gamma);
+
+  simd = artcontext_setup_simd(![defaults boolForKey:@"back-art-disable-simd"]);
+  NSDebugLLog(@"back-art", @"SIMD blitters: %s", simd ? simd : "none");
 }
 
 + (Class)GStateClass
@@ -27,6 +27,7 @@ Image drawing. DPSimage and helpers.
 */
 
 #include <math.h>
+#include <stdlib.h>
 
 #include <AppKit/NSAffineTransform.h>
 #include <AppKit/NSGraphics.h>
@@ -208,6 +209,21 @@ static void _image_get_color_rgb_cmyk_gray(image_info_t *ii, render_run_t *ri, i
   }
 }
 
+/*
+  Fast paths for 8-bit RGB and RGBA images drawn without rotation. Source
+  rows are drawn by span with draw_info image kernels instead of sampling
+  and rendering every pixel through function pointers.
+*/
+typedef void (*image_span_func_t)(render_run_t *ri, const unsigned char *src, int num);
+
+static image_span_func_t _image_span_func(image_info_t *ii, BOOL dst_has_alpha)
+{
+  if (ii->has_alpha)
+    return dst_has_alpha ? DI.image_rgba_a : DI.image_rgba_o;
+  else
+    return dst_has_alpha ? DI.image_rgb_a : DI.image_rgb_o;
+}
+
 @implementation ARTGState (image)
 
 - (void)_image_do_rgb_transform:(image_info_t *)ii
@@ -585,6 +601,190 @@ static void _image_get_color_rgb_cmyk_gray(image_info_t *ii, render_run_t *ri, i
   }
 }
 
+/* Draws pixels in `src` to device row `cy` from `x0` to `x1` (inside
+   clipping rectangle). Clipping spans are honoured. */
+- (void)_image_draw_row:(int)cy
+                       :(int)x0
+                       :(int)x1
+                       :(const unsigned char *)src
+                       :(int)src_bpp
+                       :(image_span_func_t)span_func
+{
+  render_run_t ri;
+
+  if (!clip_span) {
+    ri.dst = wi->data + x0 * DI.bytes_per_pixel + cy * wi->bytes_per_line;
+    ri.dsta = wi->alpha + x0 + cy * wi->sx;
+    span_func(&ri, src, x1 - x0);
+  } else {
+    unsigned int *span, *end;
+    int sx0, sx1;
+
+    /* each line starts 'off' and ends 'off' - spans come in pairs */
+    span = &clip_span[clip_index[cy - clip_y0]];
+    end = &clip_span[clip_index[cy - clip_y0 + 1]];
+    for (; span + 1 < end; span += 2) {
+      sx0 = span[0] + clip_x0;
+      sx1 = span[1] + clip_x0;
+      if (sx0 < x0)
+        sx0 = x0;
+      if (sx1 > x1)
+        sx1 = x1;
+      if (sx0 >= sx1)
+        continue;
+      ri.dst = wi->data + sx0 * DI.bytes_per_pixel + cy * wi->bytes_per_line;
+      ri.dsta = wi->alpha + sx0 + cy * wi->sx;
+      span_func(&ri, src + (sx0 - x0) * src_bpp, sx1 - sx0);
+    }
+  }
+}
+
+/* Untransformed image: rows are passed to the span kernel directly. */
+- (void)_image_do_rgb_copy:(image_info_t *)ii :(NSAffineTransform *)matrix
+{
+  image_span_func_t span_func = _image_span_func(ii, wi->has_alpha);
+  int bpp = ii->samples_per_pixel;
+  NSPoint p = [matrix transformPoint:NSMakePoint(0, 0)];
+  int ox, oy, x0, x1, y0, y1, cy;
+
+  ox = p.x - offset.x;
+  oy = offset.y - p.y - ii->height;
+
+  x0 = ox < clip_x0 ? clip_x0 : ox;
+  x1 = ox + ii->width > clip_x1 ? clip_x1 : ox + ii->width;
+  y0 = oy < clip_y0 ? clip_y0 : oy;
+  y1 = oy + ii->height > clip_y1 ? clip_y1 : oy + ii->height;
+
+  for (cy = y0; cy < y1 && x0 < x1; cy++) {
+    [self _image_draw_row:cy
+                         :x0
+                         :x1
+                         :ii->data[0] + (cy - oy) * ii->bytes_per_row + (x0 - ox) * bpp
+                         :bpp
+                         :span_func];
+  }
+}
+
+/*
+  Scaled image. Integer magnification replicates pixels (nearest
+  neighbour), other scale factors use bilinear filtering of premultiplied
+  samples. Source columns for the visible part of each row are computed
+  once.
+*/
+- (void)_image_do_rgb_scale:(image_info_t *)ii :(NSAffineTransform *)matrix
+{
+  image_span_func_t span_func = _image_span_func(ii, wi->has_alpha);
+  int bpp = ii->samples_per_pixel;
+  NSPoint p0, p1;
+  int dx0, dx1, dy0, dy1, dw, dh;
+  int x0, x1, y0, y1, cx, cy, c;
+  int *sx_a, *sx_b;
+  unsigned char *wx, *row;
+  BOOL nearest;
+
+  p0 = [matrix transformPoint:NSMakePoint(0, 0)];
+  p1 = [matrix transformPoint:NSMakePoint(ii->width, ii->height)];
+  if (fabs(p0.x - floor(p0.x + .5)) < 0.001)
+    p0.x = floor(p0.x + .5);
+  if (fabs(p0.y - floor(p0.y + .5)) < 0.001)
+    p0.y = floor(p0.y + .5);
+  if (fabs(p1.x - floor(p1.x + .5)) < 0.001)
+    p1.x = floor(p1.x + .5);
+  if (fabs(p1.y - floor(p1.y + .5)) < 0.001)
+    p1.y = floor(p1.y + .5);
+
+  /* destination rectangle in device space; image row 0 is at the top */
+  dx0 = floor(p0.x) - offset.x;
+  dx1 = floor(p1.x) - offset.x;
+  dy0 = offset.y - floor(p1.y);
+  dy1 = offset.y - floor(p0.y);
+  dw = dx1 - dx0;
+  dh = dy1 - dy0;
+  if (dw <= 0 || dh <= 0)
+    return;
+
+  x0 = dx0 < clip_x0 ? clip_x0 : dx0;
+  x1 = dx1 > clip_x1 ? clip_x1 : dx1;
+  y0 = dy0 < clip_y0 ? clip_y0 : dy0;
+  y1 = dy1 > clip_y1 ? clip_y1 : dy1;
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  nearest = (dw % ii->width == 0 && dh % ii->height == 0);
+
+  sx_a = malloc(sizeof(int) * (x1 - x0) * 2);
+  wx = malloc(x1 - x0);
+  row = malloc((x1 - x0) * bpp);
+  if (!sx_a || !wx || !row) {
+    free(sx_a);
+    free(wx);
+    free(row);
+    return;
+  }
+  sx_b = sx_a + (x1 - x0);
+
+  /* Source column (and weight of the next one) for each visible column.
+     Positions are in 16.16 fixed point, sampled at pixel centers. */
+  for (cx = x0; cx < x1; cx++) {
+    int i = cx - x0;
+
+    if (nearest) {
+      sx_a[i] = sx_b[i] = (long long)(cx - dx0) * ii->width / dw;
+      wx[i] = 0;
+    } else {
+      long long pos = ((2LL * (cx - dx0) + 1) * ii->width << 16) / (2 * dw) - 0x8000;
+
+      if (pos < 0)
+        pos = 0;
+      sx_a[i] = pos >> 16;
+      wx[i] = (pos >> 8) & 0xff;
+      sx_b[i] = sx_a[i] + 1 < ii->width ? sx_a[i] + 1 : sx_a[i];
+    }
+    sx_a[i] *= bpp;
+    sx_b[i] *= bpp;
+  }
+
+  for (cy = y0; cy < y1; cy++) {
+    const unsigned char *r0, *r1;
+    unsigned char *d = row;
+    int sy, wy;
+
+    if (nearest) {
+      sy = (long long)(cy - dy0) * ii->height / dh;
+      r0 = ii->data[0] + sy * ii->bytes_per_row;
+      for (cx = 0; cx < x1 - x0; cx++, d += bpp) {
+        for (c = 0; c < bpp; c++)
+          d[c] = r0[sx_a[cx] + c];
+      }
+    } else {
+      long long pos = ((2LL * (cy - dy0) + 1) * ii->height << 16) / (2 * dh) - 0x8000;
+
+      if (pos < 0)
+        pos = 0;
+      sy = pos >> 16;
+      wy = (pos >> 8) & 0xff;
+      r0 = ii->data[0] + sy * ii->bytes_per_row;
+      r1 = sy + 1 < ii->height ? r0 + ii->bytes_per_row : r0;
+      for (cx = 0; cx < x1 - x0; cx++, d += bpp) {
+        int a = sx_a[cx], b = sx_b[cx], w = wx[cx];
+
+        for (c = 0; c < bpp; c++) {
+          int top = r0[a + c] * (256 - w) + r0[b + c] * w;
+          int bottom = r1[a + c] * (256 - w) + r1[b + c] * w;
+
+          d[c] = (top * (256 - wy) + bottom * wy) >> 16;
+        }
+      }
+    }
+
+    [self _image_draw_row:cy :x0 :x1 :row :bpp :span_func];
+  }
+
+  free(sx_a);
+  free(wx);
+  free(row);
+}
+
 - (void)DPSimage:(NSAffineTransform *)matrix
                 :(NSInteger)pixelsWide
                 :(NSInteger)pixelsHigh
@@ -619,71 +819,26 @@ static void _image_get_color_rgb_cmyk_gray(image_info_t *ii, render_run_t *ri, i
   else
     is_rgb = NO;
 
-  /* optimize common case */
-  if (identity_transform && is_rgb && !clip_span && bitsPerSample == 8 && !isPlanar &&
-      bytesPerRow == samplesPerPixel * pixelsWide &&
+  /* optimize common case: RGB(A) images without rotation */
+  if (is_rgb && bitsPerSample == 8 && !isPlanar && DI.image_rgb_o &&
+      bytesPerRow >= samplesPerPixel * pixelsWide &&
       ((samplesPerPixel == 3 && bitsPerPixel == 24 && !hasAlpha) ||
-       (samplesPerPixel == 4 && bitsPerPixel == 32 && hasAlpha))) {
-    int x, y, ox, oy;
-    const unsigned char *src = data[0];
-    unsigned char *alpha_dest;
-    render_run_t ri;
-
-    if (wi->has_alpha) {
-      if (DI.inline_alpha)
-        alpha_dest = wi->data + DI.inline_alpha_ofs;
-      else
-        alpha_dest = wi->alpha;
-    } else
-      alpha_dest = NULL;
-
-    ox = [matrix transformPoint:NSMakePoint(0, 0)].x - offset.x;
-    oy = offset.y - [matrix transformPoint:NSMakePoint(0, 0)].y - pixelsHigh;
-
-    for (y = 0; y < pixelsHigh; y++) {
-      for (x = 0; x < pixelsWide; x++) {
-        if (x + ox < clip_x0 || x + ox >= clip_x1 || y + oy < clip_y0 || y + oy >= clip_y1) {
-          if (hasAlpha)
-            src += 4;
-          else
-            src += 3;
-          continue;
-        }
-        ri.dst = wi->data + (x + ox) * DI.bytes_per_pixel + (y + oy) * wi->bytes_per_line;
-        ri.dsta = wi->alpha + (x + ox) + (y + oy) * wi->sx;
-        ri.r = src[0];
-        ri.g = src[1];
-        ri.b = src[2];
-        if (hasAlpha) {
-          ri.a = src[3];
-          /* Undo premultiply  */
-          if (ri.a && ri.a != 255) {
-            ri.r = (255 * ri.r) / ri.a;
-            ri.g = (255 * ri.g) / ri.a;
-            ri.b = (255 * ri.b) / ri.a;
-          }
-          if (alpha_dest) {
-            if (src[3] == 255)
-              RENDER_RUN_OPAQUE_A(&ri, 1);
-            else if (src[3])
-              RENDER_RUN_ALPHA_A(&ri, 1);
-          } else {
-            if (src[3] == 255)
-              RENDER_RUN_OPAQUE(&ri, 1);
-            else if (src[3])
-              RENDER_RUN_ALPHA(&ri, 1);
-          }
-          src += 4;
-        } else {
-          ri.a = 255;
-          if (alpha_dest)
-            RENDER_RUN_OPAQUE_A(&ri, 1);
-          else
-            RENDER_RUN_OPAQUE(&ri, 1);
-          src += 3;
-        }
-      }
-    }
+       (samplesPerPixel == 4 && bitsPerPixel == 32 && hasAlpha)) &&
+      fabs(ts.m12) < 0.001 && fabs(ts.m21) < 0.001 && ts.m11 > 0 && ts.m22 > 0) {
+    ii.bits_per_sample = bitsPerSample;
+    ii.bits_per_pixel = bitsPerPixel;
+    ii.is_planar = isPlanar;
+    ii.has_alpha = hasAlpha;
+    ii.width = pixelsWide;
+    ii.height = pixelsHigh;
+    ii.samples_per_pixel = samplesPerPixel;
+    ii.bytes_per_row = bytesPerRow;
+    ii.data = (const unsigned char **)data;
+
+    if (identity_transform)
+      [self _image_do_rgb_copy:&ii:matrix];
+    else
+      [self _image_do_rgb_scale:&ii:matrix];
     UPDATE_UNBUFFERED
     return;
   }
@@ -99,7 +99,11 @@
 #import <GNUstepGUI/GSFontInfo.h>
 #import "FTFaceInfo.h"
 
-#define CACHE_SIZE 257
+/* Advances of 256 consecutive glyphs. */
+struct FTFontInfo_advance_page {
+  unsigned char known[256 / 8];
+  NSSize size[256];
+};
 
 @interface FTFontInfo : GSFontInfo <FTFontInfo>
 {
@@ -119,10 +123,11 @@
   /*
   Profiling (2003-11-14) shows that calls to -advancementForGlyph: accounted
   for roughly 20% of layout time. This cache reduces it to (currently)
-  insignificant levels.
+  insignificant levels. Advances of the first 65536 glyphs are kept in pages
+  that are allocated on first use, so scripts with many glyphs (CJK) don't
+  evict each other.
   */
-  unsigned int cachedGlyph[CACHE_SIZE];
-  NSSize cachedSize[CACHE_SIZE];
+  struct FTFontInfo_advance_page *advancePages[256];
 
   CGFloat lineHeight;
 }
@@ -77,6 +77,19 @@ static FTC_ImageCache ftc_imagecache;
 static FTC_SBitCache ftc_sbitcache;
 static FTC_CMapCache ftc_cmapcache;
 
+/*
+Cache statistics, logged at exit if the back-art-cache-statistics default
+is set. Advance hits are answered by the per-font advance pages, misses go
+to the FreeType cache. Face loads are FreeType cache misses for faces.
+*/
+static unsigned long advance_hits, advance_misses, face_loads;
+
+static void log_cache_statistics(void)
+{
+  NSLog(@"back-art font cache: advances %lu hits, %lu misses; %lu faces loaded",
+        advance_hits, advance_misses, face_loads);
+}
+
 /*
  * Helper method used inside of FTC_Manager to create an FT_FACE.
  */
@@ -88,6 +101,7 @@ static FT_Error ft_get_face(FTC_FaceID fid, FT_Library lib, FT_Pointer data, FT_
   const char *face_name = [[rfi objectAtIndex:0] fileSystemRepresentation];
 
   NSDebugLLog(@"ftfont", @"ft_get_face: %@ '%s'", rfi, face_name);
+  face_loads++;
   err = FT_New_Face(lib, face_name, 0, pface);
   if (err) {
     NSLog(@"Error when loading '%@' (%08x)", [rfi objectAtIndex:0], err);
@@ -260,18 +274,18 @@ static FT_Error ft_get_face(FTC_FaceID fid, FT_Library lib, FT_Pointer data, FT_
     imageType.flags = FT_LOAD_NO_HINTING;
   }
 
-  /*
-  Here, we simply need to make sure that we don't get any false matches
-  the first time a particular cache entry is used. Thus, we only need to
-  initialize the first entry. For all other entries, cachedGlyph[i] will
-  be 0, and that's a glyph that can't possibly hash to any entry except
-  entry #0, so it won't cause any false matches.
-  */
-  cachedGlyph[0] = 1;
-
   return self;
 }
 
+- (void)dealloc
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    free(advancePages[i]);
+  [super dealloc];
+}
+
 - (NSString *)displayName
 {
   return face_info->displayName;
@@ -1345,31 +1359,22 @@ static FT_Error ft_get_face(FTC_FaceID fid, FT_Library lib, FT_Pointer data, FT_
   return YES;
 }
 
-- (NSSize)advancementForGlyph:(NSGlyph)glyph
+/* Returns NO on failures, which aren't cached. */
+- (BOOL)_getAdvancement:(NSSize *)advancement forGlyph:(NSGlyph)glyph
 {
   FT_Error error;
 
-  if (glyph == NSControlGlyph || glyph == GSAttachmentGlyph)
-    return NSZeroSize;
-
-  if (glyph != NSNullGlyph)
-    glyph--;
   if (screenFont) {
-    int entry = glyph % CACHE_SIZE;
     FTC_SBit sbit;
 
-    if (cachedGlyph[entry] == glyph)
-      return cachedSize[entry];
-
     if ((error = FTC_SBitCache_Lookup(ftc_sbitcache, &imageType, glyph, &sbit, NULL))) {
       NSLog(@"FTC_SBitCache_Lookup() failed with error %08x (%08x, %08x, %ix%i, %08x)", error,
             glyph, (unsigned)imageType.face_id, imageType.width, imageType.height, imageType.flags);
-      return NSZeroSize;
+      return NO;
     }
 
-    cachedGlyph[entry] = glyph;
-    cachedSize[entry] = NSMakeSize(sbit->xadvance, sbit->yadvance);
-    return cachedSize[entry];
+    *advancement = NSMakeSize(sbit->xadvance, sbit->yadvance);
+    return YES;
   } else {
     FT_Face face;
     FT_Size size;
@@ -1377,7 +1382,6 @@ static FT_Error ft_get_face(FTC_FaceID fid, FT_Library lib, FT_Pointer data, FT_
     FT_Matrix ftmatrix;
     FT_Vector ftdelta;
     float f;
-    NSSize s;
 
     f = fabs(matrix[0] * matrix[3] - matrix[1] * matrix[2]);
     if (f > 1)
@@ -1395,26 +1399,64 @@ static FT_Error ft_get_face(FTC_FaceID fid, FT_Library lib, FT_Pointer data, FT_
     ftdelta.x = ftdelta.y = 0;
 
     if (FTC_Manager_LookupSize(ftc_manager, &scaler, &size))
-      return NSZeroSize;
+      return NO;
     face = size->face;
 
     if (FT_Load_Glyph(face, glyph, FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP))
-      return NSZeroSize;
+      return NO;
 
     if (FT_Get_Glyph(face->glyph, &gl))
-      return NSZeroSize;
+      return NO;
 
-    if (FT_Glyph_Transform(gl, &ftmatrix, &ftdelta))
-      return NSZeroSize;
+    if (FT_Glyph_Transform(gl, &ftmatrix, &ftdelta)) {
+      FT_Done_Glyph(gl);
+      return NO;
+    }
 
-    s = NSMakeSize(gl->advance.x / 65536.0, gl->advance.y / 65536.0);
+    *advancement = NSMakeSize(gl->advance.x / 65536.0, gl->advance.y / 65536.0);
 
     FT_Done_Glyph(gl);
 
-    return s;
+    return YES;
   }
 }
 
+- (NSSize)advancementForGlyph:(NSGlyph)glyph
+{
+  struct FTFontInfo_advance_page *page = NULL;
+  NSSize s;
+
+  if (glyph == NSControlGlyph || glyph == GSAttachmentGlyph)
+    return NSZeroSize;
+
+  if (glyph != NSNullGlyph)
+    glyph--;
+
+  if (glyph < 65536) {
+    unsigned int i = glyph & 0xff;
+
+    page = advancePages[glyph >> 8];
+    if (page && (page->known[i >> 3] & (1 << (i & 7)))) {
+      advance_hits++;
+      return page->size[i];
+    }
+    if (!page)
+      page = advancePages[glyph >> 8] = calloc(1, sizeof(struct FTFontInfo_advance_page));
+  }
+
+  advance_misses++;
+  if (![self _getAdvancement:&s forGlyph:glyph])
+    return NSZeroSize;
+
+  if (page) {
+    unsigned int i = glyph & 0xff;
+
+    page->size[i] = s;
+    page->known[i >> 3] |= 1 << (i & 7);
+  }
+  return s;
+}
+
 - (NSRect)boundingRectForGlyph:(NSGlyph)glyph
 {
   FT_BBox bbox;
@@ -1898,8 +1940,29 @@ static int filters[3][7] = {{0 * 65536 / 9, 1 * 65536 / 9, 2 * 65536 / 9, 3 * 65
 
   if (FT_Init_FreeType(&ft_library))
     NSLog(@"FT_Init_FreeType failed");
-  if (FTC_Manager_New(ft_library, 0, 0, 4096 * 24, ft_get_face, 0, &ftc_manager))
-    NSLog(@"FTC_Manager_New failed");
+
+  /* Sizes of the FreeType cache. 0 for faces or sizes uses the FreeType
+     defaults. */
+  {
+    NSUserDefaults *ud = [NSUserDefaults standardUserDefaults];
+    int max_faces = 8, max_sizes = 16, max_bytes = 2 * 1024 * 1024;
+
+    if ([ud objectForKey:@"back-art-cache-max-faces"])
+      max_faces = [ud integerForKey:@"back-art-cache-max-faces"];
+    if ([ud objectForKey:@"back-art-cache-max-sizes"])
+      max_sizes = [ud integerForKey:@"back-art-cache-max-sizes"];
+    if ([ud integerForKey:@"back-art-cache-max-bytes"] > 0)
+      max_bytes = [ud integerForKey:@"back-art-cache-max-bytes"];
+    NSDebugLLog(@"ftfont", @"FreeType cache: %i faces, %i sizes, %i bytes", max_faces,
+                max_sizes, max_bytes);
+
+    if (FTC_Manager_New(ft_library, max_faces, max_sizes, max_bytes, ft_get_face, 0,
+                        &ftc_manager))
+      NSLog(@"FTC_Manager_New failed");
+
+    if ([ud boolForKey:@"back-art-cache-statistics"])
+      atexit(log_cache_statistics);
+  }
   if (FTC_SBitCache_New(ftc_manager, &ftc_sbitcache))
     NSLog(@"FTC_SBitCache_New failed");
   if (FTC_ImageCache_New(ftc_manager, &ftc_imagecache))
@@ -347,7 +347,12 @@ static draw_info_t draw_infos[DI_NUM] = {
   NPRE(dissolve_aa,x), \
   NPRE(dissolve_oa,x), \
   NPRE(dissolve_ao,x), \
-  NPRE(dissolve_oo,x),
+  NPRE(dissolve_oo,x), \
+  \
+  NPRE(image_rgb_o,x), \
+  NPRE(image_rgb_a,x), \
+  NPRE(image_rgba_o,x), \
+  NPRE(image_rgba_a,x),
 
     /* TODO: try to implement fallback versions? possible? */
     {DI_FALLBACK, 0, 0, 0, -1, /*C(fallback)*/},
@@ -434,6 +439,7 @@ void artcontext_setup_draw_info(draw_info_t *di, unsigned int red_mask,
           @"Better: implement it and send a patch.)");
     exit(1);
   }
+  artcontext_setup_simd_draw_info(di);
 }
 
 void artcontext_setup_gamma(float gamma)
@@ -0,0 +1,433 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of GNUstep.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the
+   Free Software Foundation, 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+/*
+SIMD versions of the hottest blitters for the 32-bit formats with inline
+alpha at byte 3 (DI_32_RGBA and DI_32_BGRA): constant color runs (fills,
+strokes) and source-over compositing (images, icons).
+
+The results are bit-exact with the scalar versions in blit.m, including
+the rounding and the wrap-around of invalid (non-premultiplied) data.
+Only the order of the color bytes differs between the two formats and
+the compositing functions don't depend on it at all.
+
+x86 versions are compiled with function target attributes, so no special
+compiler flags are needed, and picked at run time. NEON is used if the
+compiler targets it.
+*/
+
+#include <string.h>
+
+#include "blit.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BLIT_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+#define SIMD_NONE 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_NEON 3
+
+static int simd_level = SIMD_NONE;
+
+#if defined(BLIT_X86) || defined(BLIT_NEON)
+
+/*
+Constant color runs compute, for each byte of the pixel,
+  n = (k + n * (255 - a)) >> 8
+where k is color * alpha + 0xff. run_alpha_a blends destination alpha
+the same way with k = 256 * alpha + 0xff, which is the
+(na * a + 0xffff - (a << 8)) >> 8 of the scalar version. All sums fit in
+16 bits.
+*/
+static void run_constants(int k[4], int c0, int c1, int c2, int a,
+                          int blend_alpha)
+{
+  k[0] = c0 * a + 0xff;
+  k[1] = c1 * a + 0xff;
+  k[2] = c2 * a + 0xff;
+  k[3] = blend_alpha ? 256 * a + 0xff : 0;
+}
+
+#endif
+
+#ifdef BLIT_X86
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+/** SSE2: 4 pixels at a time **/
+
+static SSE2 inline __m128i blend_sse2(__m128i d, __m128i ia, __m128i k)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(d, zero);
+  __m128i hi = _mm_unpackhi_epi8(d, zero);
+
+  lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, ia), k), 8);
+  hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, ia), k), 8);
+
+  return _mm_packus_epi16(lo, hi);
+}
+
+static SSE2 inline __m128i run_sse2(__m128i d, __m128i ia, __m128i k,
+                                    __m128i amask, int keep_alpha)
+{
+  __m128i r = blend_sse2(d, ia, k);
+
+  if (keep_alpha)
+    r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(amask, d));
+  return r;
+}
+
+static SSE2 void run_alpha_sse2(unsigned char *dst, const int k[4], int a,
+                                int keep_alpha, int num)
+{
+  __m128i ia = _mm_set1_epi16(255 - a);
+  __m128i kk = _mm_setr_epi16(k[0], k[1], k[2], k[3], k[0], k[1], k[2], k[3]);
+  __m128i amask = _mm_set1_epi32(0xff000000);
+  unsigned char tmp[16];
+
+  for (; num >= 4; num -= 4, dst += 16) {
+    __m128i d = _mm_loadu_si128((__m128i *)dst);
+    _mm_storeu_si128((__m128i *)dst, run_sse2(d, ia, kk, amask, keep_alpha));
+  }
+  if (num) {
+    memcpy(tmp, dst, num * 4);
+    _mm_storeu_si128((__m128i *)tmp,
+                     run_sse2(_mm_loadu_si128((__m128i *)tmp), ia, kk, amask,
+                              keep_alpha));
+    memcpy(dst, tmp, num * 4);
+  }
+}
+
+static SSE2 inline __m128i sover_sse2(__m128i s, __m128i d, __m128i amask,
+                                      int keep_alpha)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i ff = _mm_set1_epi16(0xff);
+  __m128i lo, hi, ia, r, transparent;
+
+  /* 255 - sa in all four 16-bit lanes of each pixel */
+  ia = _mm_unpacklo_epi8(s, zero);
+  ia = _mm_shufflehi_epi16(_mm_shufflelo_epi16(ia, 0xff), 0xff);
+  lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(ff, ia));
+  lo = _mm_srli_epi16(_mm_add_epi16(lo, ff), 8);
+
+  ia = _mm_unpackhi_epi8(s, zero);
+  ia = _mm_shufflehi_epi16(_mm_shufflelo_epi16(ia, 0xff), 0xff);
+  hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(ff, ia));
+  hi = _mm_srli_epi16(_mm_add_epi16(hi, ff), 8);
+
+  r = _mm_add_epi8(_mm_packus_epi16(lo, hi), s);
+  if (keep_alpha)
+    r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(amask, d));
+
+  /* fully transparent source pixels leave destination untouched */
+  transparent = _mm_cmpeq_epi32(_mm_and_si128(s, amask), zero);
+  return _mm_or_si128(_mm_and_si128(transparent, d),
+                      _mm_andnot_si128(transparent, r));
+}
+
+static SSE2 void sover_sse2_run(unsigned char *src, unsigned char *dst,
+                                int keep_alpha, int num)
+{
+  __m128i amask = _mm_set1_epi32(0xff000000);
+  unsigned char stmp[16], dtmp[16];
+
+  for (; num >= 4; num -= 4, src += 16, dst += 16) {
+    __m128i s = _mm_loadu_si128((__m128i *)src);
+    __m128i d = _mm_loadu_si128((__m128i *)dst);
+    _mm_storeu_si128((__m128i *)dst, sover_sse2(s, d, amask, keep_alpha));
+  }
+  if (num) {
+    memset(stmp, 0, sizeof(stmp));
+    memcpy(stmp, src, num * 4);
+    memcpy(dtmp, dst, num * 4);
+    _mm_storeu_si128((__m128i *)dtmp,
+                     sover_sse2(_mm_loadu_si128((__m128i *)stmp),
+                                _mm_loadu_si128((__m128i *)dtmp), amask,
+                                keep_alpha));
+    memcpy(dst, dtmp, num * 4);
+  }
+}
+
+/** AVX2: 8 pixels at a time, the rest is done by SSE2 versions **/
+
+static AVX2 void run_alpha_avx2(unsigned char *dst, const int k[4], int a,
+                                int keep_alpha, int num)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i ia = _mm256_set1_epi16(255 - a);
+  __m256i kk = _mm256_setr_epi16(k[0], k[1], k[2], k[3], k[0], k[1], k[2], k[3],
+                                 k[0], k[1], k[2], k[3], k[0], k[1], k[2], k[3]);
+  __m256i amask = _mm256_set1_epi32(0xff000000);
+
+  for (; num >= 8; num -= 8, dst += 32) {
+    __m256i d = _mm256_loadu_si256((__m256i *)dst);
+    __m256i lo = _mm256_unpacklo_epi8(d, zero);
+    __m256i hi = _mm256_unpackhi_epi8(d, zero);
+    __m256i r;
+
+    lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(lo, ia), kk), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(hi, ia), kk), 8);
+    r = _mm256_packus_epi16(lo, hi);
+    if (keep_alpha)
+      r = _mm256_blendv_epi8(r, d, amask);
+    _mm256_storeu_si256((__m256i *)dst, r);
+  }
+  if (num)
+    run_alpha_sse2(dst, k, a, keep_alpha, num);
+}
+
+static AVX2 void sover_avx2_run(unsigned char *src, unsigned char *dst,
+                                int keep_alpha, int num)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i ff = _mm256_set1_epi16(0xff);
+  __m256i amask = _mm256_set1_epi32(0xff000000);
+
+  for (; num >= 8; num -= 8, src += 32, dst += 32) {
+    __m256i s = _mm256_loadu_si256((__m256i *)src);
+    __m256i d = _mm256_loadu_si256((__m256i *)dst);
+    __m256i lo, hi, ia, r;
+
+    ia = _mm256_unpacklo_epi8(s, zero);
+    ia = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(ia, 0xff), 0xff);
+    lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+                            _mm256_sub_epi16(ff, ia));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, ff), 8);
+
+    ia = _mm256_unpackhi_epi8(s, zero);
+    ia = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(ia, 0xff), 0xff);
+    hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+                            _mm256_sub_epi16(ff, ia));
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, ff), 8);
+
+    r = _mm256_add_epi8(_mm256_packus_epi16(lo, hi), s);
+    if (keep_alpha)
+      r = _mm256_blendv_epi8(r, d, amask);
+    r = _mm256_blendv_epi8(
+        r, d, _mm256_cmpeq_epi32(_mm256_and_si256(s, amask), zero));
+    _mm256_storeu_si256((__m256i *)dst, r);
+  }
+  if (num)
+    sover_sse2_run(src, dst, keep_alpha, num);
+}
+
+#endif /* BLIT_X86 */
+
+#ifdef BLIT_NEON
+
+/** NEON: 16 pixels at a time, deinterleaved into byte planes **/
+
+static inline uint8x16_t blend_neon(uint8x16_t d, uint8x8_t ia, uint16x8_t k)
+{
+  uint8x8_t lo = vshrn_n_u16(vmlal_u8(k, vget_low_u8(d), ia), 8);
+  uint8x8_t hi = vshrn_n_u16(vmlal_u8(k, vget_high_u8(d), ia), 8);
+
+  return vcombine_u8(lo, hi);
+}
+
+static void run_alpha_neon_block(unsigned char *dst, const int k[4],
+                                 uint8x8_t ia, int keep_alpha)
+{
+  uint8x16x4_t d = vld4q_u8(dst);
+  int i;
+
+  for (i = 0; i < (keep_alpha ? 3 : 4); i++)
+    d.val[i] = blend_neon(d.val[i], ia, vdupq_n_u16(k[i]));
+  vst4q_u8(dst, d);
+}
+
+static void run_alpha_neon(unsigned char *dst, const int k[4], int a,
+                           int keep_alpha, int num)
+{
+  uint8x8_t ia = vdup_n_u8(255 - a);
+  unsigned char tmp[64];
+
+  for (; num >= 16; num -= 16, dst += 64)
+    run_alpha_neon_block(dst, k, ia, keep_alpha);
+  if (num) {
+    memcpy(tmp, dst, num * 4);
+    run_alpha_neon_block(tmp, k, ia, keep_alpha);
+    memcpy(dst, tmp, num * 4);
+  }
+}
+
+static void sover_neon_block(unsigned char *src, unsigned char *dst,
+                             int keep_alpha)
+{
+  uint8x16x4_t s = vld4q_u8(src);
+  uint8x16x4_t d = vld4q_u8(dst);
+  uint8x16_t transparent = vceqq_u8(s.val[3], vdupq_n_u8(0));
+  uint8x16_t ia = vmvnq_u8(s.val[3]);
+  uint16x8_t ff = vdupq_n_u16(0xff);
+  uint8x8_t lo, hi;
+  int i;
+
+  for (i = 0; i < (keep_alpha ? 3 : 4); i++) {
+    lo = vshrn_n_u16(vmlal_u8(ff, vget_low_u8(d.val[i]), vget_low_u8(ia)), 8);
+    hi = vshrn_n_u16(vmlal_u8(ff, vget_high_u8(d.val[i]), vget_high_u8(ia)), 8);
+    d.val[i] = vbslq_u8(transparent, d.val[i],
+                        vaddq_u8(vcombine_u8(lo, hi), s.val[i]));
+  }
+  vst4q_u8(dst, d);
+}
+
+static void sover_neon_run(unsigned char *src, unsigned char *dst,
+                           int keep_alpha, int num)
+{
+  unsigned char stmp[64], dtmp[64];
+
+  for (; num >= 16; num -= 16, src += 64, dst += 64)
+    sover_neon_block(src, dst, keep_alpha);
+  if (num) {
+    memset(stmp, 0, sizeof(stmp));
+    memcpy(stmp, src, num * 4);
+    memcpy(dtmp, dst, num * 4);
+    sover_neon_block(stmp, dtmp, keep_alpha);
+    memcpy(dst, dtmp, num * 4);
+  }
+}
+
+#endif /* BLIT_NEON */
+
+/*
+draw_info_t entries. Constant color runs depend on the byte order of
+colors, compositing doesn't.
+*/
+#define SIMD_FUNCTIONS(isa)                                                   \
+  static void rgba_run_alpha_##isa(render_run_t *ri, int num)                 \
+  {                                                                           \
+    int k[4];                                                                 \
+    run_constants(k, ri->r, ri->g, ri->b, ri->a, 0);                          \
+    run_alpha_##isa(ri->dst, k, ri->a, 1, num);                               \
+  }                                                                           \
+  static void rgba_run_alpha_a_##isa(render_run_t *ri, int num)               \
+  {                                                                           \
+    int k[4];                                                                 \
+    run_constants(k, ri->r, ri->g, ri->b, ri->a, 1);                          \
+    run_alpha_##isa(ri->dst, k, ri->a, 0, num);                               \
+  }                                                                           \
+  static void bgra_run_alpha_##isa(render_run_t *ri, int num)                 \
+  {                                                                           \
+    int k[4];                                                                 \
+    run_constants(k, ri->b, ri->g, ri->r, ri->a, 0);                          \
+    run_alpha_##isa(ri->dst, k, ri->a, 1, num);                               \
+  }                                                                           \
+  static void bgra_run_alpha_a_##isa(render_run_t *ri, int num)               \
+  {                                                                           \
+    int k[4];                                                                 \
+    run_constants(k, ri->b, ri->g, ri->r, ri->a, 1);                          \
+    run_alpha_##isa(ri->dst, k, ri->a, 0, num);                               \
+  }                                                                           \
+  static void sover_aa_##isa(composite_run_t *c, int num)                     \
+  {                                                                           \
+    sover_##isa##_run(c->src, c->dst, 0, num);                                \
+  }                                                                           \
+  static void sover_ao_##isa(composite_run_t *c, int num)                     \
+  {                                                                           \
+    sover_##isa##_run(c->src, c->dst, 1, num);                                \
+  }
+
+#define SIMD_SETUP(di, fmt, isa)                                              \
+  do {                                                                        \
+    (di)->render_run_alpha = fmt##_run_alpha_##isa;                           \
+    (di)->render_run_alpha_a = fmt##_run_alpha_a_##isa;                       \
+    (di)->composite_sover_aa = sover_aa_##isa;                                \
+    (di)->composite_sover_ao = sover_ao_##isa;                                \
+  } while (0)
+
+#ifdef BLIT_X86
+SIMD_FUNCTIONS(sse2)
+SIMD_FUNCTIONS(avx2)
+#endif
+#ifdef BLIT_NEON
+SIMD_FUNCTIONS(neon)
+#endif
+
+const char *artcontext_setup_simd(int enable)
+{
+  simd_level = SIMD_NONE;
+  if (!enable)
+    return NULL;
+
+#if defined(BLIT_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    simd_level = SIMD_AVX2;
+  else if (__builtin_cpu_supports("sse2"))
+    simd_level = SIMD_SSE2;
+#elif defined(BLIT_NEON)
+  simd_level = SIMD_NEON;
+#endif
+
+  switch (simd_level) {
+  case SIMD_SSE2:
+    return "SSE2";
+  case SIMD_AVX2:
+    return "AVX2";
+  case SIMD_NEON:
+    return "NEON";
+  default:
+    return NULL;
+  }
+}
+
+void artcontext_setup_simd_draw_info(draw_info_t *di)
+{
+  if (di->how != DI_32_RGBA && di->how != DI_32_BGRA)
+    return;
+
+  switch (simd_level) {
+#ifdef BLIT_X86
+  case SIMD_SSE2:
+    if (di->how == DI_32_RGBA)
+      SIMD_SETUP(di, rgba, sse2);
+    else
+      SIMD_SETUP(di, bgra, sse2);
+    break;
+  case SIMD_AVX2:
+    if (di->how == DI_32_RGBA)
+      SIMD_SETUP(di, rgba, avx2);
+    else
+      SIMD_SETUP(di, bgra, avx2);
+    break;
+#endif
+#ifdef BLIT_NEON
+  case SIMD_NEON:
+    if (di->how == DI_32_RGBA)
+      SIMD_SETUP(di, rgba, neon);
+    else
+      SIMD_SETUP(di, bgra, neon);
+    break;
+#endif
+  default:
+    break;
+  }
+}
@@ -129,6 +129,15 @@ typedef struct draw_info_s {
   void (*dissolve_oa)(composite_run_t *c, int num);
   void (*dissolve_ao)(composite_run_t *c, int num);
   void (*dissolve_oo)(composite_run_t *c, int num);
+
+  /* Draw num pixels of 8-bit image samples. src is RGB (3 bytes per
+     pixel) or RGBA with premultiplied alpha (4 bytes per pixel). RGBA
+     pixels are composited with source-over. _a versions also update
+     destination alpha. */
+  void (*image_rgb_o)(render_run_t *ri, const unsigned char *src, int num);
+  void (*image_rgb_a)(render_run_t *ri, const unsigned char *src, int num);
+  void (*image_rgba_o)(render_run_t *ri, const unsigned char *src, int num);
+  void (*image_rgba_a)(render_run_t *ri, const unsigned char *src, int num);
 } draw_info_t;
 
 #define RENDER_RUN_ALPHA (DI.render_run_alpha)
@@ -148,4 +157,11 @@ void artcontext_setup_draw_info(draw_info_t *di, unsigned int red_mask,
                                 int bpp);
 void artcontext_setup_gamma(float gamma);
 
+/* Picks SIMD versions of the hot draw_info_t entries for the CPU we run
+   on (blit-simd.m). Returns the name of the instruction set in use or
+   NULL if only scalar versions are used. Must be called before
+   artcontext_setup_draw_info(). */
+const char *artcontext_setup_simd(int enable);
+void artcontext_setup_simd_draw_info(draw_info_t *di);
+
 #endif
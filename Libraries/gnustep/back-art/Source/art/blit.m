@@ -1396,6 +1396,104 @@ static void MPRE(dissolve_oo)(composite_run_t *c, int num)
   }
 }
 
+/*
+  Image spans. Used by DPSimage for images which are drawn without rotation
+  and have 8-bit RGB or RGBA samples. Results match the per-pixel
+  RENDER_RUN_* path.
+*/
+static void MPRE(image_rgb_o)(render_run_t *ri, const unsigned char *src, int num)
+{
+  COPY_TYPE *dst = (COPY_TYPE *)ri->dst;
+  COPY_TYPE_PIXEL(v)
+
+  for (; num; num--, src += 3) {
+    COPY_ASSEMBLE_PIXEL(v, src[0], src[1], src[2])
+    COPY_WRITE(dst, v)
+    COPY_INC(dst)
+  }
+}
+
+static void MPRE(image_rgb_a)(render_run_t *ri, const unsigned char *src, int num)
+{
+  COPY_TYPE *dst = (COPY_TYPE *)ri->dst;
+  COPY_TYPE_PIXEL(v)
+  int n;
+
+  for (n = num; n; n--, src += 3) {
+#ifdef INLINE_ALPHA
+    COPY_ASSEMBLE_PIXEL_ALPHA(v, src[0], src[1], src[2], 0xff)
+#else
+    COPY_ASSEMBLE_PIXEL(v, src[0], src[1], src[2])
+#endif
+    COPY_WRITE(dst, v)
+    COPY_INC(dst)
+  }
+#ifndef INLINE_ALPHA
+  memset(ri->dsta, 0xff, num);
+#endif
+}
+
+static void MPRE(image_rgba_o)(render_run_t *ri, const unsigned char *src, int num)
+{
+  BLEND_TYPE *dst = (BLEND_TYPE *)ri->dst;
+  int nr, ng, nb;
+  int r, g, b, a;
+
+  for (; num; num--, src += 4) {
+    a = src[3];
+    if (a == 255) {
+      r = src[0];
+      g = src[1];
+      b = src[2];
+      BLEND_WRITE(dst, r, g, b)
+    } else if (a) {
+      /* undo premultiply as RENDER_RUN_ALPHA expects */
+      r = (255 * src[0]) / a * a;
+      g = (255 * src[1]) / a * a;
+      b = (255 * src[2]) / a * a;
+      a = 255 - a;
+      BLEND_READ(dst, nr, ng, nb)
+      nr = (r + nr * a + 0xff) >> 8;
+      ng = (g + ng * a + 0xff) >> 8;
+      nb = (b + nb * a + 0xff) >> 8;
+      BLEND_WRITE(dst, nr, ng, nb)
+    }
+    BLEND_INC(dst)
+  }
+}
+
+static void MPRE(image_rgba_a)(render_run_t *ri, const unsigned char *src, int num)
+{
+  BLEND_TYPE *dst = (BLEND_TYPE *)ri->dst;
+#ifndef INLINE_ALPHA
+  unsigned char *dst_alpha = ri->dsta;
+#endif
+  int nr, ng, nb, na;
+  int r, g, b, a;
+
+  for (; num; num--, src += 4) {
+    a = src[3];
+    if (a == 255) {
+      r = src[0];
+      g = src[1];
+      b = src[2];
+      BLEND_WRITE_ALPHA(dst, dst_alpha, r, g, b, 0xff)
+    } else if (a) {
+      r = (255 * src[0]) / a * a;
+      g = (255 * src[1]) / a * a;
+      b = (255 * src[2]) / a * a;
+      a = 255 - a;
+      BLEND_READ_ALPHA(dst, dst_alpha, nr, ng, nb, na)
+      nr = (r + nr * a + 0xff) >> 8;
+      ng = (g + ng * a + 0xff) >> 8;
+      nb = (b + nb * a + 0xff) >> 8;
+      na = (na * a + 0xffff - (a << 8)) >> 8;
+      BLEND_WRITE_ALPHA(dst, dst_alpha, nr, ng, nb, na)
+    }
+    ALPHA_INC(dst, dst_alpha)
+  }
+}
+
 #undef I_NAME
 #undef BLEND_TYPE
 #undef BLEND_READ
@@ -199,6 +199,22 @@ typedef struct {
   BOOL	known;	// obtained from Reparent event or just guessed?
 } Offsets;
 
+/*
+ * Pointer position of one MotionNotify event. Motion events queued behind
+ * each other are delivered to AppKit as one event, the positions of all of
+ * them are kept in a ring buffer for applications that want them.
+ */
+#define MOTION_HISTORY_SIZE 256
+
+typedef struct {
+  Time		time;
+  unsigned long	burst;		// samples delivered as one event share it
+  unsigned long	serial;		// eventNumber of the delivered event
+  int		windowNumber;	// 0 if no event was delivered
+  NSPoint	location;	// X coordinates until windowNumber is set
+  unsigned int	state;
+} MotionSample;
+
 /*
  * Structure containing ivars that are common to all X backend contexts.
  */
@@ -222,6 +238,12 @@ struct XGGeneric {
   int			lastClickX;
   int			lastClickY;
   Time			lastMotion;
+  // Positions of recent motion events, oldest first from
+  // motionHistoryNext - motionHistoryCount.
+  MotionSample		motionHistory[MOTION_HISTORY_SIZE];
+  unsigned		motionHistoryNext;
+  unsigned		motionHistoryCount;
+  unsigned long		motionBurst;
   // Name for application root window.
   char			*rootName;
   long			currentFocusWindow;
@@ -129,6 +129,21 @@ typedef struct MonitorDevice {
 - (BOOL)setPreeditSpot:(NSPoint *)p;
 @end
 
+/*
+ * Motion events queued behind each other are delivered as one event.
+ * Applications which follow the pointer closely (drawing, handwriting)
+ * can get all positions the X server reported. GSDisplayServer has no
+ * such methods, so callers check that GSCurrentServer() responds to them.
+ */
+@interface XGServer (MotionHistory)
+// Events for all positions coalesced into theEvent, oldest first and
+// ending with the position of theEvent itself
+- (NSArray *)coalescedEventsForEvent:(NSEvent *)theEvent;
+// Events for the recent positions of the pointer in the window, like
+// XGetMotionEvents
+- (NSArray *)motionEventsForWindow:(int)win since:(NSTimeInterval)timestamp;
+@end
+
 @interface XGServer (TimeKeeping)
 - (void)setLastTime:(Time)last;
 - (Time)lastTime;
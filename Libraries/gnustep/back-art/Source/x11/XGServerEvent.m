@@ -98,6 +98,7 @@ static NSInteger mouseScrollMultiplier;  // "GSMouseScrollMultiplier" - times (1
 static NSEventType menuMouseButton;      // "GSMenuButtonEvent" - (NSRightMouseButon)
 static BOOL menuButtonEnabled;           // "GSMenuButtonEnabled" - BOOL
 static BOOL swapMouseButtons;            // YES if "GSMenuButtonEvent" == NSLeftMouseButton
+static BOOL coalesceMotion;              // "GSCoalesceMotionEvents" - BOOL (YES)
 
 void __objc_xgcontextevent_linking(void) {}
 
@@ -157,6 +158,96 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
   return 0;
 }
 
+/*
+ * Expose rectangles of one window are accumulated in a short list before
+ * AppKit events are generated. A rectangle is merged into an existing one
+ * if their bounding box is not much bigger than both of them; if the list
+ * is full, it is merged into the one whose bounding box grows least.
+ */
+#define MAX_EXPOSE_RECTS 4
+#define EXPOSE_MERGE_SLACK 4096
+
+static long expose_rect_area(XRectangle *r)
+{
+  return (long)r->width * r->height;
+}
+
+static XRectangle expose_rect_union(XRectangle *a, XRectangle *b)
+{
+  XRectangle u;
+  int x2 = MAX(a->x + a->width, b->x + b->width);
+  int y2 = MAX(a->y + a->height, b->y + b->height);
+
+  u.x = MIN(a->x, b->x);
+  u.y = MIN(a->y, b->y);
+  u.width = x2 - u.x;
+  u.height = y2 - u.y;
+  return u;
+}
+
+static void add_expose_rect(XRectangle *rects, int *num_rects, XRectangle r)
+{
+  XRectangle u;
+  long waste, best_waste = 0;
+  int i, best = -1;
+
+  if (r.width == 0 || r.height == 0)
+    return;
+
+  for (i = 0; i < *num_rects; i++) {
+    u = expose_rect_union(&rects[i], &r);
+    waste = expose_rect_area(&u) - expose_rect_area(&rects[i]) - expose_rect_area(&r);
+    if (best < 0 || waste < best_waste) {
+      best = i;
+      best_waste = waste;
+    }
+  }
+
+  if (best >= 0 && (best_waste <= EXPOSE_MERGE_SLACK || *num_rects == MAX_EXPOSE_RECTS)) {
+    r = expose_rect_union(&rects[best], &r);
+    /* Grown rectangle may now cover others */
+    rects[best] = rects[--(*num_rects)];
+    add_expose_rect(rects, num_rects, r);
+    return;
+  }
+
+  rects[(*num_rects)++] = r;
+}
+
+#define MOTION_SAMPLE(g, i) \
+  (&(g).motionHistory[((g).motionHistoryNext + MOTION_HISTORY_SIZE - (i)) % MOTION_HISTORY_SIZE])
+
+/*
+ * Appends the position of a MotionNotify event to the motion history,
+ * overwriting the oldest sample once the history is full.
+ */
+static void add_motion_sample(struct XGGeneric *g, XMotionEvent *xmotion)
+{
+  MotionSample *s = &g->motionHistory[g->motionHistoryNext];
+
+  s->time = xmotion->time;
+  s->burst = g->motionBurst;
+  s->serial = xmotion->serial;
+  s->windowNumber = 0;
+  s->location = NSMakePoint(xmotion->x, xmotion->y);
+  s->state = xmotion->state;
+
+  g->motionHistoryNext = (g->motionHistoryNext + 1) % MOTION_HISTORY_SIZE;
+  if (g->motionHistoryCount < MOTION_HISTORY_SIZE)
+    g->motionHistoryCount++;
+}
+
+static NSEventType motion_event_type(struct XGGeneric *g, unsigned int state)
+{
+  if (state & g->lMouseMask)
+    return NSLeftMouseDragged;
+  else if (state & g->rMouseMask)
+    return NSRightMouseDragged;
+  else if (state & g->mMouseMask)
+    return NSOtherMouseDragged;
+  return NSMouseMoved;
+}
+
 @implementation XGServer (EventOps)
 
 - (int)XGErrorHandler:(Display *)display :(XErrorEvent *)err
@@ -299,6 +390,11 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
       swapMouseButtons = NO;
       break;
   }
+
+  if ([defs objectForKey:@"GSCoalesceMotionEvents"])
+    coalesceMotion = [defs boolForKey:@"GSCoalesceMotionEvents"];
+  else
+    coalesceMotion = YES;
 }
 
 - (void)initializeMouse
@@ -936,20 +1032,46 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
           generic.cachedWindow = [XGServer _windowForXWindow:xEvent.xexpose.window];
         }
         if (cWin != 0) {
+          XRectangle rects[MAX_EXPOSE_RECTS];
           XRectangle rectangle;
+          int num_rects = 0;
+          int i;
           NSRect rect;
           NSTimeInterval ts = (NSTimeInterval)generic.lastMotion;
 
-          rectangle.x = xEvent.xexpose.x;
-          rectangle.y = xEvent.xexpose.y;
-          rectangle.width = xEvent.xexpose.width;
-          rectangle.height = xEvent.xexpose.height;
-
-          NSDebugLLog(@"NSEvent", @"Expose frame %d %d %d %d\n", rectangle.x, rectangle.y,
-                      rectangle.width, rectangle.height);
+          /*
+           * Collect the whole series of Expose events (until count is 0)
+           * and any other Expose of this window queued right after it,
+           * then generate one event per coalesced rectangle.
+           */
+          for (;;) {
+            rectangle.x = xEvent.xexpose.x;
+            rectangle.y = xEvent.xexpose.y;
+            rectangle.width = xEvent.xexpose.width;
+            rectangle.height = xEvent.xexpose.height;
+
+            NSDebugLLog(@"NSEvent", @"Expose frame %d %d %d %d (count %d)\n", rectangle.x,
+                        rectangle.y, rectangle.width, rectangle.height, xEvent.xexpose.count);
+            add_expose_rect(rects, &num_rects, rectangle);
+
+            if (XPending(dpy) > 0) {
+              XEvent peek;
+
+              XPeekEvent(dpy, &peek);
+              if (peek.type == Expose && peek.xexpose.window == xEvent.xexpose.window) {
+                XNextEvent(dpy, &xEvent);
+                continue;
+              }
+            }
+            break;
+          }
 
-          rect = NSMakeRect(rectangle.x, rectangle.y, rectangle.width, rectangle.height);
-            rect = [self _XWinRectToOSWinRect: rect for: cWin];
+          for (i = 0; i < num_rects; i++) {
+            if (e != nil) {
+              [event_queue addObject:e];
+            }
+            rect = NSMakeRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+            rect = [self _XWinRectToOSWinRect:rect for:cWin];
             e = [NSEvent otherEventWithType:NSAppKitDefined
                                    location:rect.origin
                               modifierFlags:eventFlags
@@ -959,6 +1081,7 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
                                     subtype:GSAppKitRegionExposed
                                       data1:rect.size.width
                                       data2:rect.size.height];
+          }
         }
         break;
       }
@@ -1215,34 +1338,37 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
                   xEvent.xmotion.x, xEvent.xmotion.y);
       {
         unsigned int state;
+        unsigned int samples = 1;
+        unsigned int i;
+
+        if (clickTime == 0)
+          [self initializeMouse];
 
         /*
-         * Compress motion events to avoid flooding.
+         * Compress motion events to avoid flooding. Only the last
+         * position is delivered, all of them go to the motion history.
          */
-        while (XPending(xEvent.xmotion.display)) {
+        generic.motionBurst++;
+        add_motion_sample(&generic, &xEvent.xmotion);
+        while (coalesceMotion && XPending(xEvent.xmotion.display)) {
           XEvent peek;
 
           XPeekEvent(xEvent.xmotion.display, &peek);
           if (peek.type == MotionNotify && xEvent.xmotion.window == peek.xmotion.window &&
               xEvent.xmotion.subwindow == peek.xmotion.subwindow) {
             XNextEvent(xEvent.xmotion.display, &xEvent);
+            add_motion_sample(&generic, &xEvent.xmotion);
+            samples++;
           } else {
             break;
           }
         }
+        NSDebugLLog(@"NSMotionEvent", @"%u motion events coalesced\n", samples);
 
         generic.lastMotion = xEvent.xmotion.time;
         [self setLastTime:generic.lastMotion];
         state = xEvent.xmotion.state;
-        if (state & generic.lMouseMask) {
-          eventType = NSLeftMouseDragged;
-        } else if (state & generic.rMouseMask) {
-          eventType = NSRightMouseDragged;
-        } else if (state & generic.mMouseMask) {
-          eventType = NSOtherMouseDragged;
-        } else {
-          eventType = NSMouseMoved;
-        }
+        eventType = motion_event_type(&generic, state);
 
         eventFlags = process_modifier_flags(state);
         // if pointer is grabbed use grab window instead
@@ -1252,6 +1378,15 @@ static int check_modifier(XEvent *xEvent, KeySym key_sym)
         if (cWin == 0)
           break;
 
+        /* Samples of this burst are the newest ones in the history */
+        for (i = MIN(samples, MOTION_HISTORY_SIZE); i > 0; i--) {
+          MotionSample *s = MOTION_SAMPLE(generic, i);
+
+          s->location = [self _XPointToOSPoint:s->location for:cWin];
+          s->windowNumber = cWin->number;
+          s->serial = xEvent.xmotion.serial;
+        }
+
         deltaX = -eventLocation.x;
         deltaY = -eventLocation.y;
         eventLocation = NSMakePoint(xEvent.xmotion.x, xEvent.xmotion.y);
@@ -2395,6 +2530,141 @@ static unsigned int process_modifier_flags(unsigned int state)
 
 @end
 
+@implementation XGServer (MotionHistory)
+
+- (NSEvent *)_eventForMotionSample:(MotionSample *)s
+                             after:(MotionSample *)prev
+                           context:(NSGraphicsContext *)gcontext
+{
+  float deltaX = 0;
+  float deltaY = 0;
+
+  if (prev) {
+    deltaX = s->location.x - prev->location.x;
+    deltaY = s->location.y - prev->location.y;
+  }
+
+  return [NSEvent mouseEventWithType:motion_event_type(&generic, s->state)
+                            location:s->location
+                       modifierFlags:process_modifier_flags(s->state)
+                           timestamp:(NSTimeInterval)s->time / 1000.0
+                        windowNumber:s->windowNumber
+                             context:GSCurrentContext()
+                         eventNumber:s->serial
+                          clickCount:1
+                            pressure:1.0
+                        buttonNumber:0
+                              deltaX:deltaX
+                              deltaY:deltaY
+                              deltaZ:0];
+}
+
+- (NSArray *)coalescedEventsForEvent:(NSEvent *)theEvent
+{
+  NSMutableArray *events;
+  MotionSample *s;
+  MotionSample *prev = NULL;
+  unsigned long burst = 0;
+  Time time;
+  int win;
+  unsigned i;
+
+  switch ([theEvent type]) {
+    case NSMouseMoved:
+    case NSLeftMouseDragged:
+    case NSRightMouseDragged:
+    case NSOtherMouseDragged:
+      break;
+    default:
+      return [NSArray arrayWithObject:theEvent];
+  }
+
+  /* Find the sample the event was made from, newest first */
+  win = [theEvent windowNumber];
+  time = (Time)([theEvent timestamp] * 1000.0 + 0.5);
+  for (i = 1; i <= generic.motionHistoryCount; i++) {
+    s = MOTION_SAMPLE(generic, i);
+    if (s->windowNumber == win && s->serial == (unsigned long)[theEvent eventNumber] &&
+        s->time == time) {
+      burst = s->burst;
+      break;
+    }
+  }
+  if (burst == 0) {
+    /* Not coalesced or already dropped from the history */
+    return [NSArray arrayWithObject:theEvent];
+  }
+
+  events = [NSMutableArray array];
+  for (i = generic.motionHistoryCount; i > 0; i--) {
+    s = MOTION_SAMPLE(generic, i);
+    if (s->windowNumber != win)
+      continue;
+    if (s->burst == burst)
+      [events addObject:[self _eventForMotionSample:s after:prev context:[theEvent context]]];
+    prev = s;
+  }
+  return events;
+}
+
+/*
+ * If the history has been overwritten since the timestamp, positions
+ * before the oldest sample are asked from the X server, if it keeps a
+ * motion buffer. The server doesn't report button and modifier state, so
+ * they are taken from the oldest sample.
+ */
+- (NSArray *)motionEventsForWindow:(int)win since:(NSTimeInterval)timestamp
+{
+  NSMutableArray *events = [NSMutableArray array];
+  gswindow_device_t *window = [XGServer _windowWithTag:win];
+  Time start = (Time)(timestamp * 1000.0 + 0.5);
+  MotionSample *s;
+  MotionSample *prev = NULL;
+  MotionSample serverSample;
+  MotionSample lastServerSample;
+  /* Same context as -receivedEvent:... gives to delivered events */
+  NSGraphicsContext *gcontext = GSCurrentContext();
+  unsigned i;
+
+  if (window == NULL)
+    return events;
+
+  s = MOTION_SAMPLE(generic, generic.motionHistoryCount);
+  if (generic.motionHistoryCount == MOTION_HISTORY_SIZE && s->time > start + 1 &&
+      XDisplayMotionBufferSize(dpy) > 0) {
+    XTimeCoord *coords;
+    int count = 0;
+    int j;
+
+    coords = XGetMotionEvents(dpy, window->ident, start + 1, s->time - 1, &count);
+    NSDebugLLog(@"NSMotionEvent", @"%d motion events from server buffer\n", count);
+    for (j = 0; j < count; j++) {
+      serverSample = *s;
+      serverSample.time = coords[j].time;
+      serverSample.serial = 0;
+      serverSample.windowNumber = win;
+      serverSample.location = [self _XPointToOSPoint:NSMakePoint(coords[j].x, coords[j].y)
+                                                 for:window];
+      [events addObject:[self _eventForMotionSample:&serverSample after:prev context:gcontext]];
+      lastServerSample = serverSample;
+      prev = &lastServerSample;
+    }
+    if (coords)
+      XFree(coords);
+  }
+
+  for (i = generic.motionHistoryCount; i > 0; i--) {
+    s = MOTION_SAMPLE(generic, i);
+    if (s->windowNumber != win || s->time <= start)
+      continue;
+    [events addObject:[self _eventForMotionSample:s after:prev context:gcontext]];
+    prev = s;
+  }
+  return events;
+}
+
+@end
+
 @implementation XGServer (TimeKeeping)
 // Sync time with X server every 10 seconds
 #define MAX_TIME_DIFF 10
@@ -65,6 +65,12 @@ struct XWindowBuffer_depth_info_s {
   int byte_order;
 };
 
+struct XWindowBuffer_rect_s {
+  int x, y, w, h;
+};
+
+#define XWB_MAX_PENDING_RECTS 8
+
 /*
   XWindowBuffer maintains an XImage for a window. Each ARTGState that
   renders to that window uses the same XWindowBuffer (and thus the same
@@ -90,17 +96,19 @@ struct XWindowBuffer_depth_info_s {
 
   /* While a XShmPutImage is in progress we don't try to call it
      again. The pending updates are stored here, and when we get the
-     ShmCompletion event, we handle them. */
-  int pending_put; /* There are pending updates */
-  struct {
-    int x, y, w, h;
-  } pending_rect; /* in this rectangle. */
+     ShmCompletion event, we handle them. Updates are kept as a few
+     rectangles (close ones are merged), so small updates far apart
+     don't make us put everything between them. */
+  int num_pending; /* Number of rectangles with pending updates */
+  struct XWindowBuffer_rect_s
+    pending_rects[XWB_MAX_PENDING_RECTS]; /* in these rectangles. */
 
   int pending_event; /* We're waiting for the ShmCompletion event. */
 
-  /* This is for the ugly shape-hack */
-  unsigned char *old_shape;
-  int old_shape_size;
+  /* This is for the ugly shape-hack. The bitmap is what the bounding
+     shape of the window was last set to. */
+  unsigned char *shape;
+  int shape_size;
 
  @public
   unsigned char *data;
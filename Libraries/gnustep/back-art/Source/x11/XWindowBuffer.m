@@ -30,6 +30,7 @@
 #include "x11/XGServerWindow.h"
 #include "x11/XWindowBuffer.h"
 
+#include <limits.h>
 #include <math.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
@@ -44,6 +45,75 @@ static int num_window_buffers;
 
 static int use_shape_hack = 0; /* this is an ugly hack : ) */
 
+/*
+Pending updates. Merging two rectangles is worth it if their bounding box
+isn't much larger than both of them (they overlap, touch or are close), as
+every XShmPutImage has an overhead of its own.
+*/
+#define MERGE_SLACK 1024 /* pixels that may be put needlessly */
+
+static inline int rect_area(struct XWindowBuffer_rect_s *r)
+{
+  return r->w * r->h;
+}
+
+static void rect_union(struct XWindowBuffer_rect_s *u,
+                       struct XWindowBuffer_rect_s *a,
+                       struct XWindowBuffer_rect_s *b)
+{
+  int x0 = a->x < b->x ? a->x : b->x;
+  int y0 = a->y < b->y ? a->y : b->y;
+  int x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+  int y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+
+  u->x = x0;
+  u->y = y0;
+  u->w = x1 - x0;
+  u->h = y1 - y0;
+}
+
+static void add_pending_rect(struct XWindowBuffer_rect_s *rects, int *num,
+                             int x, int y, int w, int h)
+{
+  struct XWindowBuffer_rect_s r = {x, y, w, h}, u;
+  int i, best, waste, best_waste;
+
+  /* A merged rectangle might be worth merging with others, too. */
+  for (i = 0; i < *num; )
+    {
+      rect_union(&u, &rects[i], &r);
+      if (rect_area(&u) <= rect_area(&rects[i]) + rect_area(&r) + MERGE_SLACK)
+        {
+          r = u;
+          rects[i] = rects[--(*num)];
+          i = 0;
+        }
+      else
+        i++;
+    }
+
+  if (*num < XWB_MAX_PENDING_RECTS)
+    {
+      rects[(*num)++] = r;
+      return;
+    }
+
+  /* No room, merge with the rectangle that wastes the least. */
+  best = 0;
+  best_waste = INT_MAX;
+  for (i = 0; i < *num; i++)
+    {
+      rect_union(&u, &rects[i], &r);
+      waste = rect_area(&u) - rect_area(&rects[i]) - rect_area(&r);
+      if (waste < best_waste)
+        {
+          best = i;
+          best_waste = waste;
+        }
+    }
+  rect_union(&rects[best], &rects[best], &r);
+}
+
 #ifdef XSHM
 
 static int did_test_xshm = 0;
@@ -275,7 +345,10 @@ no_xshm:
           wi->alpha = NULL;
         }
 
-      wi->pending_put = wi->pending_event = 0;
+      wi->num_pending = wi->pending_event = 0;
+
+      /* The whole shape is set again on the next expose. */
+      wi->shape_size = 0;
 
       wi->ximage = NULL;
 
@@ -432,38 +505,192 @@ extern int XShmGetEventBase(Display *d);
     return;
 
   pending_event = 0;
-  if (pending_put)
+  if (num_pending)
     {
-      pending_put = 0;
-      if (pending_rect.x + pending_rect.w > window->xframe.size.width)
+      struct XWindowBuffer_rect_s *r;
+      int i, n;
+
+      /* The window might have shrunk meanwhile. */
+      for (i = n = 0; i < num_pending; i++)
         {
-          pending_rect.w = window->xframe.size.width - pending_rect.x;
-          if (pending_rect.w <= 0)
-            return;
+          r = &pending_rects[i];
+          if (r->x + r->w > window->xframe.size.width)
+            r->w = window->xframe.size.width - r->x;
+          if (r->y + r->h > window->xframe.size.height)
+            r->h = window->xframe.size.height - r->y;
+          if (r->w > 0 && r->h > 0)
+            pending_rects[n++] = *r;
         }
-      if (pending_rect.y + pending_rect.h > window->xframe.size.height)
+      num_pending = 0;
+
+      /* Requests are handled in order, so completion of the last one
+         means that all of them are done. */
+      for (i = 0; i < n; i++)
         {
-          pending_rect.h = window->xframe.size.height - pending_rect.y;
-          if (pending_rect.h <= 0)
-            return;
+          r = &pending_rects[i];
+          if (!XShmPutImage(display, drawable, gc, ximage,
+                            r->x, r->y, r->x, r->y, r->w, r->h,
+                            i == n - 1))
+            {
+              NSLog(@"XShmPutImage failed?");
+            }
+          else if (i == n - 1)
+            {
+              pending_event = 1;
+            }
         }
-      if (!XShmPutImage(display, drawable, gc, ximage,
-                        pending_rect.x, pending_rect.y,
-                        pending_rect.x, pending_rect.y,
-                        pending_rect.w, pending_rect.h,
-                        1))
+    }
+//        XFlush(window->display);
+#endif
+}
+
+#ifdef HAVE_XSHAPE
+
+#define CUTOFF 128
+
+/* Too many deltas cost more than sending the whole bitmap. */
+#define MAX_SHAPE_DELTAS 512
+
+static BOOL append_shape_delta(XRectangle **rects, int *num, int *max,
+                               int x, int y, int w)
+{
+  if (*num == *max)
+    {
+      int n = *max ? *max * 2 : 64;
+      XRectangle *r = realloc(*rects, n * sizeof(XRectangle));
+
+      if (!r)
+        return NO;
+      *rects = r;
+      *max = n;
+    }
+  (*rects)[*num].x = x;
+  (*rects)[*num].y = y;
+  (*rects)[*num].width = w;
+  (*rects)[*num].height = 1;
+  (*num)++;
+  return YES;
+}
+
+/*
+The bitmap in `shape` is kept in sync with the bounding shape of the
+window. Only the exposed rectangle is rescanned and the runs of pixels
+that became opaque or transparent are added to or subtracted from the
+X shape. The whole bitmap is only sent when the buffer size changes or
+there are too many deltas.
+*/
+- (void) _updateShape: (int)x : (int)y : (int)w : (int)h
+{
+static int warn = 0;
+  int bpl = (sx + 7) / 8;
+  int dsize = bpl * sy;
+  XRectangle *add = NULL, *sub = NULL;
+  int num_add = 0, max_add = 0, num_sub = 0, max_sub = 0;
+  BOOL full = NO;
+  unsigned char *a, *bits;
+  int as, i, j, bit, opaque, changed, run_start, run_opaque;
+
+  if (!warn)
+    NSLog(@"Warning: activating shaped windows");
+  warn = 1;
+
+  as = DI.inline_alpha ? DI.bytes_per_pixel : 1;
+
+  if (!shape || shape_size != dsize)
+    {
+      free(shape);
+      shape = malloc(dsize);
+      if (!shape)
         {
-          NSLog(@"XShmPutImage failed?");
+          shape_size = 0;
+          return;
         }
+      shape_size = dsize;
+      memset(shape, 0xff, dsize);
+      x = y = 0;
+      w = sx;
+      h = sy;
+      full = YES;
+    }
+
+/* Records the run of changed pixels from run_start to `end` in row j. */
+#define END_RUN(end) \
+  if (!full) \
+    { \
+      if (run_opaque) \
+        full = !append_shape_delta(&add, &num_add, &max_add, \
+                                   run_start, j, (end) - run_start); \
+      else \
+        full = !append_shape_delta(&sub, &num_sub, &max_sub, \
+                                   run_start, j, (end) - run_start); \
+      if (num_add + num_sub > MAX_SHAPE_DELTAS) \
+        full = YES; \
+    } \
+  run_start = -1;
+
+  for (j = y; j < y + h; j++)
+    {
+      if (DI.inline_alpha)
+        a = data + j * bytes_per_line + x * as + DI.inline_alpha_ofs;
       else
+        a = alpha + j * sx + x;
+      bits = shape + j * bpl;
+      run_start = -1;
+      run_opaque = 0;
+
+      for (i = x; i < x + w; i++, a += as)
+        {
+          opaque = *a >= CUTOFF;
+          bit = 1 << (i & 7);
+          changed = !(bits[i >> 3] & bit) != !opaque;
+          if (changed)
+            bits[i >> 3] ^= bit;
+
+          if (run_start >= 0 && (!changed || run_opaque != opaque))
+            {
+              END_RUN(i)
+            }
+          if (changed && run_start < 0)
+            {
+              run_start = i;
+              run_opaque = opaque;
+            }
+        }
+      if (run_start >= 0)
         {
-          pending_event = 1;
+          END_RUN(x + w)
         }
     }
-//        XFlush(window->display);
-#endif
+#undef END_RUN
+
+  if (full)
+    {
+      Pixmap p;
+
+      p = XCreatePixmapFromBitmapData(display, window->ident,
+                                      (char *)shape, sx, sy, 1, 0, 1);
+      XShapeCombineMask(display, window->ident,
+                        ShapeBounding, 0, 0, p, ShapeSet);
+      XFreePixmap(display, p);
+    }
+  else
+    {
+      /* Runs are sorted by row and column, one row per band. */
+      if (num_sub)
+        XShapeCombineRectangles(display, window->ident, ShapeBounding, 0, 0,
+                                sub, num_sub, ShapeSubtract, YXBanded);
+      if (num_add)
+        XShapeCombineRectangles(display, window->ident, ShapeBounding, 0, 0,
+                                add, num_add, ShapeUnion, YXBanded);
+    }
+  free(add);
+  free(sub);
 }
 
+#undef CUTOFF
+
+#endif // HAVE_XSHAPE
+
 - (void) _exposeRect: (NSRect)rect
 {
 /* TODO: Somehow, we can get negative coordinates in the rectangle. So far
@@ -517,115 +744,17 @@ accuracy, we do the test using int: s.
          destination alpha */
       if (has_alpha && use_shape_hack)
         {
-static int warn = 0;
-          Pixmap p;
-          int dsize = ((sx + 7) / 8) * sy;
-          unsigned char *buf = malloc(dsize);
-          unsigned char *dst;
-          int bofs;
-          unsigned char *a;
-          int as;
-          int i, x;
-
-          if (!warn)
-            NSLog(@"Warning: activating shaped windows");
-          warn = 1;
-
-          memset(buf, 0xff, dsize);
-
-#define CUTOFF 128
-
-          if (DI.inline_alpha)
-            {
-              a = data + DI.inline_alpha_ofs;
-              as = DI.bytes_per_pixel;
-            }
-          else
-            {
-              a = alpha;
-              as = 1;
-            }
-
-          for (bofs = 0, i = sx * sy, x = sx, dst = buf; i; i--, a += as)
-            {
-              if (*a < CUTOFF)
-                {
-                  *dst = *dst & ~(1 << bofs);
-                }
-              bofs++;
-              if (bofs == 8)
-                {
-                  dst++;
-                  bofs = 0;
-                }
-              x--;
-              if (!x)
-                {
-                  if (bofs)
-                    {
-                      bofs = 0;
-                      dst++;
-                    }
-                  x = sx;
-                }
-            }
-#undef CUTOFF
-//NSLog(@"check shape");
-          if (old_shape_size == dsize && !memcmp(old_shape, buf, dsize))
-            {
-              free(buf);
-//                NSLog(@"  same shape");
-            }
-          else
-            {
-//                NSLog(@"  updating");
-              p = XCreatePixmapFromBitmapData(display, window->ident,
-                                              (char *)buf, sx, sy, 1, 0, 1);
-              free(old_shape);
-              old_shape = buf;
-              old_shape_size = dsize;
-              XShapeCombineMask(display, window->ident,
-                                ShapeBounding, 0, 0, p, ShapeSet);
-              XFreePixmap(display, p);
-            }
+          [self _updateShape: x : y : w : h];
         }
 #endif // HAVE_XSHAPE
 
       if (pending_event)
         {
-          if (!pending_put)
-            {
-              pending_put = 1;
-              pending_rect.x = x;
-              pending_rect.y = y;
-              pending_rect.w = w;
-              pending_rect.h = h;
-            }
-          else
-            {
-              if (x < pending_rect.x)
-                {
-                  pending_rect.w += pending_rect.x - x;
-                  pending_rect.x = x;
-                }
-              if (x + w > pending_rect.x + pending_rect.w)
-                {
-                  pending_rect.w = x + w - pending_rect.x;
-                }
-              if (y < pending_rect.y)
-                {
-                  pending_rect.h += pending_rect.y - y;
-                  pending_rect.y = y;
-                }
-              if (y + h > pending_rect.y + pending_rect.h)
-                {
-                  pending_rect.h = y + h - pending_rect.y;
-                }
-            }
+          add_pending_rect(pending_rects, &num_pending, x, y, w, h);
         }
       else
         {
-          pending_put = 0;
+          num_pending = 0;
           if (!XShmPutImage(display, drawable, gc, ximage,
                             x, y, x, y, w, h, 1))
             {
@@ -727,6 +856,7 @@ static int warn = 0;
     }
   if (alpha)
     free(alpha);
+  free(shape);
   [super dealloc];
 }
 
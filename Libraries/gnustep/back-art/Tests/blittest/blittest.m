@@ -0,0 +1,192 @@
+/*
+ * Compares SIMD blitters of back-art with the scalar versions.
+ *
+ * Both draw_info_t tables are set up for DI_32_RGBA and DI_32_BGRA, then
+ * every entry replaced by artcontext_setup_simd_draw_info() is run on the
+ * same random data with random lengths and (unaligned) offsets. Results
+ * must be identical and bytes past the end of the run must not be touched.
+ * Exits with non-zero status if any difference was found.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blit-main.m"
+#include "blit-simd.m"
+
+#define MAX_RUN 300
+#define GUARD 64
+#define BUF_SIZE ((MAX_RUN + GUARD) * 4 + 16)
+#define LOOPS 5000
+
+static int failures;
+
+static unsigned char random_byte(void)
+{
+  /* make boundary values frequent */
+  switch (random() % 8) {
+  case 0:
+    return 0;
+  case 1:
+    return 255;
+  default:
+    return random() & 0xff;
+  }
+}
+
+/* Pixels with premultiplied or arbitrary colors and frequent 0/255 alpha */
+static void fill_pixels(unsigned char *p, int n)
+{
+  int i, a;
+  int premultiplied = random() & 1;
+
+  for (i = 0; i < n; i++, p += 4) {
+    a = random_byte();
+    p[0] = premultiplied ? (random() & 0xff) * a / 255 : random_byte();
+    p[1] = premultiplied ? (random() & 0xff) * a / 255 : random_byte();
+    p[2] = premultiplied ? (random() & 0xff) * a / 255 : random_byte();
+    p[3] = a;
+  }
+}
+
+static void report(const char *format, const char *entry, int num,
+                   const unsigned char *expected, const unsigned char *got)
+{
+  int i;
+
+  for (i = 0; i < (num + GUARD) * 4; i++) {
+    if (expected[i] != got[i])
+      break;
+  }
+  printf("%s %s: num=%i differs at byte %i: expected %i, got %i\n", format,
+         entry, num, i, expected[i], got[i]);
+  failures++;
+}
+
+static void test_run(const char *format, const char *entry,
+                     void (*scalar)(render_run_t *, int),
+                     void (*simd)(render_run_t *, int))
+{
+  unsigned char b1[BUF_SIZE], b2[BUF_SIZE];
+  render_run_t ri;
+  int i, num, ofs;
+
+  for (i = 0; i < LOOPS; i++) {
+    num = random() % MAX_RUN;
+    ofs = random() % 4;
+    fill_pixels(b1, BUF_SIZE / 4);
+    memcpy(b2, b1, BUF_SIZE);
+
+    ri.r = random_byte();
+    ri.g = random_byte();
+    ri.b = random_byte();
+    ri.a = random_byte();
+    ri.dsta = NULL;
+
+    ri.dst = b1 + ofs;
+    scalar(&ri, num);
+    ri.dst = b2 + ofs;
+    simd(&ri, num);
+
+    if (memcmp(b1, b2, BUF_SIZE)) {
+      report(format, entry, num, b1 + ofs, b2 + ofs);
+      return;
+    }
+  }
+}
+
+static void test_composite(const char *format, const char *entry,
+                           void (*scalar)(composite_run_t *, int),
+                           void (*simd)(composite_run_t *, int))
+{
+  unsigned char src[BUF_SIZE], b1[BUF_SIZE], b2[BUF_SIZE];
+  composite_run_t c;
+  int i, num, ofs;
+
+  for (i = 0; i < LOOPS; i++) {
+    num = random() % MAX_RUN;
+    ofs = random() % 4;
+    fill_pixels(src, BUF_SIZE / 4);
+    fill_pixels(b1, BUF_SIZE / 4);
+    memcpy(b2, b1, BUF_SIZE);
+
+    memset(&c, 0, sizeof(c));
+    c.src = src + random() % 4;
+
+    c.dst = b1 + ofs;
+    scalar(&c, num);
+    c.dst = b2 + ofs;
+    simd(&c, num);
+
+    if (memcmp(b1, b2, BUF_SIZE)) {
+      report(format, entry, num, b1 + ofs, b2 + ofs);
+      return;
+    }
+  }
+}
+
+static void test_format(const char *format, int level, unsigned int red_mask,
+                        unsigned int green_mask, unsigned int blue_mask)
+{
+  draw_info_t scalar, simd;
+
+  artcontext_setup_simd(0);
+  artcontext_setup_draw_info(&scalar, red_mask, green_mask, blue_mask, 32);
+  simd_level = level;
+  artcontext_setup_draw_info(&simd, red_mask, green_mask, blue_mask, 32);
+
+  test_run(format, "run_alpha", scalar.render_run_alpha, simd.render_run_alpha);
+  test_run(format, "run_alpha_a", scalar.render_run_alpha_a,
+           simd.render_run_alpha_a);
+  test_composite(format, "sover_aa", scalar.composite_sover_aa,
+                 simd.composite_sover_aa);
+  test_composite(format, "sover_ao", scalar.composite_sover_ao,
+                 simd.composite_sover_ao);
+}
+
+int main(int argc, char **argv)
+{
+  union {
+    unsigned char b[4];
+    unsigned int m;
+  } r, g, b;
+  const char *simd;
+  int level, max_level;
+
+  simd = artcontext_setup_simd(1);
+  if (!simd) {
+    printf("blittest: no SIMD blitters for this CPU, nothing to test\n");
+    return 0;
+  }
+  max_level = simd_level;
+
+  srandom(argc > 1 ? atoi(argv[1]) : 1);
+  artcontext_setup_gamma(0);
+
+  /* AVX2 capable CPUs run SSE2 versions as well */
+  level = (max_level == SIMD_AVX2) ? SIMD_SSE2 : max_level;
+  for (; level <= max_level; level++) {
+    printf("blittest: testing %s blitters\n",
+           level == SIMD_SSE2 ? "SSE2" : (level == SIMD_AVX2 ? "AVX2" : simd));
+
+    /* masks are matched by byte offsets in memory */
+    memset(&r, 0, sizeof(r));
+    memset(&g, 0, sizeof(g));
+    memset(&b, 0, sizeof(b));
+    r.b[0] = g.b[1] = b.b[2] = 0xff;
+    test_format("rgba", level, r.m, g.m, b.m);
+
+    memset(&r, 0, sizeof(r));
+    memset(&b, 0, sizeof(b));
+    r.b[2] = b.b[0] = 0xff;
+    test_format("bgra", level, r.m, g.m, b.m);
+  }
+
+  if (failures) {
+    printf("blittest: %i failures\n", failures);
+    return 1;
+  }
+  printf("blittest: OK\n");
+  return 0;
+}
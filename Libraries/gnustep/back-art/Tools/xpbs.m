@@ -40,6 +40,8 @@
 #if HAVE_XFIXES
 #include <X11/extensions/Xfixes.h>
 #endif
+#include <unistd.h>
+#include <errno.h>
 
 /*
  *	Non-predefined atoms that are used in the X selection mechanism
@@ -139,6 +141,13 @@ static Atom atoms[sizeof(atom_names)/sizeof(char*)];
   Time		_timeOfLastAppend;
   Time		_timeOfSetSelectionOwner;
   BOOL		_ownedByOpenStep;
+  /* Incoming INCR transfer */
+  BOOL		_incrReceiving;
+  BOOL		_incrProgress;
+  Atom		_incrType;
+  NSMutableData	*_incrData;
+  int		_incrFd;
+  NSString	*_incrPath;
 }
 
 + (XPbOwner*) ownerByXPb: (Atom)p;
@@ -169,6 +178,10 @@ static Atom atoms[sizeof(atom_names)/sizeof(char*)];
 - (Time) timeOfLastAppend;
 - (Time) waitingForSelection;
 - (Atom) xPb;
+- (void) setSelectionData: (NSData*)md type: (Atom)actual_type;
+- (void) xIncrPropertyNotify: (XPropertyEvent*)xEvent;
+- (void) xIncrSpillFailed;
+- (void) xIncrFinish: (BOOL)success;
 - (void) xSelectionClear;
 - (void) xSelectionNotify: (XSelectionEvent*)xEvent;
 - (void) xSelectionRequest: (XSelectionRequestEvent*)xEvent;
@@ -190,6 +203,36 @@ static Atom atoms[sizeof(atom_names)/sizeof(char*)];
 }
 @end
 
+/*
+ * Outgoing INCR transfer. Data is sent to the requestor in chunks each
+ * time it deletes the property, as described in ICCCM section 2.7.2.
+ */
+@interface	XPbIncrSender : NSObject
+{
+@public
+  Window	_window;
+  Atom		_property;
+  Atom		_type;
+  int		_format;
+  unsigned char	*_data;
+  int		_numItems;
+  int		_pos;
+  NSDate	*_lastActivity;
+}
++ (unsigned long) chunkSize;
++ (BOOL) startWithData: (unsigned char*)data
+                format: (int)format
+                 items: (int)numItems
+                  type: (Atom)xType
+                    to: (Window)window
+              property: (Atom)property;
++ (BOOL) xPropertyNotify: (XPropertyEvent*)xEvent;
++ (void) xDestroyNotify: (XDestroyWindowEvent*)xEvent;
++ (void) purgeStaleSenders: (NSTimer*)timer;
++ (void) removeSender: (XPbIncrSender*)sender;
+- (BOOL) sendNextChunk;
+@end
+
 
 
 /*
@@ -202,6 +245,274 @@ static NSMapTable	*ownByX;
 static NSMapTable	*ownByO;
 static NSString		*xWaitMode = @"XPasteboardWaitMode";
 static int              xFixesEventBase;
+static NSMutableArray	*incrSenders;
+static NSTimer		*incrTimer;
+
+/*
+ * Incoming INCR data bigger than this is kept in a temporary file
+ * instead of memory.
+ */
+#define INCR_SPILL_SIZE (8 * 1024 * 1024)
+/* Upper limit of INCR chunk size */
+#define INCR_MAX_CHUNK (256 * 1024)
+/* Abandoned outgoing INCR transfers are dropped after this interval */
+#define INCR_TIMEOUT 60.0
+
+static BOOL appendFailure;
+static int
+xErrorHandler(Display *d, XErrorEvent *e)
+{
+  appendFailure = YES;
+  return 0;
+}
+
+/*
+ * Size of one item in memory. Xlib keeps format 32 data in longs.
+ */
+static inline int
+item_size(int format)
+{
+  return (format == 32) ? sizeof(long) : format / 8;
+}
+
+static BOOL
+write_all(int fd, const void *bytes, size_t length)
+{
+  const char	*p = bytes;
+
+  while (length > 0)
+    {
+      ssize_t	n = write(fd, p, length);
+
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return NO;
+        }
+      p += n;
+      length -= n;
+    }
+  return YES;
+}
+
+@implementation	XPbIncrSender
+
++ (unsigned long) chunkSize
+{
+  static unsigned long	size = 0;
+
+  if (size == 0)
+    {
+      /* Request sizes are in 4-byte units; leave room for request header */
+      long	max = XExtendedMaxRequestSize(xDisplay);
+
+      if (max == 0)
+        max = XMaxRequestSize(xDisplay);
+      size = max * 4 - 100;
+      if (size > INCR_MAX_CHUNK)
+        size = INCR_MAX_CHUNK;
+    }
+  return size;
+}
+
++ (BOOL) startWithData: (unsigned char*)data
+                format: (int)format
+                 items: (int)numItems
+                  type: (Atom)xType
+                    to: (Window)window
+              property: (Atom)property
+{
+  XPbIncrSender	*sender;
+  long		size;
+  int		(*oldHandler)(Display*, XErrorEvent*);
+
+  if (incrSenders == nil)
+    incrSenders = [NSMutableArray new];
+
+  sender = [XPbIncrSender new];
+  sender->_window = window;
+  sender->_property = property;
+  sender->_type = xType;
+  sender->_format = format;
+  sender->_data = data;
+  sender->_numItems = numItems;
+  sender->_pos = 0;
+  sender->_lastActivity = RETAIN([NSDate date]);
+
+  /* We need PropertyDelete notifications from the requestor window and
+     DestroyNotify to drop the transfer if requestor goes away */
+  appendFailure = NO;
+  oldHandler = XSetErrorHandler(xErrorHandler);
+  XSelectInput(xDisplay, window, PropertyChangeMask | StructureNotifyMask);
+  /* Lower bound of the data size in bytes */
+  size = (long)numItems * format / 8;
+  XChangeProperty(xDisplay, window, property, XG_INCR, 32, PropModeReplace,
+                  (unsigned char*)&size, 1);
+  XSync(xDisplay, False);
+  XSetErrorHandler(oldHandler);
+
+  if (appendFailure == YES)
+    {
+      RELEASE(sender);
+      return NO;
+    }
+
+  NSDebugLLog(@"Pbs", @"INCR transfer of %ld bytes to %lu started.",
+              size, window);
+  [incrSenders addObject: sender];
+  RELEASE(sender);
+
+  /* Requestor which stopped deleting the property without destroying
+     its window */
+  if (incrTimer == nil)
+    {
+      incrTimer = [NSTimer scheduledTimerWithTimeInterval: INCR_TIMEOUT
+                                                   target: self
+                                                 selector: @selector(purgeStaleSenders:)
+                                                 userInfo: nil
+                                                  repeats: YES];
+    }
+  return YES;
+}
+
++ (BOOL) xPropertyNotify: (XPropertyEvent*)xEvent
+{
+  NSEnumerator	*e;
+  XPbIncrSender	*sender;
+
+  if (xEvent->state != PropertyDelete || incrSenders == nil)
+    return NO;
+
+  e = [incrSenders objectEnumerator];
+  while ((sender = [e nextObject]) != nil)
+    {
+      if (sender->_window == xEvent->window
+          && sender->_property == xEvent->atom)
+        {
+          if ([sender sendNextChunk] == NO)
+            {
+              [self removeSender: sender];
+            }
+          return YES;
+        }
+    }
+  return NO;
+}
+
++ (void) xDestroyNotify: (XDestroyWindowEvent*)xEvent
+{
+  NSEnumerator	*e;
+  XPbIncrSender	*sender;
+
+  e = [[NSArray arrayWithArray: incrSenders] objectEnumerator];
+  while ((sender = [e nextObject]) != nil)
+    {
+      if (sender->_window == xEvent->window)
+        {
+          NSDebugLLog(@"Pbs", @"INCR requestor %lu destroyed.", sender->_window);
+          /* Window is gone, no input to deselect */
+          [incrSenders removeObject: sender];
+        }
+    }
+  if ([incrSenders count] == 0)
+    {
+      [incrTimer invalidate];
+      incrTimer = nil;
+    }
+}
+
+/* Drop transfers with requestors which stopped reading */
++ (void) purgeStaleSenders: (NSTimer*)timer
+{
+  NSEnumerator	*e;
+  XPbIncrSender	*sender;
+
+  e = [[NSArray arrayWithArray: incrSenders] objectEnumerator];
+  while ((sender = [e nextObject]) != nil)
+    {
+      if ([sender->_lastActivity timeIntervalSinceNow] < -INCR_TIMEOUT)
+        {
+          NSDebugLLog(@"Pbs", @"INCR transfer to %lu timed out.", sender->_window);
+          [self removeSender: sender];
+        }
+    }
+}
+
++ (void) removeSender: (XPbIncrSender*)sender
+{
+  NSEnumerator	*e;
+  XPbIncrSender	*other;
+  int		(*oldHandler)(Display*, XErrorEvent*);
+
+  RETAIN(sender);
+  [incrSenders removeObject: sender];
+
+  /* Keep events selected while other transfers go to the same window */
+  e = [incrSenders objectEnumerator];
+  while ((other = [e nextObject]) != nil)
+    {
+      if (other->_window == sender->_window)
+        break;
+    }
+  if (other == nil)
+    {
+      /* Requestor window may be destroyed already */
+      oldHandler = XSetErrorHandler(xErrorHandler);
+      XSelectInput(xDisplay, sender->_window, NoEventMask);
+      XSync(xDisplay, False);
+      XSetErrorHandler(oldHandler);
+    }
+  RELEASE(sender);
+
+  if ([incrSenders count] == 0)
+    {
+      [incrTimer invalidate];
+      incrTimer = nil;
+    }
+}
+
+/*
+ * Appends the next chunk to the property. Returns NO when the transfer
+ * is finished (zero-length property was written) or failed.
+ */
+- (BOOL) sendNextChunk
+{
+  int	(*oldHandler)(Display*, XErrorEvent*);
+  int	count = [XPbIncrSender chunkSize] * 8 / _format;
+  BOOL	done = NO;
+
+  if (_pos + count > _numItems)
+    {
+      count = _numItems - _pos;
+    }
+
+  appendFailure = NO;
+  oldHandler = XSetErrorHandler(xErrorHandler);
+  XChangeProperty(xDisplay, _window, _property, _type, _format,
+                  PropModeReplace, &_data[_pos * item_size(_format)], count);
+  XSync(xDisplay, False);
+  XSetErrorHandler(oldHandler);
+
+  if (count == 0)
+    {
+      NSDebugLLog(@"Pbs", @"INCR transfer to %lu finished.", _window);
+      done = YES;
+    }
+  _pos += count;
+  ASSIGN(_lastActivity, [NSDate date]);
+
+  return (done == NO && appendFailure == NO);
+}
+
+- (void) dealloc
+{
+  free(_data);
+  RELEASE(_lastActivity);
+  [super dealloc];
+}
+
+@end
 
 @implementation	XPbOwner
 
@@ -415,6 +726,11 @@ static int              xFixesEventBase;
       [self xSelectionRequest: &xEvent->xselectionrequest];
       break;
 
+    case DestroyNotify:
+      NSDebugLLog(@"Pbs", @"DestroyNotify.");
+      [XPbIncrSender xDestroyNotify: &xEvent->xdestroywindow];
+      break;
+
     default:
 #if HAVE_XFIXES
       if (xEvent->type == xFixesEventBase + XFixesSelectionNotify)
@@ -457,6 +773,11 @@ static int              xFixesEventBase;
 {
   XPbOwner	*o;
 
+  if ([XPbIncrSender xPropertyNotify: xEvent])
+    {
+      return;
+    }
+
   o = [self ownerByXPb: xEvent->atom];
   if (o == nil)
     {
@@ -473,6 +794,12 @@ static int              xFixesEventBase;
       return;
     }
 
+  if (o->_incrReceiving && xEvent->state == PropertyNewValue)
+    {
+      [o xIncrPropertyNotify: xEvent];
+      return;
+    }
+
   if (xEvent->time != 0)
     {
       [o setTimeOfLastAppend: xEvent->time];
@@ -575,6 +902,7 @@ static int              xFixesEventBase;
 
 - (void) dealloc
 {
+  [self xIncrFinish: NO];
   RELEASE(_pb);
   RELEASE(_obj);
   /*
@@ -590,6 +918,7 @@ static int              xFixesEventBase;
   _pb = RETAIN(o);
   _name = [_pb name];
   _xPb = x;
+  _incrFd = -1;
   /*
    * Add self to map of all X pasteboard owners.
    */
@@ -685,13 +1014,23 @@ static int              xFixesEventBase;
           [[NSRunLoop currentRunLoop] runMode: xWaitMode
                                       beforeDate: limit];
           if ([limit timeIntervalSinceNow] <= 0.0)
-            break;	/* Timeout */
+            {
+              /* Large INCR transfers may take long - wait while they progress */
+              if (_incrReceiving && _incrProgress)
+                {
+                  _incrProgress = NO;
+                  limit = [NSDate dateWithTimeIntervalSinceNow: 20.0];
+                  continue;
+                }
+              break;	/* Timeout */
+            }
         }
       if ([self waitingForSelection] != 0)
         {
           char *name = XGetAtomName(xDisplay, xType);
 
           [self setWaitingForSelection: 0];
+          [self xIncrFinish: NO];
           NSLog(@"Timed out waiting for X selection '%s'", name);
           XFree(name);
         }
@@ -775,14 +1114,6 @@ static int              xFixesEventBase;
   return _xPb;
 }
 
-static BOOL appendFailure;
-static int
-xErrorHandler(Display *d, XErrorEvent *e)
-{
-  appendFailure = YES;
-  return 0;
-}
-
 /*
  * Check to see what types of data the selection owner is
  * making available, and declare them all.
@@ -876,8 +1207,10 @@ xErrorHandler(Display *d, XErrorEvent *e)
   [self setOwnedByOpenStep: NO];
 }
 
-- (NSMutableData*) getSelectionData: (XSelectionEvent*)xEvent
+- (NSMutableData*) getSelectionData: (Window)window
+                           property: (Atom)property
                                type: (Atom*)type
+                             delete: (BOOL)delete
 {
   int		status;
   unsigned char	*data;
@@ -895,12 +1228,16 @@ xErrorHandler(Display *d, XErrorEvent *e)
    */
   do
     {
+      /*
+       * Property is deleted only by INCR transfers - it signals the owner
+       * to send the next chunk. X server deletes it after the last read.
+       */
       status = XGetWindowProperty(xDisplay,
-                                  xEvent->requestor,
-                                  xEvent->property,
+                                  window,
+                                  property,
                                   long_offset,         // offset
                                   long_length,
-                                  False,               // Aug 2011 - changed to False (don't delete property)
+                                  delete ? True : False,
                                   req_type,
                                   &actual_type,
                                   &actual_format,
@@ -983,124 +1320,231 @@ xErrorHandler(Display *d, XErrorEvent *e)
       NSDebugLLog(@"Pbs", @"Unexpected selection notify - time %lu.", xEvent->time);
       return;
     }
-  [self setWaitingForSelection: 0];
 
-  md = [self getSelectionData: xEvent type: &actual_type];
+  md = [self getSelectionData: xEvent->requestor
+                     property: xEvent->property
+                         type: &actual_type
+                       delete: NO];
 
+  if (md != nil && actual_type == XG_INCR)
+    {
+      /*
+       * Owner sends data in chunks. Deleting the property starts the
+       * transfer, chunks are collected in -xIncrPropertyNotify:.
+       * Keep waiting for selection until zero-length chunk arrives.
+       */
+      [self xIncrFinish: NO];
+      _incrReceiving = YES;
+      _incrProgress = YES;
+      _incrType = None;
+      _incrData = [NSMutableData new];
+      XDeleteProperty(xDisplay, xEvent->requestor, xEvent->property);
+      XFlush(xDisplay);
+      return;
+    }
+
+  [self setWaitingForSelection: 0];
   if (md != nil)
     {
-      if (actual_type == XG_INCR)
+      [self setSelectionData: md type: actual_type];
+    }
+}
+
+- (void) xIncrPropertyNotify: (XPropertyEvent*)xEvent
+{
+  NSMutableData	*md;
+  Atom		actual_type;
+
+  md = [self getSelectionData: xEvent->window
+                     property: xEvent->atom
+                         type: &actual_type
+                       delete: YES];
+  _incrProgress = YES;
+
+  if (md == nil || [md length] == 0)
+    {
+      /* Zero-length chunk marks the end of transfer */
+      [self xIncrFinish: (md != nil)];
+      return;
+    }
+
+  if (_incrType == None)
+    {
+      _incrType = actual_type;
+    }
+  else if (_incrType != actual_type)
+    {
+      NSLog(@"INCR selection transfer changed type - aborted.");
+      [self setWaitingForSelection: 0];
+      [self xIncrFinish: NO];
+      return;
+    }
+
+  /* Keep big transfers out of memory */
+  if (_incrFd < 0 && [_incrData length] + [md length] > INCR_SPILL_SIZE)
+    {
+      NSString	*template;
+      char	*path;
+
+      template = [NSTemporaryDirectory()
+                   stringByAppendingPathComponent: @"xpbs.XXXXXX"];
+      path = strdup([template fileSystemRepresentation]);
+      _incrFd = mkstemp(path);
+      if (_incrFd >= 0)
         {
-          XEvent event;
-          NSMutableData	*imd = nil;
-          BOOL wait = YES;
-          
-          md = nil;
-          while (wait)
+          _incrPath = RETAIN([[NSFileManager defaultManager]
+                      stringWithFileSystemRepresentation: path
+                                                  length: strlen(path)]);
+          if (write_all(_incrFd, [_incrData bytes], [_incrData length]) == NO)
             {
-              XNextEvent(xDisplay, &event);
-              
-              if (event.type == PropertyNotify)
-                {
-                  if (event.xproperty.state != PropertyNewValue) continue;
-                  
-                  imd = [self getSelectionData: xEvent type: &actual_type];
-                  if (imd != nil)
-                    {
-                      if (md == nil)
-                        {
-                          md = imd;
-                        }
-                      else
-                        {
-                          [md appendData: imd];
-                        }
-                    }
-                  else
-                    {
-                      wait = NO;
-                    }
-                }
+              [self xIncrSpillFailed];
+              free(path);
+              return;
             }
+          [_incrData setLength: 0];
         }
+      free(path);
     }
-  
-  if (md != nil)
+
+  if (_incrFd >= 0)
     {
-      // Convert data to text string.
-      if (actual_type == XG_UTF8_STRING)
+      if (write_all(_incrFd, [md bytes], [md length]) == NO)
         {
-          NSString	*s;
-          NSData	*d;
-          
-          s = [[NSString alloc] initWithData: md
-                                encoding: NSUTF8StringEncoding];
-          if (s != nil)
-            {
-              d = [NSSerializer serializePropertyList: s];
-              RELEASE(s);
-              [self setData: d];
-            }
+          [self xIncrSpillFailed];
         }
-      else if ((actual_type == XA_STRING)
-               || (actual_type == XG_TEXT)
-               || (actual_type == XG_MIME_PLAIN))
+    }
+  else
+    {
+      [_incrData appendData: md];
+    }
+}
+
+- (void) xIncrSpillFailed
+{
+  NSLog(@"Failed to write INCR selection data to '%@' - aborted.", _incrPath);
+  [self setWaitingForSelection: 0];
+  [self xIncrFinish: NO];
+}
+
+- (void) xIncrFinish: (BOOL)success
+{
+  NSData	*md = nil;
+  Atom		type = _incrType;
+
+  if (_incrReceiving == NO)
+    {
+      return;
+    }
+  _incrReceiving = NO;
+
+  if (success == YES && type != None)
+    {
+      if (_incrFd >= 0)
         {
-          NSString	*s;
-          NSData	*d;
-          
-          s = [[NSString alloc] initWithData: md
-                                encoding: NSISOLatin1StringEncoding];
-          if (s != nil)
-            {
-              d = [NSSerializer serializePropertyList: s];
-              RELEASE(s);
-              [self setData: d];
-            }
+          md = [NSData dataWithContentsOfMappedFile: _incrPath];
         }
-      else if (actual_type == XG_FILE_NAME)
+      else
         {
-          NSArray *names;
-          NSData *d;
-          NSString *s;
-          NSURL *url;
-
-          s = [[NSString alloc] initWithData: md
-                                encoding: NSUTF8StringEncoding];
-          url = [[NSURL alloc] initWithString: s];
-          RELEASE(s);
-          if ([url isFileURL])
-            {
-              s = [url path];
-              names = [NSArray arrayWithObject: s];
-              d = [NSSerializer serializePropertyList: names];
-              [self setData: d];
-            }
-          RELEASE(url);
+          md = AUTORELEASE(RETAIN(_incrData));
         }
-      else if ((actual_type == XG_MIME_RTF)
-               || (actual_type == XG_MIME_APP_RTF)
-	       || (actual_type == XG_MIME_TEXT_RICHTEXT))
+    }
+
+  if (_incrFd >= 0)
+    {
+      close(_incrFd);
+      _incrFd = -1;
+      /* Mapping stays valid after unlink */
+      unlink([_incrPath fileSystemRepresentation]);
+      DESTROY(_incrPath);
+    }
+  DESTROY(_incrData);
+  _incrType = None;
+
+  if (success == YES)
+    {
+      [self setWaitingForSelection: 0];
+      if (md != nil)
         {
-          [self setData: md];
+          [self setSelectionData: md type: type];
         }
-      else if (actual_type == XG_MIME_TIFF)
+    }
+}
+
+- (void) setSelectionData: (NSData*)md type: (Atom)actual_type
+{
+  // Convert data to text string.
+  if (actual_type == XG_UTF8_STRING)
+    {
+      NSString	*s;
+      NSData	*d;
+      
+      s = [[NSString alloc] initWithData: md
+                            encoding: NSUTF8StringEncoding];
+      if (s != nil)
         {
-          [self setData: md];
+          d = [NSSerializer serializePropertyList: s];
+          RELEASE(s);
+          [self setData: d];
         }
-      else if (actual_type == XA_ATOM)
+    }
+  else if ((actual_type == XA_STRING)
+           || (actual_type == XG_TEXT)
+           || (actual_type == XG_MIME_PLAIN))
+    {
+      NSString	*s;
+      NSData	*d;
+      
+      s = [[NSString alloc] initWithData: md
+                            encoding: NSISOLatin1StringEncoding];
+      if (s != nil)
         {
-          // Used when requesting TARGETS to get available types
-          [self setData: md];
+          d = [NSSerializer serializePropertyList: s];
+          RELEASE(s);
+          [self setData: d];
         }
-      else
+    }
+  else if (actual_type == XG_FILE_NAME)
+    {
+      NSArray *names;
+      NSData *d;
+      NSString *s;
+      NSURL *url;
+
+      s = [[NSString alloc] initWithData: md
+                            encoding: NSUTF8StringEncoding];
+      url = [[NSURL alloc] initWithString: s];
+      RELEASE(s);
+      if ([url isFileURL])
         {
-          char *name = XGetAtomName(xDisplay, actual_type);
-          
-          NSDebugLLog(@"Pbs", @"Unsupported data type '%s' from X selection.", 
-                      name);
-          XFree(name);
+          s = [url path];
+          names = [NSArray arrayWithObject: s];
+          d = [NSSerializer serializePropertyList: names];
+          [self setData: d];
         }
+      RELEASE(url);
+    }
+  else if ((actual_type == XG_MIME_RTF)
+           || (actual_type == XG_MIME_APP_RTF)
+           || (actual_type == XG_MIME_TEXT_RICHTEXT))
+    {
+      [self setData: md];
+    }
+  else if (actual_type == XG_MIME_TIFF)
+    {
+      [self setData: md];
+    }
+  else if (actual_type == XA_ATOM)
+    {
+      // Used when requesting TARGETS to get available types
+      [self setData: md];
+    }
+  else
+    {
+      char *name = XGetAtomName(xDisplay, actual_type);
+      
+      NSDebugLLog(@"Pbs", @"Unsupported data type '%s' from X selection.", 
+                  name);
+      XFree(name);
     }
 }
 
@@ -1469,33 +1913,31 @@ xErrorHandler(Display *d, XErrorEvent *e)
   
   /*
    * If we have managed to convert data of the appropritate type, we must now
-   * append the data to the property on the requesting window.
-   * We do this in small chunks, checking for errors, in case the window
-   * manager puts a limit on the data size we can use.
+   * store the data in the property on the requesting window.
+   * Data which doesn't fit into a single request is sent with INCR
+   * protocol - requestor deletes the property to ask for the next chunk.
    * This is not thread-safe - but I think that's a general problem with X.
    */
   if (data != 0 && numItems != 0 && format != 0)
     {
       int	(*oldHandler)(Display*, XErrorEvent*);
-      int	mode = PropModeReplace;
-      int	pos = 0;
-      int	maxItems = 4096 * 8 / format;
 
-      appendFailure = NO;
-      oldHandler = XSetErrorHandler(xErrorHandler);
-
-      while (appendFailure == NO && pos < numItems)
+      if ((unsigned long)numItems * format / 8 > [XPbIncrSender chunkSize])
         {
-          if (pos + maxItems > numItems)
-            {
-              maxItems = numItems - pos;
-            }
-          XChangeProperty(xDisplay, window, property,
-                          xType, format, mode, &data[pos*format/8], maxItems);
-          mode = PropModeAppend;
-          pos += maxItems;
-          XSync(xDisplay, False);
+          /* Sender takes ownership of data */
+          return [XPbIncrSender startWithData: data
+                                       format: format
+                                        items: numItems
+                                         type: xType
+                                           to: window
+                                     property: property];
         }
+
+      appendFailure = NO;
+      oldHandler = XSetErrorHandler(xErrorHandler);
+      XChangeProperty(xDisplay, window, property,
+                      xType, format, PropModeReplace, data, numItems);
+      XSync(xDisplay, False);
       free(data);
       XSetErrorHandler(oldHandler);
       if (appendFailure == NO)
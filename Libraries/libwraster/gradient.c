@@ -85,6 +85,119 @@ RImage *RRenderGradient(unsigned width, unsigned height, const RColor *from, con
   return NULL;
 }
 
+/*
+ * Span generators.
+ *
+ * Every gradient row is built from two kinds of spans: solid span (one color)
+ * and linear span (color interpolated in 16.16 fixed point). Solid span is
+ * filled by doubling the already written part with memcpy(), so long spans are
+ * written with wide stores of memcpy() instead of 3 byte stores per pixel.
+ * Linear span computes every pixel from its index - the loop has no carried
+ * dependency and may be vectorized by compiler.
+ */
+static inline unsigned char *renderSolidSpan(unsigned char *ptr, unsigned width, unsigned char r,
+                                             unsigned char g, unsigned char b)
+{
+  unsigned size = width * 3;
+  unsigned done;
+  unsigned i;
+
+  /* short head is written directly, memcpy() is not worth it there */
+  for (i = 0; i < width && i < 16; i++) {
+    ptr[3 * i] = r;
+    ptr[3 * i + 1] = g;
+    ptr[3 * i + 2] = b;
+  }
+  for (done = i * 3; done < size; done *= 2) {
+    memcpy(ptr + done, ptr, (size - done < done) ? size - done : done);
+  }
+
+  return ptr + size;
+}
+
+static inline unsigned char *renderLinearSpan(unsigned char *ptr, unsigned width, long r, long g,
+                                              long b, long dr, long dg, long db)
+{
+  unsigned i;
+
+  for (i = 0; i < width; i++) {
+    ptr[3 * i] = (unsigned char)((r + (long)i * dr) >> 16);
+    ptr[3 * i + 1] = (unsigned char)((g + (long)i * dg) >> 16);
+    ptr[3 * i + 2] = (unsigned char)((b + (long)i * db) >> 16);
+  }
+
+  return ptr + width * 3;
+}
+
+/* Renders a line of multicolor gradient: `count` colors evenly distributed on `width`. */
+static void renderMultiColorLine(unsigned char *ptr, unsigned width, RColor **colors, int count)
+{
+  int i;
+  long dr, dg, db;
+  unsigned width2;
+  unsigned k = 0;
+
+  if (count > width)
+    count = width;
+
+  if (count > 1)
+    width2 = width / (count - 1);
+  else
+    width2 = width;
+
+  for (i = 1; i < count; i++) {
+    dr = ((int)(colors[i]->red - colors[i - 1]->red) << 16) / (int)width2;
+    dg = ((int)(colors[i]->green - colors[i - 1]->green) << 16) / (int)width2;
+    db = ((int)(colors[i]->blue - colors[i - 1]->blue) << 16) / (int)width2;
+    ptr = renderLinearSpan(ptr, width2, colors[i - 1]->red << 16, colors[i - 1]->green << 16,
+                           colors[i - 1]->blue << 16, dr, dg, db);
+    k += width2;
+  }
+  renderSolidSpan(ptr, width - k, colors[count - 1]->red, colors[count - 1]->green,
+                  colors[count - 1]->blue);
+}
+
+/* Copies the first line of `image` to all other lines. */
+static void replicateFirstLine(RImage *image)
+{
+  unsigned lineSize = image->width * 3;
+  unsigned char *ptr = image->data + lineSize;
+  unsigned i;
+
+  for (i = 1; i < image->height; i++) {
+    memcpy(ptr, image->data, lineSize);
+    ptr += lineSize;
+  }
+}
+
+/*
+ * Builds diagonal gradient from a horizontal gradient `line` of 2 * width - 1
+ * pixels: every row of diagonal gradient is a window into `line` shifted
+ * proportionally to the row number.
+ */
+static RImage *renderDiagonalFromLine(unsigned width, unsigned height, const unsigned char *line)
+{
+  RImage *image;
+  unsigned char *ptr;
+  unsigned lineSize = width * 3;
+  unsigned long offset;
+  unsigned j;
+
+  image = RCreateImage(width, height, False);
+  if (!image) {
+    return NULL;
+  }
+  ptr = image->data;
+
+  for (j = 0; j < height; j++) {
+    offset = ((unsigned long)j * (width - 1)) / (height - 1);
+    memcpy(ptr, &line[3 * offset], lineSize);
+    ptr += lineSize;
+  }
+
+  return image;
+}
+
 /*
  *----------------------------------------------------------------------
  * renderHGradient--
@@ -101,82 +214,23 @@ RImage *RRenderGradient(unsigned width, unsigned height, const RColor *from, con
 static RImage *renderHGradient(unsigned width, unsigned height, int r0, int g0, int b0, int rf,
                                int gf, int bf)
 {
-  int i;
-  long r, g, b, dr, dg, db;
-  unsigned lineSize = width * 3;
+  long dr, dg, db;
   RImage *image;
-  unsigned char *ptr;
 
   image = RCreateImage(width, height, False);
   if (!image) {
     return NULL;
   }
-  ptr = image->data;
-
-  r = r0 << 16;
-  g = g0 << 16;
-  b = b0 << 16;
 
   dr = ((rf - r0) << 16) / (int)width;
   dg = ((gf - g0) << 16) / (int)width;
   db = ((bf - b0) << 16) / (int)width;
-  /* render the first line */
-  for (i = 0; i < width; i++) {
-    *(ptr++) = (unsigned char)(r >> 16);
-    *(ptr++) = (unsigned char)(g >> 16);
-    *(ptr++) = (unsigned char)(b >> 16);
-    r += dr;
-    g += dg;
-    b += db;
-  }
-
-  /* copy the first line to the other lines */
-  for (i = 1; i < height; i++) {
-    memcpy(&(image->data[i * lineSize]), image->data, lineSize);
-  }
-  return image;
-}
-
-static inline unsigned char *renderGradientWidth(unsigned char *ptr, unsigned width,
-                                                 unsigned char r, unsigned char g, unsigned char b)
-{
-  int i;
-
-  for (i = width / 4; i--;) {
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
 
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
+  /* render the first line and copy it to the other lines */
+  renderLinearSpan(image->data, width, r0 << 16, g0 << 16, b0 << 16, dr, dg, db);
+  replicateFirstLine(image);
 
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
-
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
-  }
-  switch (width % 4) {
-    case 3:
-      *ptr++ = r;
-      *ptr++ = g;
-      *ptr++ = b;
-      /* FALLTHRU */
-    case 2:
-      *ptr++ = r;
-      *ptr++ = g;
-      *ptr++ = b;
-      /* FALLTHRU */
-    case 1:
-      *ptr++ = r;
-      *ptr++ = g;
-      *ptr++ = b;
-      /* FALLTHRU */
-  }
-  return ptr;
+  return image;
 }
 
 /*
@@ -197,6 +251,7 @@ static RImage *renderVGradient(unsigned width, unsigned height, int r0, int g0,
 {
   int i;
   long r, g, b, dr, dg, db;
+  unsigned lineSize = width * 3;
   RImage *image;
   unsigned char *ptr;
 
@@ -215,7 +270,14 @@ static RImage *renderVGradient(unsigned width, unsigned height, int r0, int g0,
   db = ((bf - b0) << 16) / (int)height;
 
   for (i = 0; i < height; i++) {
-    ptr = renderGradientWidth(ptr, width, r >> 16, g >> 16, b >> 16);
+    /* neighbour rows often have the same color - reuse previous row */
+    if (i > 0 && (r >> 16) == ((r - dr) >> 16) && (g >> 16) == ((g - dg) >> 16) &&
+        (b >> 16) == ((b - db) >> 16)) {
+      memcpy(ptr, ptr - lineSize, lineSize);
+      ptr += lineSize;
+    } else {
+      ptr = renderSolidSpan(ptr, width, r >> 16, g >> 16, b >> 16);
+    }
     r += dr;
     g += dg;
     b += db;
@@ -240,50 +302,35 @@ static RImage *renderVGradient(unsigned width, unsigned height, int r0, int g0,
 static RImage *renderDGradient(unsigned width, unsigned height, int r0, int g0, int b0, int rf,
                                int gf, int bf)
 {
-  RImage *image, *tmp;
-  int j;
-  float a, offset;
-  unsigned char *ptr;
+  RImage *image;
+  unsigned char *line;
+  unsigned lineWidth;
 
   if (width == 1)
     return renderVGradient(width, height, r0, g0, b0, rf, gf, bf);
   else if (height == 1)
     return renderHGradient(width, height, r0, g0, b0, rf, gf, bf);
 
-  image = RCreateImage(width, height, False);
-  if (!image) {
-    return NULL;
-  }
-
-  tmp = renderHGradient(2 * width - 1, 1, r0, g0, b0, rf, gf, bf);
-  if (!tmp) {
-    RReleaseImage(image);
+  lineWidth = 2 * width - 1;
+  line = malloc(lineWidth * 3);
+  if (!line) {
+    RErrorCode = RERR_NOMEMORY;
     return NULL;
   }
 
-  ptr = tmp->data;
+  renderLinearSpan(line, lineWidth, r0 << 16, g0 << 16, b0 << 16,
+                   ((rf - r0) << 16) / (int)lineWidth, ((gf - g0) << 16) / (int)lineWidth,
+                   ((bf - b0) << 16) / (int)lineWidth);
 
-  a = ((float)(width - 1)) / ((float)(height - 1));
-  width = width * 3;
+  image = renderDiagonalFromLine(width, height, line);
 
-  /* copy the first line to the other lines with corresponding offset */
-  for (j = 0, offset = 0.0; j < width * height; j += width) {
-    memcpy(&(image->data[j]), &ptr[3 * (int)offset], width);
-    offset += a;
-  }
-
-  RReleaseImage(tmp);
+  free(line);
   return image;
 }
 
 static RImage *renderMHGradient(unsigned width, unsigned height, RColor **colors, int count)
 {
-  int i, j, k;
-  long r, g, b, dr, dg, db;
-  unsigned lineSize = width * 3;
   RImage *image;
-  unsigned char *ptr;
-  unsigned width2;
 
   assert(count > 2);
 
@@ -291,50 +338,11 @@ static RImage *renderMHGradient(unsigned width, unsigned height, RColor **colors
   if (!image) {
     return NULL;
   }
-  ptr = image->data;
 
-  if (count > width)
-    count = width;
+  /* render the first line and copy it to the other lines */
+  renderMultiColorLine(image->data, width, colors, count);
+  replicateFirstLine(image);
 
-  if (count > 1)
-    width2 = width / (count - 1);
-  else
-    width2 = width;
-
-  k = 0;
-
-  r = colors[0]->red << 16;
-  g = colors[0]->green << 16;
-  b = colors[0]->blue << 16;
-
-  /* render the first line */
-  for (i = 1; i < count; i++) {
-    dr = ((int)(colors[i]->red - colors[i - 1]->red) << 16) / (int)width2;
-    dg = ((int)(colors[i]->green - colors[i - 1]->green) << 16) / (int)width2;
-    db = ((int)(colors[i]->blue - colors[i - 1]->blue) << 16) / (int)width2;
-    for (j = 0; j < width2; j++) {
-      *ptr++ = (unsigned char)(r >> 16);
-      *ptr++ = (unsigned char)(g >> 16);
-      *ptr++ = (unsigned char)(b >> 16);
-      r += dr;
-      g += dg;
-      b += db;
-      k++;
-    }
-    r = colors[i]->red << 16;
-    g = colors[i]->green << 16;
-    b = colors[i]->blue << 16;
-  }
-  for (j = k; j < width; j++) {
-    *ptr++ = (unsigned char)(r >> 16);
-    *ptr++ = (unsigned char)(g >> 16);
-    *ptr++ = (unsigned char)(b >> 16);
-  }
-
-  /* copy the first line to the other lines */
-  for (i = 1; i < height; i++) {
-    memcpy(&(image->data[i * lineSize]), image->data, lineSize);
-  }
   return image;
 }
 
@@ -375,7 +383,7 @@ static RImage *renderMVGradient(unsigned width, unsigned height, RColor **colors
     db = ((int)(colors[i]->blue - colors[i - 1]->blue) << 16) / (int)height2;
 
     for (j = 0; j < height2; j++) {
-      ptr = renderGradientWidth(ptr, width, r >> 16, g >> 16, b >> 16);
+      ptr = renderSolidSpan(ptr, width, r >> 16, g >> 16, b >> 16);
       r += dr;
       g += dg;
       b += db;
@@ -388,7 +396,7 @@ static RImage *renderMVGradient(unsigned width, unsigned height, RColor **colors
 
   if (k < height) {
     tmp = ptr;
-    ptr = renderGradientWidth(ptr, width, r >> 16, g >> 16, b >> 16);
+    ptr = renderSolidSpan(ptr, width, r >> 16, g >> 16, b >> 16);
     for (j = k + 1; j < height; j++) {
       memcpy(ptr, tmp, lineSize);
       ptr += lineSize;
@@ -400,10 +408,9 @@ static RImage *renderMVGradient(unsigned width, unsigned height, RColor **colors
 
 static RImage *renderMDGradient(unsigned width, unsigned height, RColor **colors, int count)
 {
-  RImage *image, *tmp;
-  float a, offset;
-  int j;
-  unsigned char *ptr;
+  RImage *image;
+  unsigned char *line;
+  unsigned lineWidth;
 
   assert(count > 2);
 
@@ -412,38 +419,23 @@ static RImage *renderMDGradient(unsigned width, unsigned height, RColor **colors
   else if (height == 1)
     return renderMHGradient(width, height, colors, count);
 
-  image = RCreateImage(width, height, False);
-  if (!image) {
-    return NULL;
-  }
-
   if (count > width)
     count = width;
   if (count > height)
     count = height;
 
-  if (count > 2)
-    tmp = renderMHGradient(2 * width - 1, 1, colors, count);
-  else
-    tmp = renderHGradient(2 * width - 1, 1, colors[0]->red << 8, colors[0]->green << 8,
-                          colors[0]->blue << 8, colors[1]->red << 8, colors[1]->green << 8,
-                          colors[1]->blue << 8);
-
-  if (!tmp) {
-    RReleaseImage(image);
+  lineWidth = 2 * width - 1;
+  line = malloc(lineWidth * 3);
+  if (!line) {
+    RErrorCode = RERR_NOMEMORY;
     return NULL;
   }
-  ptr = tmp->data;
 
-  a = ((float)(width - 1)) / ((float)(height - 1));
-  width = width * 3;
+  renderMultiColorLine(line, lineWidth, colors, count);
 
-  /* copy the first line to the other lines with corresponding offset */
-  for (j = 0, offset = 0; j < width * height; j += width) {
-    memcpy(&(image->data[j]), &ptr[3 * (int)offset], width);
-    offset += a;
-  }
-  RReleaseImage(tmp);
+  image = renderDiagonalFromLine(width, height, line);
+
+  free(line);
   return image;
 }
 
@@ -480,9 +472,9 @@ RImage *RRenderInterwovenGradient(unsigned width, unsigned height, RColor colors
 
   for (i = 0, k = 0, l = 0, ll = thickness1; i < height; i++) {
     if (k == 0)
-      ptr = renderGradientWidth(ptr, width, r1 >> 16, g1 >> 16, b1 >> 16);
+      ptr = renderSolidSpan(ptr, width, r1 >> 16, g1 >> 16, b1 >> 16);
     else
-      ptr = renderGradientWidth(ptr, width, r2 >> 16, g2 >> 16, b2 >> 16);
+      ptr = renderSolidSpan(ptr, width, r2 >> 16, g2 >> 16, b2 >> 16);
 
     if (++l == ll) {
       if (k == 0) {
@@ -0,0 +1,105 @@
+/*
+ * Gradient rendering micro-benchmark.
+ *
+ * Renders gradients of typical window manager texture sizes (title bars,
+ * resize bars, menus, backgrounds) and prints time spent per image.
+ * No X server connection is needed.
+ */
+
+#include "wraster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <time.h>
+
+char *ProgName;
+
+static struct {
+	const char *name;
+	unsigned width;
+	unsigned height;
+} sizes[] = {
+	{ "titlebar", 1024, 22 },
+	{ "resizebar", 1024, 8 },
+	{ "menu", 200, 400 },
+	{ "miniwindow", 64, 64 },
+	{ "background", 1920, 1080 }
+};
+
+static struct {
+	const char *name;
+	RGradientStyle style;
+} styles[] = {
+	{ "horizontal", RHorizontalGradient },
+	{ "vertical", RVerticalGradient },
+	{ "diagonal", RDiagonalGradient }
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *kind, RColor **colors, int count, int loops)
+{
+	RImage *img;
+	double start, elapsed;
+	int s, t, i;
+	unsigned w, h;
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		w = sizes[s].width;
+		h = sizes[s].height;
+		for (t = 0; t < sizeof(styles) / sizeof(styles[0]); t++) {
+			start = now();
+			for (i = 0; i < loops; i++) {
+				if (count > 2)
+					img = RRenderMultiGradient(w, h, colors, styles[t].style);
+				else
+					img = RRenderGradient(w, h, colors[0], colors[1], styles[t].style);
+				if (!img) {
+					fprintf(stderr, "%s: could not render gradient: %s\n", ProgName,
+						RMessageForError(RErrorCode));
+					exit(1);
+				}
+				RReleaseImage(img);
+			}
+			elapsed = now() - start;
+			printf("%-6s %-10s %-10s %4ux%-4u %10.2f us\n", kind, styles[t].name,
+			       sizes[s].name, w, h, elapsed * 1e6 / loops);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	RColor c[4] = {
+		{ 0x20, 0x40, 0x80, 0xff },
+		{ 0xc0, 0xd0, 0xf0, 0xff },
+		{ 0x80, 0x10, 0x10, 0xff },
+		{ 0x00, 0x00, 0x00, 0xff }
+	};
+	RColor *colors[] = { &c[0], &c[1], &c[2], &c[3], NULL };
+	int loops = 200;
+
+	ProgName = strrchr(argv[0], '/');
+	if (!ProgName)
+		ProgName = argv[0];
+	else
+		ProgName++;
+
+	if (argc > 1 && (sscanf(argv[1], "%i", &loops) != 1 || loops <= 0)) {
+		printf("usage: %s [loops]\n", ProgName);
+		exit(1);
+	}
+
+	bench("2color", colors, 2, loops);
+	bench("4color", colors, 4, loops);
+
+	return 0;
+}
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 
 #include "config.h"
@@ -49,6 +50,13 @@ static int get_shifts(unsigned long mask)
 #define NORMALIZE_BLUE(pixel) \
   ((bshift > 0) ? ((pixel) & bmask) >> bshift : ((pixel) & bmask) << -bshift)
 
+static int host_byte_order(void)
+{
+  const int one = 1;
+
+  return (*(const char *)&one) ? LSBFirst : MSBFirst;
+}
+
 RImage *RCreateImageFromXImage(RContext *context, XImage *image, XImage *mask)
 {
   RImage *img;
@@ -104,6 +112,21 @@ RImage *RCreateImageFromXImage(RContext *context, XImage *image, XImage *mask)
           data++;
       }
     }
+  } else if (image->bits_per_pixel == 32 && image->byte_order == host_byte_order()) {
+    /* Read pixels directly: XGetPixel() per pixel is too slow for big
+     * images (e.g. screen captures) */
+    for (y = 0; y < image->height; y++) {
+      const uint32_t *row = (const uint32_t *)(image->data + y * image->bytes_per_line);
+
+      for (x = 0; x < image->width; x++) {
+        pixel = row[x];
+        *(data++) = NORMALIZE_RED(pixel);
+        *(data++) = NORMALIZE_GREEN(pixel);
+        *(data++) = NORMALIZE_BLUE(pixel);
+        if (mask)
+          data++;
+      }
+    }
   } else {
     for (y = 0; y < image->height; y++) {
       for (x = 0; x < image->width; x++) {